@@ -17,7 +17,7 @@
   Free Software Project hosted at:
   http://avl-array.sourceforge.net
 
-  The source code is organized in 28 different header files, of
+  The source code is organized in 36 different header files, of
   which this is the main one. All them have been profusely
   commented. The #include sections at the beginnig and the end of
   this file might serve as an index to the different files.
@@ -40,6 +40,15 @@
 #include <memory>
 #include <functional>
 #include <cassert>
+#include <new>
+#include <algorithm>
+
+#if __cplusplus >= 201103L
+#include <type_traits>
+#include <vector>
+#include <thread>
+#include <exception>
+#endif
 
 //////////////////////////////////////////////////////////////////
 
@@ -77,6 +86,15 @@
 #include "detail/empty_number.hpp"      // Default W (no NPSV)
                                         // and P (no stable sort)
 
+#include "detail/monoid_traits.hpp"     // How widths (W) combine
+
+#include "detail/node_layout.hpp"       // Layout policies (S)
+
+#include "detail/node_pool.hpp"         // Pool allocator (A)
+
+#include "detail/parallel_sort.hpp"     // Sort of node pointers
+                                        // (for internal use only)
+
 #include "detail/exception.hpp"         // Exceptions
 
 #include "detail/iterator.hpp"          // Normal iterators
@@ -93,6 +111,10 @@
                                         // guest (T) exceptions
                                         // (for internal use only)
 
+#include "detail/dirty_list.hpp"        // Nodes with out of date
+                                        // NPSV sums (lazy mode)
+                                        // (for internal use only)
+
 // (Other headers, containing avl_array methods implementations
 // are included from the end of this file)
 
@@ -108,19 +130,21 @@ namespace mkr  // Public namespace
 template<class T,                       // The container class
          class A=std::allocator<T>,     // (at last)
          class W=empty_number,
-         class P=empty_number>
+         class P=empty_number,
+         class S=threaded_layout>
 class avl_array
-  : private avl_array_node_tree_fields<T,A,W,P>
+  : private avl_array_node_tree_fields<T,A,W,P,S>
 {
 
   // -------------------------- TYPES ----------------------------
 
   public:
 
-    typedef avl_array_node_tree_fields<T,A,W,P>  node_t;
-    typedef avl_array_node<T,A,W,P>              payload_node_t;
-    typedef avl_array<T,A,W,P>                   my_class;
-    typedef rollback_list<T,A,W,P>               rollback_list_t;
+    typedef avl_array_node_tree_fields<T,A,W,P,S>  node_t;
+    typedef avl_array_node<T,A,W,P,S>            payload_node_t;
+    typedef avl_array<T,A,W,P,S>                 my_class;
+    typedef rollback_list<T,A,W,P,S>             rollback_list_t;
+    typedef avl_array_threads<S::threaded>       threads_t;
 
     typedef typename A::value_type               value_type;
     typedef typename A::reference                reference;
@@ -131,13 +155,13 @@ class avl_array
     typedef std::ptrdiff_t                       difference_type;
     typedef std::size_t                          size_type;
 
-    typedef avl_array_iterator<T,A,W,P,
+    typedef avl_array_iterator<T,A,W,P,S,
                            reference,pointer>    iterator;
-    typedef avl_array_iterator<T,A,W,P,
+    typedef avl_array_iterator<T,A,W,P,S,
                const_reference,const_pointer>    const_iterator;
-    typedef avl_array_rev_iter<T,A,W,P,
+    typedef avl_array_rev_iter<T,A,W,P,S,
                            reference,pointer>    reverse_iterator;
-    typedef avl_array_rev_iter<T,A,W,P,
+    typedef avl_array_rev_iter<T,A,W,P,S,
             const_reference,const_pointer> const_reverse_iterator;
 
     typedef typename A::template
@@ -191,7 +215,11 @@ class avl_array
     // Vector def. con.: " with n default-constructed elem. (O(N))
     // Sequence con.: " with copies of [from,to) (O(N))
     // Sequence con.: " with copies of [from,from+n) (O(N))
-    // Destructor (O(N))
+    // Move con.: take the contents of other avl_array (O(1))*
+    // Sequence move con.: " moving the objects of [from,to) (O(N))*
+    // Destructor (O(N), O(chunks) with a pool**)
+    // (*) C++11 only
+    // (**) Same conditions as clear() (see below)
 
     avl_array ();
     avl_array (const my_class & a);
@@ -206,6 +234,14 @@ class avl_array
     template <class IT>
     avl_array (IT from, size_type n);
 
+#if __cplusplus >= 201103L
+    avl_array (my_class && a) noexcept;
+
+    template <class IT>
+    avl_array (std::move_iterator<IT> from,
+               std::move_iterator<IT> to);
+#endif
+
     ~avl_array ();
 
 
@@ -213,11 +249,16 @@ class avl_array
     // See assign.hpp
     //
     // Assignment operator (O(M+N), M to delete + N to copy)
+    // Move assignment operator (O(M), M to delete) (C++11 only)
     // swap(): interchange contents (O(1))
 
     const my_class & operator= (const my_class & a);
     void swap (my_class & a);
 
+#if __cplusplus >= 201103L
+    const my_class & operator= (my_class && a) noexcept;
+#endif
+
 
     // Size methods
     // See size.hpp
@@ -225,12 +266,14 @@ class avl_array
     // size(): retrieve current size (O(1))
     // empty(): true if empty; false otherwise (O(1))
     // max_size(): estimated maximum size in theory (O(1))
+    // reserve(n): preallocate nodes, if A is a pool (O(1)*)
     // resize(n): change size (O(min{N, n log N}))
     // resize(n,t): idem, but add copies of t  "
 
     size_type size () const;
     bool empty () const;
     static size_type max_size ();
+    void reserve (size_type n);
     void resize (size_type n);
     void resize (size_type n, const_reference t);
 
@@ -335,6 +378,32 @@ class avl_array
     template <class IT>
     void insert (reverse_iterator it, IT from, IT to);
 
+#if __cplusplus >= 201103L
+
+    // With C++11, T objects can be moved in, or built in place
+    //
+    // it insert(&&t): move-insert anywhere (O(log N))
+    // it insert(it,&&t): move-insert before (O(log N))
+    // rit insert(rit,&&t): move-insert before* (O(log N))
+    // insert(it,mfrom,mto): sequence-move before (O(min{N, n log N}))
+    // it emplace(it,args...): construct before (O(log N))
+
+    iterator insert (value_type && t);
+
+    iterator insert (const iterator & it, value_type && t);
+    reverse_iterator insert (const reverse_iterator & it,
+                             value_type && t);
+
+    template <class IT>
+    void insert (iterator it,
+                 std::move_iterator<IT> from,
+                 std::move_iterator<IT> to);
+
+    template <class... ARGS>
+    iterator emplace (const iterator & it, ARGS &&... args);
+
+#endif
+
 
     // Erasing
     // See erase.hpp
@@ -344,7 +413,14 @@ class avl_array
     // rit erase(rit,n): vector-erase (reverse)    "
     // it erase(from,to): range-erase              "
     // rit erase(rfrom,rto): range-erase (reverse) "
-    // clear(): delete all (O(N))
+    // remove_if(pred): erase where pred is true   "
+    // erase_positions(from,to): erase sorted pos. "
+    // clear(): delete all (O(N), O(chunks) with a pool*)
+    // (*) Only if T is trivially destructible and the pool
+    //     holds nothing but the nodes of this array. The pool
+    //     is shared by every avl_array with the same allocator
+    //     type (and Tag), so while another one has nodes, they
+    //     are freed one by one in O(N)
 
     iterator         erase (iterator it);
     reverse_iterator erase (reverse_iterator it);
@@ -355,6 +431,13 @@ class avl_array
     iterator         erase (iterator from, iterator to);
     reverse_iterator erase (reverse_iterator from,
                             reverse_iterator to);
+
+    template<class PRED>
+    size_type remove_if (PRED pred);
+
+    template<class IT>
+    size_type erase_positions (IT from, IT to);
+
     void clear ();
 
 
@@ -379,6 +462,26 @@ class avl_array
     void push_back (const_reference t);
     void pop_back ();
 
+#if __cplusplus >= 201103L
+
+    // With C++11, T objects can be moved in, or built in place
+    //
+    // push_front(&&t): move before first element (O(log N))
+    // push_back(&&t): move after last element (O(log N))
+    // emplace_front(args...): construct before first (O(log N))
+    // emplace_back(args...): construct after last (O(log N))
+
+    void push_front (value_type && t);
+    void push_back (value_type && t);
+
+    template <class... ARGS>
+    reference emplace_front (ARGS &&... args);
+
+    template <class... ARGS>
+    reference emplace_back (ARGS &&... args);
+
+#endif
+
 
     // Move operations (don't touch value_type objects, just
     // change the links of tree nodes)
@@ -388,13 +491,13 @@ class avl_array
     //                                (O(1), O(log N) with NPSV)
     // move(it/rit,n): offset move (O(log N))
     // move(it/rit,it/rit): individual move O(log(M)+log(N))
-    // move(it/rit,n,it/rit): group move O(min{N, n log N} +
-    //                                     min{M, n log M})
+    // move(it/rit,n,it/rit): group move O(log(M)+log(N))*
     // move(it/rit,it/rit,it/rit): range move    "
     // splice(it/rit,cont): group move (see above)
     // splice(it/rit,cont,it/rit): individual move (see above)
     // splice(it/rit,cont,it/rit,it/rit): range move (see above)
     // reverse(): invert the sequence (O(N))
+    // (*) O(n) more if the order of the group is inverted
 
     static void swap (iterator it1, iterator it2);
     static void swap (iterator it1, reverse_iterator it2);
@@ -461,6 +564,19 @@ class avl_array
     void reverse ();
 
 
+    // Split and join (don't touch value_type objects either)
+    // See split_join.hpp
+    //
+    // split(it): move [it,end) to a new avl_array (O(log N))
+    // split(it,cont): idem, to another avl_array (O(log N)*)
+    // join(cont): append another avl_array (O(log(M)+log(N)))
+    // (*) Plus clearing the previous contents of cont
+
+    my_class split (iterator it);
+    void split (iterator it, my_class & dst);
+    void join (my_class & src);
+
+
     // Sorting methods and related algorithms
     // See sorted_search_tree.hpp
     //
@@ -468,6 +584,8 @@ class avl_array
     // insert_sorted(): insert keeping order* (O(log N))
     // sort(): impose order                          (O(N log N))
     // stable_sort(): idem + keep current order between equals "
+    // sort(cmp,threads): sort node pointers in parallel    "
+    // stable_sort(cmp,threads): idem, stable (P not needed) "
     // merge(): mix two containers, keeping order* (O(M+N))
     // unique(): remove duplicates* (O(N))
     // (*) Elements must be previously in order
@@ -516,6 +634,12 @@ class avl_array
 
     void stable_sort ();
 
+    template<class CMP>
+    void sort (CMP cmp, size_type threads);
+
+    template<class CMP>
+    void stable_sort (CMP cmp, size_type threads);
+
     template<class CMP>
     void merge (my_class & donor, CMP cmp);
 
@@ -536,7 +660,8 @@ class avl_array
     // npsv_set_width(): set an element's width O(log N) or O(1)**
     // npsv_pos_of(): get an element's position O(log N) or O(N)*
     // npsv_at_pos(): get elem. of a position O(log N) or O(N)*
-    // (*) width sums need to be updated
+    // (*) width sums need to be updated (O(k log N) after k
+    //     changes in lazy mode, unless k is too big)
     // (**) don't update width sums (lazy mode)
 
     void npsv_update_sums () const;
@@ -559,19 +684,73 @@ class avl_array
     const_iterator npsv_at_pos (W pos, CMP cmp) const;
 
 
+    // Widths of any monoid (not only NPSV)
+    // See augment.hpp and monoid_traits.hpp
+    //
+    // set_width(): set an element's width O(log N) or O(1)**
+    // reduce(from,to): combine the widths of a range O(log N)*
+    // search(pred): first prefix accepted by pred O(log N)*
+    // (*) width sums need to be updated
+    // (**) don't update width sums (lazy mode)
+
+    void set_width (const iterator & it, W w,
+                    bool update_sums=true);
+
+    W reduce (const_iterator from, const_iterator to) const;
+
+    template<class PRED>
+    iterator search (PRED pred);
+
+    template<class PRED>
+    const_iterator search (PRED pred) const;
+
+
+    // Memory layout of the nodes
+    // See relayout.hpp
+    //
+    // relayout(o): copy all nodes to new memory, in the order o,
+    //              invalidating iterators (O(N)*)
+    // relayout(o,from,to): idem, but update the iterators in the
+    //                      range [from,to) (O(N+M)*)
+    // (*) O(N log log N) in van Emde Boas order
+    //
+    // Only relayout(o,from,to) keeps iterators usable, and only
+    // those in [from,to): any other iterator (except end ones)
+    // points to a destroyed node. The new nodes are contiguous
+    // only with node_pool_allocator. With other allocators,
+    // pool_traits<A>::allocate_block() returns 0, so the nodes
+    // are allocated one by one in the order o, and where they
+    // land is up to the allocator
+
+    enum layout_order
+    {
+      in_order,       // Sequence order (for travels)
+      veb_order       // van Emde Boas order (for searches)
+    };
+
+    void relayout (layout_order o=in_order);
+
+    template<class IT>
+    void relayout (layout_order o, IT from, IT to);
+
+
   // ------------------------- FRIENDS ---------------------------
 
   private:
 
-  friend class avl_array_iterator<T,A,W,P,reference,pointer>;
-  friend class avl_array_iterator<T,A,W,P,const_reference,
+  friend class avl_array_iterator<T,A,W,P,S,reference,pointer>;
+  friend class avl_array_iterator<T,A,W,P,S,const_reference,
                                             const_pointer>;
 
-  friend class avl_array_rev_iter<T,A,W,P,reference,pointer>;
-  friend class avl_array_rev_iter<T,A,W,P,const_reference,
+  friend class avl_array_rev_iter<T,A,W,P,S,reference,pointer>;
+  friend class avl_array_rev_iter<T,A,W,P,S,const_reference,
                                           const_pointer>;
 
-  friend class rollback_list<T,A,W,P>;
+  friend class rollback_list<T,A,W,P,S>;
+  friend class dirty_list<T,A,W,P,S>;
+
+  template<class AR, class CMP>
+  friend class node_data_less;
 
 
   // ----------------------- PRIVATE DATA ------------------------
@@ -584,6 +763,11 @@ class avl_array
     mutable bool m_sums_out_of_date;  // If true: NPSV sums must
                                       // be recalculated
 
+                                      // Nodes changed in lazy
+    mutable dirty_list<T,A,W,P,S>     // mode (if empty with the
+                        m_dirty;      // dirty bit set, all sums
+                                      // must be recalculated)
+
 
   // ------------------ PRIVATE HELPER METHODS -------------------
 
@@ -604,15 +788,21 @@ class avl_array
     // Private helper methods for iterators
     // See detail/helper_fun_iter.hpp
     //
-    // next(): get the next node of a given node (O(1))
-    // prev(): get the previous node of a given node (O(1))
+    // next(): get the next node of a given node (O(1)*)
+    // prev(): get the previous node of a given node (O(1)*)
+    // walk(): next or prev. walking the tree (O(log N))
     // data(): get (by ref) the data of a node (with data!) (O(1))
     // iterator_pointer(): get the node refered by an it. (O(1))
     // make_const_iterator(): get const it. referring a node (O(1))
     // make_const_rev_iter(): get const reverse it...       (O(1))
+    // is_reverse(): tell the direction of an iterator      (O(1))
+    // (*) O(log N) without threads (see walk())
 
     static node_t * next (node_t * p);
     static node_t * prev (node_t * p);
+    static node_t * walk (node_t * p, int s);
+    static bool is_reverse (const iterator &);
+    static bool is_reverse (const reverse_iterator &);
     static reference data (node_t * p);
 
     template<class IT>
@@ -626,9 +816,24 @@ class avl_array
     // See alloc.hpp
     //
     // new_node(): Allocate and construct a new node (O(1))
+    // new_node(t,dp): idem, copying or moving t, as dp says (O(1))
+    // emplace_node(): idem, forwarding any arguments (O(1))
     // delete_node(): Destruct and deallocate a node (O(1))
 
     node_t * new_node (const_pointer t=NULL);
+
+    template<class DP>
+    node_t * new_node (const_pointer t, DP & dp);
+
+#if __cplusplus >= 201103L
+    template<class IT>
+    node_t * new_node (const_pointer t,
+                       move_data_provider<const_pointer,IT> & dp);
+
+    template<class... ARGS>
+    node_t * emplace_node (ARGS &&... args);
+#endif
+
     void delete_node (node_t * p);
 
 
@@ -720,11 +925,18 @@ class avl_array
     // Helper methods for insertion
     // See insert.hpp
     //
+    // insert_provided(): insert the objects of a data provider
+    //                    before a node (O(min{N, n log N}))
     // insert_before(): insert a node in a given pos. (O(log N))
     // insert_anywhere(): add a node to the tree (O(log N))
+    // make_leaf(): reset links and counters of a node (O(1))
+
+    template<class DP>
+    void insert_provided (node_t * p, DP & dp);
 
     static void insert_before (node_t * newnode, node_t * p);
     void insert_anywhere (node_t * newnode);
+    static void make_leaf (node_t * p);
 
 
     // Initializer method
@@ -751,10 +963,17 @@ class avl_array
                         node_t * next); // List with nodes to link
 
 
-    // Helper method for massive operations (temp. lists)
+    // Helper methods for massive operations (temp. lists)
     // See build_list.hpp
     //
     // construct_nodes_list(): prepare a list of new nodes (O(N))
+    // construct_nodes_list_nothrow(): idem, for T constructors
+    //                   that can't throw (no rollback_list) (O(N))
+    // flatten(): turn the tree into a list (O(N) w/o threads)
+    // detach_list(): idem, NULL terminated, return first node
+
+    void flatten ();
+    node_t * detach_list ();
 
     template<class DP>               // Return number of nodes
     size_type                        // created
@@ -766,6 +985,12 @@ class avl_array
          bool reverse=false,         // Direction
          bool exhaust_dp=false);     // Use DP until NULL
 
+    template<class DP>
+    size_type
+      construct_nodes_list_nothrow
+        (node_t *& first, node_t *& last, size_type n,
+         DP & data_provider, bool reverse, bool exhaust_dp);
+
 
     // Helper methods for moving and swapping
     // See move.hpp
@@ -774,7 +999,7 @@ class avl_array
     // move_node(): move n places along the sequence (O(log N))
     // move_node(): extract and insert in other pos. (O(log N))
     // move_nodes(): move n nodes to another pos.
-    //                                        (O(min{N, n log N})
+    //                                     (O(log(M)+log(N)))
 
     static void swap_nodes (node_t * p, node_t * q);
     static void move_node (node_t * p, difference_type n);
@@ -787,9 +1012,46 @@ class avl_array
                             bool reverse=false);
 
 
-    // Helper method for sorting and searching
+    // Helper methods for split and join
+    // See split_join.hpp
+    //
+    // split_tree(): cut a tree in two before a node (O(log N))
+    // join_trees(): concatenate two trees (O(log N))
+    // plant_tree(): hang a subtree from a dummy node (O(1))
+    // make_dummy(): init. a temporary dummy node (O(1))
+    // mirror_tree(): swap children in a subtree (O(N))
+
+    static void split_tree (node_t * d, node_t * x, node_t * dr);
+    static void join_trees (node_t * dl, node_t * m, node_t * dr);
+    static void plant_tree (node_t * d, node_t * root);
+    static void make_dummy (node_t * d);
+    static void mirror_tree (node_t * p);
+
+
+    // Helper method for NPSV
+    // See npsv.hpp
+    //
+    // npsv_nodes_from(): take the NPSV dirty state of nodes moved
+    //                    from another avl_array (O(1))
+
+    void npsv_nodes_from (my_class & s);
+
+
+    // Helper method for reduce()
+    // See augment.hpp
+    //
+    // reduce_subtree(): combine the widths of a range of
+    //                   positions in a subtree (O(log N))
+
+    static W reduce_subtree (const node_t * p,
+                             size_type lo, size_type hi);
+
+
+    // Helper methods for sorting and searching
     //
     // binary_search(): search value in a sorted tree (O(log N))
+    // sort_nodes(): sort an array of node pointers and rebuild
+    //               the tree with them (O(N log N))
 
     template<class CMP>
     bool binary_search             // Return true iff it is found
@@ -800,6 +1062,9 @@ class avl_array
          bool stable=false)
                         const;
 
+    template<class CMP>
+    void sort_nodes (CMP cmp, size_type threads, bool stable);
+
 
     // Helper method for massive resize operations
     // See size.hpp
@@ -810,6 +1075,22 @@ class avl_array
     template<class DP>
     void resize (size_type n, DP & dp);
 
+
+    // Helper methods for relayout
+    // See relayout.hpp
+    //
+    // veb_sequence(): list a subtree in vEB order (O(N log log N))
+    // veb_bottoms(): idem for the subtrees at a given depth "
+    // relocate_nodes(): copy nodes and fix links (O(N))
+    // forward(): new address of a relocated node (O(1))
+
+    static void veb_sequence (node_t * p, int h, node_t **& out);
+    static void veb_bottoms (node_t * p, int d, int h,
+                             node_t **& out);
+
+    void relocate_nodes (node_t ** nodes, size_type n);
+    static node_t * forward (node_t * p);
+
 };
 
 //////////////////////////////////////////////////////////////////
@@ -837,6 +1118,7 @@ class avl_array
 #include "detail/aa_insert.hpp"  // insert()
 #include "detail/aa_erase.hpp"   // erase(), clear()
 #include "detail/aa_move.hpp"   // move/splice(), swap(), reverse()
+#include "detail/aa_split_join.hpp" // split(), join()
 #include "detail/aa_size.hpp"   // size(), max_size(), resize()...
 
 #include "detail/aa_sorted_search_tree.hpp" // sort(),
@@ -846,6 +1128,9 @@ class avl_array
                                         // merge(), unique()
 
 #include "detail/aa_npsv.hpp"   // Non Proportional Sequence View
+#include "detail/aa_augment.hpp"  // reduce(), search()...
+
+#include "detail/aa_relayout.hpp"   // relayout()
 
 // (Other headers, containing detail classes
 // are included from the beginning of this file)
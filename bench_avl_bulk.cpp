@@ -0,0 +1,62 @@
+#include "avl_array.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+typedef mkr::avl_array<std::uint64_t> array_t;
+typedef mkr::avl_array<std::uint64_t, mkr::node_pool_allocator<std::uint64_t>> pool_array_t;
+
+// Run f passes times, returning the nanoseconds per element
+
+template<class F>
+double measure(std::size_t count, std::size_t passes, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t pass = 0; pass != passes; ++pass) f();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() * 1e9 / (count * passes);
+}
+
+template<class AR>
+void run(char const * name, std::size_t count, std::uint64_t & checksum)
+{
+	auto passes = 1 + 10000000 / (count + 1);
+
+	// Only one array exists while insert and resize are timed, so with the
+	// pool its destructor frees all the nodes at once, in O(chunks)
+
+	std::cout << name << ": insert(it,n,t) " << measure(count, passes, [&] {
+		AR nums(16, std::uint64_t(1));
+		nums.insert(nums.begin() + 8, count, std::uint64_t(3));
+		checksum += nums.size();
+	}) << " ns, ";
+
+	std::cout << "resize " << measure(count, passes, [&] {
+		AR nums;
+		nums.resize(count);
+		checksum += nums.size();
+	}) << " ns, ";
+
+	// The copy shares the pool with its source, so it is freed node by
+	// node, in O(N)
+
+	AR source(count, std::uint64_t(7));
+
+	std::cout << "copy " << measure(count, passes, [&] {
+		AR nums(source);
+		checksum += nums.size();
+	}) << " ns\n";
+}
+
+int main(int argc, char * * argv)
+{
+	std::size_t count = std::atoi(argv[1]);
+	std::uint64_t checksum = 0;
+
+	run<array_t>("std::allocator", count, checksum);
+	run<pool_array_t>("pool", count, checksum);
+
+	std::cout << checksum << "\n";
+}
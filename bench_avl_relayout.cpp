@@ -0,0 +1,72 @@
+#include "avl_array.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+typedef mkr::avl_array<std::uint64_t, mkr::node_pool_allocator<std::uint64_t>> array_t;
+
+// Scan the whole sequence passes times, returning the nanoseconds per element
+
+double scan(array_t const & nums, std::size_t passes, std::uint64_t & checksum)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t pass = 0; pass != passes; ++pass)
+	{
+		for (auto num : nums) checksum += num;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() * 1e9 / (nums.size() * passes);
+}
+
+// Read count random indices, returning the nanoseconds per lookup
+
+double lookup(array_t const & nums, std::size_t count, std::uint64_t & checksum)
+{
+	std::mt19937_64 engine;
+	std::uniform_int_distribution<std::size_t> dist(0, nums.size() - 1);
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i != count; ++i) checksum += nums[dist(engine)];
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() * 1e9 / count;
+}
+
+void measure(char const * name, array_t const & nums, std::uint64_t & checksum)
+{
+	auto passes = 1 + 100000000 / (nums.size() + 1);
+	std::cout << name << ": scan " << scan(nums, passes, checksum) << " ns, ";
+	std::cout << "index " << lookup(nums, 1000000, checksum) << " ns\n";
+}
+
+int main(int argc, char * * argv)
+{
+	std::size_t count = std::atoi(argv[1]);
+	std::mt19937_64 engine;
+	array_t nums;
+
+	// Insert count integers randomly, which scatters the nodes
+	for (std::size_t i = 0; i != count; ++i)
+	{
+		std::uniform_int_distribution<std::size_t> dist(0, nums.size());
+		nums.insert(nums.begin() + dist(engine), i);
+	}
+
+	std::uint64_t checksum = 0;
+	measure("scattered", nums, checksum);
+
+	auto start = std::chrono::steady_clock::now();
+	nums.relayout(array_t::in_order);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "relayout in order: " << elapsed.count() << " s\n";
+	measure("in order", nums, checksum);
+
+	start = std::chrono::steady_clock::now();
+	nums.relayout(array_t::veb_order);
+	elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "relayout veb order: " << elapsed.count() << " s\n";
+	measure("veb order", nums, checksum);
+
+	std::cout << checksum << "\n";
+}
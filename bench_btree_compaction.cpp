@@ -0,0 +1,52 @@
+#include "btree_array.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// Scan the whole sequence passes times, returning the bandwidth in GB/s
+
+template<typename Array>
+double scan(Array const & nums, std::size_t passes, std::uint64_t & checksum)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t pass = 0; pass != passes; ++pass)
+	{
+		nums.iterate([&](std::uint64_t const * data, std::size_t data_size)
+		{
+			for (std::size_t i = 0; i != data_size; ++i) checksum += data[i];
+		});
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return nums.size() * sizeof(std::uint64_t) * passes / elapsed.count() / 1e9;
+}
+
+int main(int argc, char * * argv)
+{
+	std::size_t count = std::atoi(argv[1]);
+	std::mt19937_64 engine;
+	btree_array_t<std::uint64_t> nums;
+
+	// Insert count integers randomly, which scatters the leaves
+	for (std::size_t i = 0; i != count; ++i)
+	{
+		std::uniform_int_distribution<std::size_t> dist(0, nums.size());
+		auto index = dist(engine);
+		nums.insert(index, i);
+	}
+
+	// Scan about a billion elements in each measurement
+	auto passes = 1 + 1000000000 / (count + 1);
+	std::uint64_t checksum = 0;
+	std::cout << "before: " << scan(nums, passes, checksum) << " GB/s\n";
+
+	auto start = std::chrono::steady_clock::now();
+	nums.compact();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "compact: " << elapsed.count() << " s\n";
+
+	std::cout << "after: " << scan(nums, passes, checksum) << " GB/s\n";
+	std::cout << checksum << "\n";
+}
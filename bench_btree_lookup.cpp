@@ -0,0 +1,47 @@
+#include "btree_array.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// Time lookups at random indices, one at a time and then in batches,
+// returning millions of lookups per second
+
+int main(int argc, char * * argv)
+{
+	std::size_t count = std::atoi(argv[1]);
+	std::size_t lookups = 10000000;
+	std::size_t batch = 1000;
+	std::mt19937_64 engine;
+	btree_array_t<std::uint64_t> nums;
+
+	for (std::size_t i = 0; i != count; ++i) nums.push_back(i);
+
+	std::vector<std::size_t> indices(lookups);
+	std::uniform_int_distribution<std::size_t> dist(0, count - 1);
+	for (auto & index : indices) index = dist(engine);
+
+	std::vector<std::uint64_t> out(lookups);
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i != lookups; ++i) out[i] = nums.get(indices[i]);
+	std::chrono::duration<double> sequential = std::chrono::steady_clock::now() - start;
+
+	std::uint64_t checksum = 0;
+	for (auto num : out) checksum += num;
+
+	start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < lookups; i += batch)
+	{
+		auto size = lookups - i < batch ? lookups - i : batch;
+		nums.get_batch(indices.data() + i, size, out.data() + i);
+	}
+	std::chrono::duration<double> batched = std::chrono::steady_clock::now() - start;
+
+	for (auto num : out) checksum -= num;
+
+	std::cout << "sequential: " << lookups / sequential.count() / 1e6 << " M/s\n";
+	std::cout << "batched: " << lookups / batched.count() / 1e6 << " M/s\n";
+	std::cout << checksum << "\n";
+}
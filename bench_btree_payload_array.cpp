@@ -0,0 +1,52 @@
+#include "btree_payload_array.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// A 192-byte record, well above the default payload threshold
+
+struct record_t
+{
+	std::uint64_t key;
+	std::uint64_t fields[23];
+};
+
+// Insert count records at random positions, returning the seconds taken
+
+template<typename Array>
+double run(std::size_t count, std::uint64_t & checksum)
+{
+	std::mt19937_64 engine;
+	Array nums;
+
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i != count; ++i)
+	{
+		std::uniform_int_distribution<std::size_t> dist(0, nums.size());
+		record_t record = {};
+		record.key = i;
+		nums.insert(dist(engine), record);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	nums.iterate([&](record_t const * data, std::size_t data_size)
+	{
+		for (std::size_t i = 0; i != data_size; ++i) checksum = checksum * 31 + data[i].key;
+	});
+	return elapsed.count();
+}
+
+int main(int argc, char * * argv)
+{
+	std::size_t count = std::atoi(argv[1]);
+	std::uint64_t inline_checksum = 0;
+	std::uint64_t payload_checksum = 0;
+
+	// A threshold above sizeof(record_t) keeps the records in the leaves
+	std::cout << "inline: " << run<btree_auto_array_t<record_t, 256>>(count, inline_checksum) << " s\n";
+	std::cout << "payload: " << run<btree_auto_array_t<record_t>>(count, payload_checksum) << " s\n";
+	std::cout << (inline_checksum == payload_checksum ? "match" : "MISMATCH") << "\n";
+}
@@ -1,217 +1,300 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <string>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
-template<
-	typename T,
-	std::size_t target_branch_size = 512,
-	std::size_t target_leaf_size = 512,
-	std::size_t maximum_size = std::numeric_limits<std::size_t>::max()>
-class btree_array_t
-{
-private:
-	struct node_t
-	{
-		std::size_t size;
-		void * pointer;
-	};
+#include "detail/btree_tree.hpp"
+#include "detail/parallel.hpp"
 
-	// Compute the logarithm rounded up to the nearest int
-
-	static std::size_t constexpr log(std::size_t num, std::size_t base, std::size_t result)
-	{
-		return num != 0 ? log(num / base, base, result + 1) : result;
-	}
+namespace btree_detail
+{
 
-	static std::size_t constexpr log(std::size_t num, std::size_t base)
-	{
-		return log(num - 1, base, 0);
-	}
+template<bool compact_nodes>
+using array_node_t = basic_node_t<
+	typename std::conditional<compact_nodes, std::uint32_t, std::size_t>::type,
+	typename std::conditional<compact_nodes, std::uint32_t, void *>::type>;
 
-	static_assert(std::is_pod<T>::value, "T must be a pod");
+template<typename T, std::size_t target_branch_size, std::size_t target_leaf_size, std::size_t maximum_size, bool compact_nodes>
+struct array_policy_t : basic_policy_t<array_node_t<compact_nodes>>
+{
+	typedef array_node_t<compact_nodes> node_t;
 
 	static std::size_t constexpr maximum_branch_size = target_branch_size  / sizeof(node_t);
 	static std::size_t constexpr maximum_leaf_size = target_leaf_size / sizeof(T);
-
-	static_assert(maximum_branch_size >= 3, "maximum_branch_size must be at least 3");
-
 	static std::size_t constexpr minimum_branch_size = (maximum_branch_size + 1) / 2;
 	static std::size_t constexpr minimum_leaf_size = (maximum_leaf_size + 1) / 2;
 	static std::size_t constexpr stack_size = log(maximum_size / minimum_leaf_size, minimum_branch_size);
 
-	struct branch_t
-	{
-		node_t children[maximum_branch_size];
-	};
+	typedef basic_branch_t<node_t, maximum_branch_size> branch_t;
 
 	struct leaf_t
 	{
 		T buffer[maximum_leaf_size];
 	};
 
-	struct branch_entry_t
+	typedef typename std::conditional<
+		compact_nodes,
+		btree_arena_storage_t<branch_t, leaf_t>,
+		btree_heap_storage_t<branch_t, leaf_t>>::type storage_t;
+};
+
+}
+
+// With compact_nodes set, subtree sizes are 32 bits and children are 32-bit
+// indices into a node arena, which doubles the fanout of a branch.
+//
+// Const member functions only read the tree, so any number of them may run
+// concurrently as long as no non-const member function runs at the same
+// time, as with the standard containers
+
+template<
+	typename T,
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 512,
+	std::size_t maximum_size = std::numeric_limits<std::size_t>::max(),
+	bool compact_nodes = false>
+class btree_array_t
+:
+	private btree_detail::tree_t<btree_detail::array_policy_t<T, target_branch_size, target_leaf_size, maximum_size, compact_nodes>>
+{
+private:
+	static_assert(
+		!compact_nodes || maximum_size <= std::numeric_limits<std::uint32_t>::max(),
+		"compact trees count elements in 32 bits");
+
+	static_assert(std::is_pod<T>::value, "T must be a pod");
+
+	typedef btree_detail::array_policy_t<T, target_branch_size, target_leaf_size, maximum_size, compact_nodes> policy_t;
+	typedef btree_detail::tree_t<policy_t> tree_t;
+	typedef typename tree_t::node_t node_t;
+	typedef typename tree_t::link_t link_t;
+	typedef typename tree_t::branch_t branch_t;
+	typedef typename tree_t::leaf_t leaf_t;
+	typedef typename tree_t::storage_t storage_t;
+	typedef typename tree_t::branch_entry_t branch_entry_t;
+	typedef typename tree_t::leaf_entry_t leaf_entry_t;
+
+	using tree_t::maximum_branch_size;
+	using tree_t::stack_size;
+	static std::size_t constexpr maximum_leaf_size = policy_t::maximum_leaf_size;
+	static std::size_t constexpr minimum_branch_size = policy_t::minimum_branch_size;
+	static std::size_t constexpr minimum_leaf_size = policy_t::minimum_leaf_size;
+
+	using tree_t::storage_;
+	using tree_t::root_;
+	using tree_t::height_;
+	using tree_t::make_node;
+	using tree_t::get_length;
+	using tree_t::merge;
+	using tree_t::split;
+	using tree_t::delete_node;
+	using tree_t::seek;
+	using tree_t::update_sizes;
+	using tree_t::insert_sibling;
+
+	struct edge_entry_t
 	{
-		std::size_t size;
 		std::size_t index;
 		branch_t * pointer;
 	};
 
-	struct leaf_entry_t
+	// A cached path down the leftmost or rightmost spine, path[0] is the
+	// parent of the leaf. Elements pushed onto the edge leaf are counted
+	// in pending and only added to the spine sizes when flushed
+
+	struct edge_t
 	{
-		std::size_t size;
-		std::size_t index;
-		leaf_t * pointer;
+		edge_entry_t path[stack_size];
+		leaf_t * leaf;
+		std::size_t pending;
+		bool valid;
+	};
+
+	// A compaction in progress: the leaves copied so far into a fresh
+	// storage, which are stale once version no longer matches
+
+	struct compaction_t
+	{
+		std::unique_ptr<storage_t> storage;
+		std::vector<node_t> leaves;
+		std::size_t done;
+		std::size_t per_leaf;
+		std::size_t per_branch;
+		std::size_t version;
 	};
 
-	node_t root_;
-	std::size_t height_;
+	edge_t front_;
+	edge_t back_;
+	std::size_t version_;
+	compaction_t compaction_;
+
+	// Size of a child as readers see it. Elements pushed onto an edge leaf
+	// are only added to the spine above it when flushed, so until then the
+	// links along that spine are short by the pending count. Readers add
+	// it on the fly rather than flushing, so const methods never write
+
+	std::size_t child_size(branch_t const * branch, std::size_t index, std::size_t height) const
+	{
+		std::size_t size = branch->children[index].size;
+		auto & front = front_.path[height - 1];
+		auto & back = back_.path[height - 1];
+		if (front_.pending != 0 && front.pointer == branch && front.index == index) size += front_.pending;
+		if (back_.pending != 0 && back.pointer == branch && back.index == index) size += back_.pending;
+		return size;
+	}
+
+	node_t read_child(branch_t const * branch, std::size_t index, std::size_t height) const
+	{
+		return make_node(child_size(branch, index, height), branch->children[index].pointer);
+	}
 
 	template<typename Functor>
-	static void iterate(node_t node, std::size_t height, Functor functor)
+	void iterate(node_t node, std::size_t height, Functor functor) const
 	{
 		if (height != 0)
 		{
-			auto branch = static_cast<branch_t *>(node.pointer);
-			auto size = node.size;
+			auto branch = storage_.branch(node.pointer);
+			std::size_t size = node.size;
 			std::size_t index = 0;
 
 			while (size != 0)
 			{
-				iterate(branch->children[index], height - 1, functor);
-				size -= branch->children[index].size;
+				auto child = read_child(branch, index, height);
+				iterate(child, height - 1, functor);
+				size -= child.size;
 				++index;
 			}
 		}
 		else
 		{
-			auto leaf = static_cast<leaf_t *>(node.pointer);
+			auto leaf = storage_.leaf(node.pointer);
 			functor(leaf->buffer, node.size);
 		}
 	}
 
-	static std::size_t get_length(branch_t * branch, std::size_t size)
+	// Find the first element in [from, to) of a subtree for which match
+	// reports a hit, match(data, size) returns the offset of the first hit
+	// in data or size if there is none. Returns to if nothing matches
+
+	template<typename Match>
+	std::size_t find(node_t node, std::size_t height, std::size_t from, std::size_t to, Match & match) const
 	{
-		std::size_t index = 0;
-		while (size != 0)
+		if (height == 0)
 		{
-			size -= branch->children[index].size;
-			++index;
+			auto leaf = storage_.leaf(node.pointer);
+			return from + match(leaf->buffer + from, to - from);
 		}
-		return index;
-	}
 
-	static void delete_node(node_t node, std::size_t height)
-	{
-		if (height != 0)
+		auto branch = storage_.branch(node.pointer);
+		std::size_t offset = 0;
+		for (std::size_t index = 0; offset < to; ++index)
 		{
-			auto branch = static_cast<branch_t *>(node.pointer);
-			std::size_t index = 0;
-			auto size = node.size;
-
-			while (size != 0)
+			auto child = read_child(branch, index, height);
+			if (from < offset + child.size)
 			{
-				delete_node(branch->children[index], height - 1);
-				size -= branch->children[index].size;
-				++index;
+				auto first = from > offset ? from - offset : 0;
+				auto last = to - offset < child.size ? to - offset : child.size;
+				auto found = find(child, height - 1, first, last, match);
+				if (found != last) return offset + found;
 			}
-
-			delete branch;
-		}
-		else
-		{
-			auto leaf = static_cast<leaf_t *>(node.pointer);
-			delete leaf;
+			offset += child.size;
 		}
+		return to;
 	}
 
-	template<typename Kind>
-	static void merge(
-		std::size_t index,
-		Kind * orig, std::size_t orig_size,
-		Kind value)
-	{
-		std::char_traits<Kind>::move(
-			orig + index + 1,
-			orig + index,
-			orig_size - index);
-		orig[index] = value;
-	}
-
-	template<typename Kind>
-	static void split(
-		std::size_t index,
-		std::size_t left_size, std::size_t right_size, Kind * right,
-		Kind * orig, std::size_t orig_size,
-		Kind value)
-	{
-		if (index < left_size)
-		{
-			std::char_traits<Kind>::copy(
-				right,
-				orig + orig_size - right_size,
-				right_size);
-			std::char_traits<Kind>::move(
-				orig + index + 1,
-				orig + index,
-				left_size - 1 - index);
-			orig[index] = value;
+	// Compare a cache line worth of elements at a time without branching so
+	// that the compiler can vectorize the scan
+
+	static std::size_t constexpr scan_block = sizeof(T) < 64 ? 64 / sizeof(T) : 1;
+
+	static std::size_t find_in(T const * data, std::size_t size, T value)
+	{
+		std::size_t index = 0;
+		for (; index + scan_block <= size; index += scan_block)
+		{
+			bool hit = false;
+			for (std::size_t I = 0; I != scan_block; ++I) hit |= data[index + I] == value;
+			if (hit) break;
 		}
-		else
+		for (; index != size; ++index)
 		{
-			std::char_traits<Kind>::copy(
-				right,
-				orig + left_size,
-				index - left_size);
-			std::char_traits<Kind>::copy(
-				right + index + 1 - left_size,
-				orig + index,
-				orig_size - index);
-			right[index - left_size] = value;
+			if (data[index] == value) return index;
 		}
+		return size;
 	}
 
-	leaf_entry_t seek(branch_entry_t * first, branch_entry_t * last, node_t current, std::size_t index)
+	static std::size_t count_in(T const * data, std::size_t size, T value)
 	{
-		while (first != last)
+		std::size_t count = 0;
+		for (std::size_t index = 0; index != size; ++index) count += data[index] == value;
+		return count;
+	}
+
+	// Batched lookups keep this many descents in flight
+
+	static std::size_t constexpr batch_width = 16;
+
+	// A descent in progress, slot is where its result goes
+
+	struct lookup_t
+	{
+		link_t pointer;
+		std::size_t index;
+		std::size_t height;
+		std::size_t slot;
+	};
+
+	// Resolve the ascending indices in [first, last), which all fall in the
+	// subtree of node starting at offset. Every child is visited once with
+	// the run of indices that falls in it
+
+	void gather(
+		node_t node, std::size_t height, std::size_t offset,
+		std::size_t const * first, std::size_t const * last,
+		T * out) const
+	{
+		if (height == 0)
 		{
-			auto branch = static_cast<branch_t *>(current.pointer);
+			auto leaf = storage_.leaf(node.pointer);
+			while (first != last) *out++ = leaf->buffer[*first++ - offset];
+			return;
+		}
 
-			std::size_t branch_index = 0;
-			while (true)
+		auto branch = storage_.branch(node.pointer);
+		for (std::size_t index = 0; first != last; ++index)
+		{
+			auto child = read_child(branch, index, height);
+			auto end = offset + child.size;
+			auto split = first;
+			while (split != last && *split < end) ++split;
+			if (split != first)
 			{
-				auto child_size = branch->children[branch_index].size;
-				if (index <= child_size) break;
-				index -= child_size;
-				++branch_index;
+				gather(child, height - 1, offset, first, split, out);
+				out += split - first;
+				first = split;
 			}
-			branch_entry_t entry;
-			entry.size = current.size;
-			entry.index = branch_index;
-			entry.pointer = branch;
-			*--last = entry;
-			current = branch->children[branch_index];
+			offset = end;
 		}
-
-		leaf_entry_t entry;
-		entry.size = current.size;
-		entry.index = index;
-		entry.pointer = static_cast<leaf_t *>(current.pointer);
-		return entry;
 	}
 
-	void update_sizes(branch_entry_t * first, branch_entry_t * last)
+	static void prefetch(void const * data, std::size_t size)
 	{
-		while (first != last)
-		{
-			auto & entry = *first++;
-			++entry.pointer->children[entry.index].size;
-		}
-
-		++root_.size;
+#if defined(__GNUC__)
+		auto bytes = static_cast<char const *>(data);
+		for (std::size_t offset = 0; offset < size; offset += 64) __builtin_prefetch(bytes + offset);
+#endif
 	}
 
 	void insert(
@@ -225,95 +308,827 @@ private:
 		if (sum <= maximum_leaf_size)
 		{
 			merge(entry.index, entry.pointer->buffer, entry.size, value);
-			update_sizes(first, last);
+			update_sizes(first, last, make_node(1, link_t()));
 			return;
 		}
 
 		// No room, split into 2 and insert the first half in the parent
 		auto left_size = sum / 2;
 		auto right_size = sum - left_size;
-		auto right = new leaf_t;
+		auto link = storage_.make_leaf();
+		auto right = storage_.leaf(link);
 		split(
 			entry.index,
 			left_size, right_size, right->buffer,
 			entry.pointer->buffer, entry.size,
 			value);
-		insert(first, last, left_size, {right_size, right});
+		insert_sibling(first, last, make_node(left_size, link_t()), make_node(right_size, link), make_node(1, link_t()));
 	}
 
-	void insert(
-		branch_entry_t * first, branch_entry_t * last,
-		std::size_t left_size, node_t right_node)
+	// Apply the pending edge counts to the sizes along each spine
+
+	void flush(edge_t & edge)
+	{
+		if (edge.pending == 0) return;
+		for (std::size_t level = 0; level != height_; ++level)
+		{
+			auto & entry = edge.path[level];
+			entry.pointer->children[entry.index].size += edge.pending;
+		}
+		edge.pending = 0;
+	}
+
+	void flush()
+	{
+		flush(front_);
+		flush(back_);
+	}
+
+	void release_edges()
 	{
-		while (first != last)
+		flush();
+		front_.valid = false;
+		back_.valid = false;
+	}
+
+	void cache_front()
+	{
+		flush();
+		auto node = root_;
+		for (auto level = height_; level-- != 0;)
 		{
-			auto & entry = *first++;
-			auto branch_length = get_length(entry.pointer, entry.size);
-			auto sum = branch_length + 1;
-			entry.pointer->children[entry.index].size = left_size;
+			auto branch = storage_.branch(node.pointer);
+			front_.path[level] = {0, branch};
+			node = branch->children[0];
+		}
+		front_.leaf = storage_.leaf(node.pointer);
+		front_.valid = true;
+	}
+
+	void cache_back()
+	{
+		flush();
+		auto node = root_;
+		for (auto level = height_; level-- != 0;)
+		{
+			auto branch = storage_.branch(node.pointer);
+			auto index = get_length(branch, node.size) - 1;
+			back_.path[level] = {index, branch};
+			node = branch->children[index];
+		}
+		back_.leaf = storage_.leaf(node.pointer);
+		back_.valid = true;
+	}
+
+	static link_t child_link(edge_t const & edge, std::size_t level)
+	{
+		auto & entry = edge.path[level];
+		return entry.pointer->children[entry.index].pointer;
+	}
+
+	std::size_t edge_size(edge_t const & edge) const
+	{
+		if (height_ == 0) return root_.size;
+		auto & entry = edge.path[0];
+		return entry.pointer->children[entry.index].size + edge.pending;
+	}
+
+	// Link a new leaf after the back leaf, the full nodes along the spine
+	// are kept as they are rather than split
+
+	void grow_back(node_t node)
+	{
+		flush();
+		back_.leaf = storage_.leaf(node.pointer);
+		root_.size += node.size;
+
+		for (std::size_t level = 0; level != height_; ++level)
+		{
+			auto & entry = back_.path[level];
+			if (entry.index + 1 != maximum_branch_size)
+			{
+				entry.pointer->children[++entry.index] = node;
+				for (auto I = level + 1; I != height_; ++I)
+				{
+					auto & above = back_.path[I];
+					above.pointer->children[above.index].size += node.size;
+				}
+				return;
+			}
+
+			// No room, start a new branch holding only this node
+			auto link = storage_.make_branch();
+			auto branch = storage_.branch(link);
+			branch->children[0] = node;
+			entry = {0, branch};
+			node.pointer = link;
+		}
+
+		// We have reached the root, grow upward
+		auto link = storage_.make_branch();
+		auto branch = storage_.branch(link);
+		branch->children[0] = make_node(root_.size - node.size, root_.pointer);
+		branch->children[1] = node;
+		root_.pointer = link;
+		back_.path[height_] = {1, branch};
+		height_++;
+		front_.valid = false;
+	}
 
-			// If we have room for the child we are done
-			if (sum <= maximum_branch_size)
+	void grow_front(node_t node)
+	{
+		flush();
+		front_.leaf = storage_.leaf(node.pointer);
+		root_.size += node.size;
+
+		for (std::size_t level = 0; level != height_; ++level)
+		{
+			auto & entry = front_.path[level];
+			auto top = level + 1 == height_;
+			auto size = top ? root_.size - node.size : front_.path[level + 1].pointer->children[0].size;
+			auto length = get_length(entry.pointer, size);
+			if (length != maximum_branch_size)
 			{
-				merge(entry.index + 1, entry.pointer->children, branch_length, right_node);
-				update_sizes(first, last);
+				merge(0, entry.pointer->children, length, node);
+				for (auto I = level + 1; I != height_; ++I)
+				{
+					front_.path[I].pointer->children[0].size += node.size;
+				}
+				if (top && back_.valid) ++back_.path[level].index;
 				return;
 			}
 
-			// No room, split into 2 and insert the first half in the parent
-			auto left_length = sum / 2;
-			auto right_length = sum - left_length;
-			auto right = new branch_t;
-			split(
-				entry.index + 1,
-				left_length, right_length, right->children,
-				entry.pointer->children, branch_length,
-				right_node);
-			std::size_t right_size = 0;
-			for (std::size_t I = 0; I != right_length; ++I) right_size += right->children[I].size;
-			right_node = {right_size, right};
-			left_size = entry.size + 1 - right_size;
+			// No room, start a new branch holding only this node
+			auto link = storage_.make_branch();
+			auto branch = storage_.branch(link);
+			branch->children[0] = node;
+			entry = {0, branch};
+			node.pointer = link;
 		}
 
 		// We have reached the root, grow upward
-		auto branch = new branch_t;
-		branch->children[0].pointer = root_.pointer;
-		branch->children[0].size = left_size;
-		branch->children[1] = right_node;
-		root_.pointer = branch;
-		root_.size = left_size + right_node.size;
+		auto link = storage_.make_branch();
+		auto branch = storage_.branch(link);
+		branch->children[0] = node;
+		branch->children[1] = make_node(root_.size - node.size, root_.pointer);
+		root_.pointer = link;
+		front_.path[height_] = {0, branch};
 		height_++;
+		back_.valid = false;
+	}
+
+	// Remove roots that are left with a single child
+
+	void shrink()
+	{
+		while (height_ != 0)
+		{
+			auto link = root_.pointer;
+			auto branch = storage_.branch(link);
+			if (branch->children[0].size != root_.size) return;
+			root_.pointer = branch->children[0].pointer;
+			storage_.free_branch(link);
+			height_--;
+			front_.valid = false;
+			back_.valid = false;
+		}
+	}
+
+	// Append elements to a level of leaves holding up to per_leaf each
+
+	static void append(
+		storage_t & storage, std::vector<node_t> & leaves, std::size_t per_leaf,
+		T const * data, std::size_t size)
+	{
+		while (size != 0)
+		{
+			if (leaves.empty() || leaves.back().size == per_leaf)
+			{
+				leaves.push_back(make_node(0, storage.make_leaf()));
+			}
+
+			auto & leaf = leaves.back();
+			auto count = per_leaf - leaf.size < size ? per_leaf - leaf.size : size;
+			std::char_traits<T>::copy(storage.leaf(leaf.pointer)->buffer + leaf.size, data, count);
+			leaf.size += count;
+			data += count;
+			size -= count;
+		}
+	}
+
+	// Link a level of nodes into branches of up to per_branch children, one
+	// level at a time, until a single root is left
+
+	static void link_levels(
+		storage_t & storage, std::vector<node_t> & level, std::size_t per_branch,
+		node_t & root, std::size_t & height)
+	{
+		height = 0;
+		while (level.size() > 1)
+		{
+			std::vector<node_t> parents;
+			for (std::size_t offset = 0; offset < level.size(); offset += per_branch)
+			{
+				auto count = level.size() - offset < per_branch ? level.size() - offset : per_branch;
+				auto link = storage.make_branch();
+				std::size_t sum = 0;
+				for (std::size_t I = 0; I != count; ++I)
+				{
+					storage.branch(link)->children[I] = level[offset + I];
+					sum += level[offset + I].size;
+				}
+				parents.push_back(make_node(sum, link));
+			}
+			level.swap(parents);
+			++height;
+		}
+
+		root = level.empty() ? make_node(0, storage.make_leaf()) : level[0];
+	}
+
+	// Replace the tree with one built bottom-up over data, every node is
+	// full except the last one on each level
+
+	void build(T const * data, std::size_t size)
+	{
+		std::vector<node_t> level;
+		append(storage_, level, maximum_leaf_size, data, size);
+		link_levels(storage_, level, maximum_branch_size, root_, height_);
+	}
+
+	// Take a fill factor for nodes of the given capacity, never going below
+	// the minimum that the stack size is computed for
+
+	static std::size_t fill(std::size_t maximum, std::size_t minimum, double factor)
+	{
+		auto count = static_cast<std::size_t>(maximum * factor);
+		return count < minimum ? minimum : count > maximum ? maximum : count;
+	}
+
+	void abandon_compaction()
+	{
+		for (auto leaf : compaction_.leaves) compaction_.storage->free_leaf(leaf.pointer);
+		compaction_.storage.reset();
+		compaction_.leaves.clear();
+	}
+
+	void start_compaction(std::size_t per_leaf, std::size_t per_branch)
+	{
+		auto leaves = (size() + per_leaf - 1) / per_leaf;
+		std::size_t branches = 0;
+		for (auto count = leaves; count > 1; branches += count) count = (count + per_branch - 1) / per_branch;
+
+		compaction_.storage.reset(new storage_t);
+		compaction_.storage->reserve(branches, leaves);
+		compaction_.leaves.reserve(leaves);
+		compaction_.done = 0;
+		compaction_.per_leaf = per_leaf;
+		compaction_.per_branch = per_branch;
+		compaction_.version = version_;
+	}
+
+	// Find with one contiguous range per thread, match_run is called as
+	// in find. A thread gives up as soon as a match is known in an earlier
+	// range, so the result is still the first match in sequence order
+
+	template<typename Match>
+	std::size_t parallel_find_match(Match match_run, std::size_t threads) const
+	{
+		if (size() == 0) return 0;
+		threads = parallel_detail::thread_count(threads);
+		if (size() < threads * maximum_leaf_size) threads = 1;
+
+		std::atomic<std::size_t> best(size());
+		parallel_detail::parallel_for(threads, [&](std::size_t I)
+		{
+			auto first = size() / threads * I;
+			auto last = I + 1 == threads ? size() : size() / threads * (I + 1);
+			bool abandoned = false;
+			auto match = [&](T const * data, std::size_t size)
+			{
+				if (best.load(std::memory_order_relaxed) < first)
+				{
+					abandoned = true;
+					return std::size_t{0};
+				}
+				return match_run(data, size);
+			};
+
+			auto found = find(root_, height_, first, last, match);
+			if (abandoned || found == last) return;
+			auto current = best.load();
+			while (found < current && !best.compare_exchange_weak(current, found)) {}
+		});
+		return best;
+	}
+
+	// Count with one contiguous range per thread, count_run(data, size)
+	// returns the number of matches in a run
+
+	template<typename Count>
+	std::size_t parallel_count_match(Count count_run, std::size_t threads) const
+	{
+		threads = parallel_detail::thread_count(threads);
+		if (size() < threads * maximum_leaf_size) threads = 1;
+		if (size() == 0) return 0;
+
+		std::vector<std::size_t> counts(threads);
+		parallel_detail::parallel_for(threads, [&](std::size_t I)
+		{
+			auto first = size() / threads * I;
+			auto last = I + 1 == threads ? size() : size() / threads * (I + 1);
+			auto match = [&](T const * data, std::size_t size)
+			{
+				counts[I] += count_run(data, size);
+				return size;
+			};
+			find(root_, height_, first, last, match);
+		});
+
+		std::size_t count = 0;
+		for (auto part : counts) count += part;
+		return count;
+	}
+
+	// Each thread copies a run of whole leaves out and sorts it, the sorted
+	// runs are merged pairwise with the merges of a round done in parallel,
+	// and the tree is rebuilt from the result with packed leaves
+
+	template<typename Compare>
+	void sort(Compare compare, std::size_t threads, bool stable)
+	{
+		if (size() < 2) return;
+		release_edges();
+		++version_;
+
+		std::vector<std::pair<T const *, std::size_t>> leaves;
+		iterate(root_, height_, [&](T const * data, std::size_t size)
+		{
+			leaves.emplace_back(data, size);
+		});
+
+		threads = std::min(parallel_detail::thread_count(threads), leaves.size());
+		std::vector<std::size_t> firsts(threads + 1);
+		std::vector<std::size_t> bounds(threads + 1);
+		for (std::size_t I = 0, leaf = 0, offset = 0; I != threads + 1; ++I)
+		{
+			auto first = leaves.size() * I / threads;
+			for (; leaf != first; ++leaf) offset += leaves[leaf].second;
+			firsts[I] = first;
+			bounds[I] = offset;
+		}
+
+		std::vector<T> buffer(size());
+		parallel_detail::parallel_for(threads, [&](std::size_t I)
+		{
+			auto out = buffer.data() + bounds[I];
+			for (auto leaf = firsts[I]; leaf != firsts[I + 1]; ++leaf)
+			{
+				std::char_traits<T>::copy(out, leaves[leaf].first, leaves[leaf].second);
+				out += leaves[leaf].second;
+			}
+			auto first = buffer.begin() + bounds[I];
+			auto last = buffer.begin() + bounds[I + 1];
+			if (stable) std::stable_sort(first, last, compare);
+			else std::sort(first, last, compare);
+		});
+
+		std::vector<T> scratch(threads > 1 ? size() : 0);
+		if (parallel_detail::merge_runs(buffer.data(), scratch.data(), bounds, compare) != buffer.data()) buffer.swap(scratch);
+
+		delete_node(root_, height_);
+		build(buffer.data(), buffer.size());
 	}
 
 public:
 	btree_array_t()
 	:
-		root_{0, nullptr},
-		height_{0}
+		front_(),
+		back_(),
+		version_{0},
+		compaction_()
 	{}
 
 	~btree_array_t()
 	{
+		// The arena releases its chunks wholesale
+		if (compact_nodes) return;
+		if (compaction_.storage) abandon_compaction();
+		flush();
 		delete_node(root_, height_);
 	}
 
 	void insert(std::size_t index, T value)
 	{
-		if (root_.pointer == nullptr) root_.pointer = new leaf_t;
+		++version_;
+		if (root_.pointer == link_t()) root_.pointer = storage_.make_leaf();
+		release_edges();
 		branch_entry_t stack[stack_size];
-		auto entry = seek(stack, stack + height_, root_, index);
+		auto entry = seek(stack, stack + height_, index);
 		insert(stack, stack + height_, value, entry);
 	}
 
+	// Appending and removing at either end reuses a cached path to the edge
+	// leaf and only updates the sizes above it once per leaf, so these are
+	// amortized O(1)
+
+	void push_back(T value)
+	{
+		++version_;
+		if (root_.pointer == link_t()) root_.pointer = storage_.make_leaf();
+		if (!back_.valid) cache_back();
+
+		auto size = edge_size(back_);
+		if (size != maximum_leaf_size)
+		{
+			back_.leaf->buffer[size] = value;
+			++back_.pending;
+			++root_.size;
+			return;
+		}
+
+		// The back leaf is full, start a new one rather than splitting it
+		auto link = storage_.make_leaf();
+		storage_.leaf(link)->buffer[0] = value;
+		grow_back(make_node(1, link));
+	}
+
+	void push_front(T value)
+	{
+		++version_;
+		if (root_.pointer == link_t()) root_.pointer = storage_.make_leaf();
+		if (!front_.valid) cache_front();
+
+		auto size = edge_size(front_);
+		if (size != maximum_leaf_size)
+		{
+			merge(0, front_.leaf->buffer, size, value);
+			++front_.pending;
+			++root_.size;
+			return;
+		}
+
+		// The front leaf is full, start a new one rather than splitting it
+		auto link = storage_.make_leaf();
+		storage_.leaf(link)->buffer[0] = value;
+		grow_front(make_node(1, link));
+	}
+
+	void pop_back()
+	{
+		assert(size() != 0);
+		++version_;
+		if (!back_.valid) cache_back();
+
+		if (height_ == 0 || edge_size(back_) != 1)
+		{
+			--back_.pending;
+			--root_.size;
+			return;
+		}
+
+		// The back leaf becomes empty, unlink it and any branch left empty
+		flush();
+		std::size_t level = 0;
+		storage_.free_leaf(child_link(back_, level));
+		while (back_.path[level].index == 0)
+		{
+			++level;
+			storage_.free_branch(child_link(back_, level));
+		}
+		for (auto I = level + 1; I != height_; ++I)
+		{
+			auto & above = back_.path[I];
+			--above.pointer->children[above.index].size;
+		}
+		--root_.size;
+		back_.valid = false;
+		shrink();
+	}
+
+	void pop_front()
+	{
+		assert(size() != 0);
+		++version_;
+		if (!front_.valid) cache_front();
+
+		auto size = edge_size(front_);
+		if (height_ == 0 || size != 1)
+		{
+			std::char_traits<T>::move(front_.leaf->buffer, front_.leaf->buffer + 1, size - 1);
+			--front_.pending;
+			--root_.size;
+			return;
+		}
+
+		// The front leaf becomes empty, unlink it and any branch left empty
+		flush();
+		std::size_t level = 0;
+		storage_.free_leaf(child_link(front_, level));
+		while (true)
+		{
+			auto branch = front_.path[level].pointer;
+			auto top = level + 1 == height_;
+			auto size = top ? root_.size : front_.path[level + 1].pointer->children[0].size;
+			if (size != 1)
+			{
+				auto length = get_length(branch, size);
+				std::char_traits<node_t>::move(branch->children, branch->children + 1, length - 1);
+				if (top && back_.valid) --back_.path[level].index;
+				break;
+			}
+			++level;
+			storage_.free_branch(child_link(front_, level));
+		}
+		for (auto I = level + 1; I != height_; ++I)
+		{
+			--front_.path[I].pointer->children[0].size;
+		}
+		--root_.size;
+		front_.valid = false;
+		shrink();
+	}
+
+	T front() const
+	{
+		assert(size() != 0);
+		if (!front_.valid) return get(0);
+		return front_.leaf->buffer[0];
+	}
+
+	T back() const
+	{
+		assert(size() != 0);
+		if (!back_.valid) return get(size() - 1);
+		return back_.leaf->buffer[edge_size(back_) - 1];
+	}
+
+	T get(std::size_t index) const
+	{
+		assert(index < size());
+		auto node = root_;
+		for (auto height = height_; height != 0; --height)
+		{
+			auto branch = storage_.branch(node.pointer);
+			std::size_t branch_index = 0;
+			while (index >= child_size(branch, branch_index, height))
+			{
+				index -= child_size(branch, branch_index, height);
+				++branch_index;
+			}
+			node = branch->children[branch_index];
+		}
+		return storage_.leaf(node.pointer)->buffer[index];
+	}
+
+	// Set out[I] to the element at indices[I] for every I in [0, count).
+	// The descents are interleaved, each one moves down a level and
+	// prefetches the next node before the others take their turn, so the
+	// cache misses of independent lookups overlap
+
+	void get_batch(std::size_t const * indices, std::size_t count, T * out) const
+	{
+		lookup_t lookups[batch_width];
+		std::size_t next = 0;
+		std::size_t active = 0;
+		auto start = [&](lookup_t & lookup)
+		{
+			if (next == count) return false;
+			assert(indices[next] < size());
+			lookup.pointer = root_.pointer;
+			lookup.index = indices[next];
+			lookup.height = height_;
+			lookup.slot = next++;
+			return true;
+		};
+
+		while (active != batch_width && start(lookups[active])) ++active;
+		while (active != 0)
+		{
+			for (std::size_t I = 0; I < active;)
+			{
+				auto & lookup = lookups[I];
+				if (lookup.height == 0)
+				{
+					out[lookup.slot] = storage_.leaf(lookup.pointer)->buffer[lookup.index];
+					if (!start(lookup)) lookup = lookups[--active];
+					continue;
+				}
+
+				auto branch = storage_.branch(lookup.pointer);
+				std::size_t branch_index = 0;
+				while (lookup.index >= child_size(branch, branch_index, lookup.height))
+				{
+					lookup.index -= child_size(branch, branch_index, lookup.height);
+					++branch_index;
+				}
+				lookup.pointer = branch->children[branch_index].pointer;
+				if (--lookup.height == 0)
+				{
+					prefetch(storage_.leaf(lookup.pointer)->buffer + lookup.index, sizeof(T));
+				}
+				else
+				{
+					prefetch(storage_.branch(lookup.pointer), sizeof(branch_t));
+				}
+				++I;
+			}
+		}
+	}
+
+	// Like get_batch for indices in ascending order, repeats allowed. The
+	// tree is walked once from left to right, so each touched node is read
+	// once however many of the indices fall in it
+
+	void gather(std::size_t const * indices, std::size_t count, T * out) const
+	{
+		if (count == 0) return;
+		assert(indices[count - 1] < size());
+		gather(root_, height_, 0, indices, indices + count, out);
+	}
+
+	// Popping the last element keeps the root leaf, so test the size
+	// rather than the root
+
 	template<typename Functor>
 	void iterate(Functor functor) const
 	{
+		if (size() == 0) return;
 		iterate(root_, height_, functor);
 	}
 
+	// Searches return the index of the first match at or after from, or
+	// size() if there is none
+
+	std::size_t find(T value, std::size_t from = 0) const
+	{
+		auto match = [&](T const * data, std::size_t size)
+		{
+			return find_in(data, size, value);
+		};
+		if (from >= size()) return size();
+		return find(root_, height_, from, size(), match);
+	}
+
+	template<typename Predicate>
+	std::size_t find_if(Predicate predicate, std::size_t from = 0) const
+	{
+		auto match = [&](T const * data, std::size_t size)
+		{
+			std::size_t index = 0;
+			while (index != size && !predicate(data[index])) ++index;
+			return index;
+		};
+		if (from >= size()) return size();
+		return find(root_, height_, from, size(), match);
+	}
+
+	std::size_t count(T value) const
+	{
+		std::size_t count = 0;
+		iterate([&](T const * data, std::size_t size)
+		{
+			count += count_in(data, size, value);
+		});
+		return count;
+	}
+
+	template<typename Predicate>
+	std::size_t count_if(Predicate predicate) const
+	{
+		std::size_t count = 0;
+		iterate([&](T const * data, std::size_t size)
+		{
+			for (std::size_t index = 0; index != size; ++index) count += predicate(data[index]) ? 1 : 0;
+		});
+		return count;
+	}
+
+	// Split the work between threads threads, 0 means one per processor
+	// and 1 the calling thread alone
+
+	std::size_t parallel_find(T value, std::size_t threads = 0) const
+	{
+		return parallel_find_match([&](T const * data, std::size_t size)
+		{
+			return find_in(data, size, value);
+		}, threads);
+	}
+
+	template<typename Predicate>
+	std::size_t parallel_find_if(Predicate predicate, std::size_t threads = 0) const
+	{
+		return parallel_find_match([&](T const * data, std::size_t size)
+		{
+			std::size_t index = 0;
+			while (index != size && !predicate(data[index])) ++index;
+			return index;
+		}, threads);
+	}
+
+	std::size_t parallel_count(T value, std::size_t threads = 0) const
+	{
+		return parallel_count_match([&](T const * data, std::size_t size)
+		{
+			return count_in(data, size, value);
+		}, threads);
+	}
+
+	template<typename Predicate>
+	std::size_t parallel_count_if(Predicate predicate, std::size_t threads = 0) const
+	{
+		return parallel_count_match([&](T const * data, std::size_t size)
+		{
+			std::size_t count = 0;
+			for (std::size_t index = 0; index != size; ++index) count += predicate(data[index]) ? 1 : 0;
+			return count;
+		}, threads);
+	}
+
+	// Rewrite the tree into new nodes allocated in sequence order, with
+	// leaves and branches filled to fill_factor of their capacity. A fill
+	// factor below one half is taken as one half
+
+	void compact(double fill_factor = 1.0)
+	{
+		compact_step(std::numeric_limits<std::size_t>::max(), fill_factor);
+	}
+
+	// Do the same in slices that copy up to budget elements each, the new
+	// tree replaces the old one in the call that returns true. Changing the
+	// array between calls restarts the pass
+
+	bool compact_step(std::size_t budget, double fill_factor = 1.0)
+	{
+		if (size() == 0) return true;
+
+		auto per_leaf = fill(maximum_leaf_size, minimum_leaf_size, fill_factor);
+		auto per_branch = fill(maximum_branch_size, minimum_branch_size, fill_factor);
+		if (compaction_.storage)
+		{
+			if (compaction_.version != version_ ||
+				compaction_.per_leaf != per_leaf ||
+				compaction_.per_branch != per_branch)
+			{
+				abandon_compaction();
+			}
+		}
+		if (!compaction_.storage) start_compaction(per_leaf, per_branch);
+
+		flush();
+		auto first = compaction_.done;
+		auto last = size() - first < budget ? size() : first + budget;
+		auto copy = [&](T const * data, std::size_t size)
+		{
+			append(*compaction_.storage, compaction_.leaves, per_leaf, data, size);
+			return size;
+		};
+		find(root_, height_, first, last, copy);
+		compaction_.done = last;
+		if (last != size()) return false;
+
+		// Everything is copied, swap in the new tree
+		release_edges();
+		node_t root;
+		std::size_t height;
+		link_levels(*compaction_.storage, compaction_.leaves, per_branch, root, height);
+		if (!compact_nodes) delete_node(root_, height_);
+		std::swap(storage_, *compaction_.storage);
+		root_ = root;
+		height_ = height;
+		compaction_.storage.reset();
+		compaction_.leaves.clear();
+		++version_;
+		return true;
+	}
+
+	// Sort with threads threads as in parallel_find
+
+	template<typename Compare = std::less<T>>
+	void sort(Compare compare = Compare(), std::size_t threads = 0)
+	{
+		sort(compare, threads, false);
+	}
+
+	template<typename Compare = std::less<T>>
+	void stable_sort(Compare compare = Compare(), std::size_t threads = 0)
+	{
+		sort(compare, threads, true);
+	}
+
 	std::size_t size() const
 	{
 		return root_.size;
 	}
 };
 
+template<
+	typename T,
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 512>
+using btree_compact_array_t = btree_array_t<
+	T,
+	target_branch_size,
+	target_leaf_size,
+	std::numeric_limits<std::uint32_t>::max(),
+	true>;
@@ -0,0 +1,478 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "detail/btree_tree.hpp"
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+namespace btree_detail
+{
+
+// Every link also counts the ones below it
+
+struct bit_node_t
+{
+	typedef void * link_t;
+
+	std::size_t size;
+	std::size_t ones;
+	void * pointer;
+};
+
+template<std::size_t target_branch_size, std::size_t target_leaf_size, std::size_t maximum_size>
+struct bit_policy_t : basic_policy_t<bit_node_t>
+{
+	typedef bit_node_t node_t;
+	typedef std::uint64_t word_t;
+
+	static std::size_t constexpr word_bits = 64;
+	static std::size_t constexpr maximum_branch_size = target_branch_size  / sizeof(node_t);
+	static std::size_t constexpr maximum_leaf_words = target_leaf_size / sizeof(word_t);
+	static std::size_t constexpr maximum_leaf_size = maximum_leaf_words * word_bits;
+
+	// Erasing can leave nodes below half full, only those below a quarter
+	// are merged with a sibling
+
+	static std::size_t constexpr minimum_branch_size = maximum_branch_size / 4;
+	static std::size_t constexpr minimum_leaf_size = maximum_leaf_size / 4;
+	static std::size_t constexpr stack_size = log(maximum_size / minimum_leaf_size, minimum_branch_size) + 1;
+
+	typedef basic_branch_t<node_t, maximum_branch_size> branch_t;
+
+	// Bits past the size of a leaf are zero up to the end of their word
+
+	struct leaf_t
+	{
+		word_t words[maximum_leaf_words];
+	};
+
+	typedef btree_heap_storage_t<branch_t, leaf_t> storage_t;
+
+	static node_t make_node(std::size_t size, std::size_t ones, void * pointer)
+	{
+		node_t node = {size, ones, pointer};
+		return node;
+	}
+
+	static node_t make_node(std::size_t size, void * pointer)
+	{
+		return make_node(size, 0, pointer);
+	}
+
+	static void add(node_t & node, node_t const & delta)
+	{
+		node.size += delta.size;
+		node.ones += delta.ones;
+	}
+
+	static node_t sum(node_t const * nodes, std::size_t length, void * pointer)
+	{
+		auto node = make_node(0, 0, pointer);
+		for (std::size_t I = 0; I != length; ++I) add(node, nodes[I]);
+		return node;
+	}
+};
+
+}
+
+// A dynamic bit vector shaped like btree_array_t. Leaves pack bits into
+// 64-bit words and every child link also counts the ones below it, so
+// rank and select descend like a positional lookup and finish with
+// popcount kernels inside a single leaf. Within a word select uses pdep
+// when BMI2 is enabled at compile time (-mbmi2, or a -march that has it)
+// and a portable loop otherwise
+
+template<
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 512,
+	std::size_t maximum_size = std::numeric_limits<std::size_t>::max()>
+class btree_bit_vector_t
+:
+	private btree_detail::tree_t<btree_detail::bit_policy_t<target_branch_size, target_leaf_size, maximum_size>>
+{
+private:
+	typedef btree_detail::bit_policy_t<target_branch_size, target_leaf_size, maximum_size> policy_t;
+	typedef btree_detail::tree_t<policy_t> tree_t;
+	typedef typename tree_t::node_t node_t;
+	typedef typename tree_t::branch_t branch_t;
+	typedef typename tree_t::leaf_t leaf_t;
+	typedef typename tree_t::branch_entry_t branch_entry_t;
+	typedef typename policy_t::word_t word_t;
+
+	using tree_t::maximum_branch_size;
+	using tree_t::stack_size;
+	static std::size_t constexpr word_bits = policy_t::word_bits;
+	static std::size_t constexpr maximum_leaf_words = policy_t::maximum_leaf_words;
+	static std::size_t constexpr maximum_leaf_size = policy_t::maximum_leaf_size;
+	static std::size_t constexpr minimum_branch_size = policy_t::minimum_branch_size;
+	static std::size_t constexpr minimum_leaf_size = policy_t::minimum_leaf_size;
+
+	static_assert(maximum_branch_size >= 8, "maximum_branch_size must be at least 8");
+	static_assert(maximum_leaf_words >= 4, "maximum_leaf_words must be at least 4");
+
+	using tree_t::storage_;
+	using tree_t::root_;
+	using tree_t::height_;
+	using tree_t::get_length;
+	using tree_t::delete_node;
+	using tree_t::seek;
+	using tree_t::locate;
+	using tree_t::update_sizes;
+	using tree_t::insert_sibling;
+
+	static std::size_t popcount(word_t word)
+	{
+		return __builtin_popcountll(word);
+	}
+
+	// Position of the set bit of word with rank index
+
+	static std::size_t select(word_t word, std::size_t index)
+	{
+#ifdef __BMI2__
+		return __builtin_ctzll(_pdep_u64(word_t{1} << index, word));
+#else
+		for (; index != 0; --index) word &= word - 1;
+		return __builtin_ctzll(word);
+#endif
+	}
+
+	static std::size_t word_count(std::size_t size)
+	{
+		return (size + word_bits - 1) / word_bits;
+	}
+
+	static std::size_t count_ones(word_t const * words, std::size_t size)
+	{
+		std::size_t ones = 0;
+		auto full = size / word_bits;
+		for (std::size_t I = 0; I != full; ++I) ones += popcount(words[I]);
+		if (size % word_bits != 0) ones += popcount(words[full] & ((word_t{1} << size % word_bits) - 1));
+		return ones;
+	}
+
+	static void insert_bit(word_t * words, std::size_t size, std::size_t index, bool bit)
+	{
+		auto word = index / word_bits;
+		auto last = size / word_bits;
+		if (size % word_bits == 0) words[last] = 0;
+
+		for (auto I = last; I != word; --I) words[I] = (words[I] << 1) | (words[I - 1] >> (word_bits - 1));
+
+		auto low = (word_t{1} << index % word_bits) - 1;
+		auto value = words[word];
+		words[word] = (value & low) | ((value & ~low) << 1) | (word_t{bit} << index % word_bits);
+	}
+
+	static bool erase_bit(word_t * words, std::size_t size, std::size_t index)
+	{
+		auto word = index / word_bits;
+		auto last = (size - 1) / word_bits;
+
+		auto low = (word_t{1} << index % word_bits) - 1;
+		auto value = words[word];
+		words[word] = (value & low) | ((value >> 1) & ~low);
+
+		for (auto I = word + 1; I <= last; ++I)
+		{
+			words[I - 1] |= words[I] << (word_bits - 1);
+			words[I] >>= 1;
+		}
+
+		return (value >> index % word_bits) & 1;
+	}
+
+	// Append size bits of source after the first offset bits of words
+
+	static void append_bits(word_t * words, std::size_t offset, word_t const * source, std::size_t size)
+	{
+		auto word = offset / word_bits;
+		auto shift = offset % word_bits;
+		auto count = word_count(size);
+
+		if (shift == 0)
+		{
+			std::char_traits<word_t>::copy(words + word, source, count);
+			return;
+		}
+
+		for (std::size_t I = 0; I != count; ++I)
+		{
+			words[word + I] |= source[I] << shift;
+			words[word + I + 1] = source[I] >> (word_bits - shift);
+		}
+	}
+
+	// Merge two neighbouring nodes or, if they do not fit in one, share
+	// their contents evenly. Returns true if right was merged into left
+
+	bool combine(node_t & left, node_t & right, std::size_t height)
+	{
+		if (height == 0)
+		{
+			auto left_leaf = storage_.leaf(left.pointer);
+			auto right_leaf = storage_.leaf(right.pointer);
+			word_t words[2 * maximum_leaf_words + 1];
+			auto total = left.size + right.size;
+			std::char_traits<word_t>::copy(words, left_leaf->words, word_count(left.size));
+			append_bits(words, left.size, right_leaf->words, right.size);
+
+			if (total <= maximum_leaf_size)
+			{
+				std::char_traits<word_t>::copy(left_leaf->words, words, word_count(total));
+				left.size = total;
+				left.ones += right.ones;
+				storage_.free_leaf(right.pointer);
+				return true;
+			}
+
+			auto left_words = word_count(total) / 2;
+			auto left_size = left_words * word_bits;
+			std::char_traits<word_t>::copy(left_leaf->words, words, left_words);
+			std::char_traits<word_t>::copy(right_leaf->words, words + left_words, word_count(total - left_size));
+			left.size = left_size;
+			right.size = total - left_size;
+			left.ones = count_ones(left_leaf->words, left.size);
+			right.ones = count_ones(right_leaf->words, right.size);
+			return false;
+		}
+
+		auto left_branch = storage_.branch(left.pointer);
+		auto right_branch = storage_.branch(right.pointer);
+		auto left_length = get_length(left_branch, left.size);
+		auto right_length = get_length(right_branch, right.size);
+		auto total = left_length + right_length;
+
+		if (total <= maximum_branch_size)
+		{
+			std::char_traits<node_t>::copy(left_branch->children + left_length, right_branch->children, right_length);
+			left.size += right.size;
+			left.ones += right.ones;
+			storage_.free_branch(right.pointer);
+			return true;
+		}
+
+		node_t nodes[2 * maximum_branch_size];
+		std::char_traits<node_t>::copy(nodes, left_branch->children, left_length);
+		std::char_traits<node_t>::copy(nodes + left_length, right_branch->children, right_length);
+		left_length = total / 2;
+		right_length = total - left_length;
+		std::char_traits<node_t>::copy(left_branch->children, nodes, left_length);
+		std::char_traits<node_t>::copy(right_branch->children, nodes + left_length, right_length);
+		left = policy_t::sum(left_branch->children, left_length, left.pointer);
+		right = policy_t::sum(right_branch->children, right_length, right.pointer);
+		return false;
+	}
+
+	// Walk up from the leaf fixing nodes that dropped below a quarter full
+
+	void rebalance(branch_entry_t * stack)
+	{
+		for (std::size_t level = 0; level != height_; ++level)
+		{
+			auto & entry = stack[level];
+			auto branch = entry.pointer;
+			auto & child = branch->children[entry.index];
+
+			auto underflow = level == 0
+				? child.size < minimum_leaf_size
+				: get_length(storage_.branch(child.pointer), child.size) < minimum_branch_size;
+			if (!underflow) break;
+
+			auto branch_size = level + 1 == height_
+				? root_.size
+				: stack[level + 1].pointer->children[stack[level + 1].index].size;
+			auto length = get_length(branch, branch_size);
+			if (length == 1) break;
+
+			auto index = entry.index == 0 ? 0 : entry.index - 1;
+			if (!combine(branch->children[index], branch->children[index + 1], level)) break;
+			std::char_traits<node_t>::move(
+				branch->children + index + 1,
+				branch->children + index + 2,
+				length - index - 2);
+		}
+
+		// Remove roots that are left with a single child
+		while (height_ != 0)
+		{
+			auto link = root_.pointer;
+			if (storage_.branch(link)->children[0].size != root_.size) break;
+			root_.pointer = storage_.branch(link)->children[0].pointer;
+			storage_.free_branch(link);
+			height_--;
+		}
+	}
+
+public:
+	btree_bit_vector_t()
+	{}
+
+	~btree_bit_vector_t()
+	{
+		if (root_.pointer != nullptr) delete_node(root_, height_);
+	}
+
+	btree_bit_vector_t(btree_bit_vector_t const &) = delete;
+	btree_bit_vector_t & operator=(btree_bit_vector_t const &) = delete;
+
+	void insert(std::size_t index, bool bit)
+	{
+		assert(index <= size());
+		if (root_.pointer == nullptr) root_.pointer = storage_.make_leaf();
+		branch_entry_t stack[stack_size];
+		auto entry = seek(stack, stack + height_, index);
+		auto leaf = entry.pointer;
+
+		// If we have room for the bit in this leaf, we are done
+		if (entry.size != maximum_leaf_size)
+		{
+			insert_bit(leaf->words, entry.size, entry.index, bit);
+			update_sizes(stack, stack + height_, policy_t::make_node(1, bit, nullptr));
+			return;
+		}
+
+		// No room, split on a word boundary and insert into one half
+		auto link = storage_.make_leaf();
+		auto right = storage_.leaf(link);
+		auto left_words = maximum_leaf_words / 2;
+		auto left_size = left_words * word_bits;
+		auto right_size = entry.size - left_size;
+		std::char_traits<word_t>::copy(right->words, leaf->words + left_words, maximum_leaf_words - left_words);
+
+		if (entry.index <= left_size)
+		{
+			insert_bit(leaf->words, left_size, entry.index, bit);
+			++left_size;
+		}
+		else
+		{
+			insert_bit(right->words, right_size, entry.index - left_size, bit);
+			++right_size;
+		}
+
+		auto left_node = policy_t::make_node(left_size, count_ones(leaf->words, left_size), nullptr);
+		auto right_node = policy_t::make_node(right_size, count_ones(right->words, right_size), link);
+		insert_sibling(stack, stack + height_, left_node, right_node, policy_t::make_node(1, bit, nullptr));
+	}
+
+	void push_back(bool bit)
+	{
+		insert(size(), bit);
+	}
+
+	void erase(std::size_t index)
+	{
+		assert(index < size());
+		branch_entry_t stack[stack_size];
+		auto entry = seek(stack, stack + height_, index, true);
+		auto bit = erase_bit(entry.pointer->words, entry.size, entry.index);
+
+		for (std::size_t level = 0; level != height_; ++level)
+		{
+			auto & child = stack[level].pointer->children[stack[level].index];
+			--child.size;
+			child.ones -= bit;
+		}
+		--root_.size;
+		root_.ones -= bit;
+
+		rebalance(stack);
+	}
+
+	bool get(std::size_t index) const
+	{
+		assert(index < size());
+		auto entry = locate(index);
+		return (entry.pointer->words[entry.index / word_bits] >> entry.index % word_bits) & 1;
+	}
+
+	void set(std::size_t index, bool bit)
+	{
+		assert(index < size());
+		branch_entry_t stack[stack_size];
+		auto entry = seek(stack, stack + height_, index, true);
+		auto & word = entry.pointer->words[entry.index / word_bits];
+		auto mask = word_t{1} << entry.index % word_bits;
+		if (((word & mask) != 0) == bit) return;
+
+		word ^= mask;
+		for (std::size_t level = 0; level != height_; ++level)
+		{
+			auto & child = stack[level].pointer->children[stack[level].index];
+			child.ones += bit ? 1 : -1;
+		}
+		root_.ones += bit ? 1 : -1;
+	}
+
+	// Number of ones before index
+
+	std::size_t rank1(std::size_t index) const
+	{
+		assert(index <= size());
+		if (index == size()) return ones();
+
+		std::size_t rank = 0;
+		auto node = root_;
+		for (auto height = height_; height != 0; --height)
+		{
+			auto branch = storage_.branch(node.pointer);
+			std::size_t branch_index = 0;
+			while (index >= branch->children[branch_index].size)
+			{
+				index -= branch->children[branch_index].size;
+				rank += branch->children[branch_index].ones;
+				++branch_index;
+			}
+			node = branch->children[branch_index];
+		}
+
+		return rank + count_ones(storage_.leaf(node.pointer)->words, index);
+	}
+
+	// Position of the one with the given rank
+
+	std::size_t select1(std::size_t rank) const
+	{
+		assert(rank < ones());
+		std::size_t index = 0;
+		auto node = root_;
+		for (auto height = height_; height != 0; --height)
+		{
+			auto branch = storage_.branch(node.pointer);
+			std::size_t branch_index = 0;
+			while (rank >= branch->children[branch_index].ones)
+			{
+				rank -= branch->children[branch_index].ones;
+				index += branch->children[branch_index].size;
+				++branch_index;
+			}
+			node = branch->children[branch_index];
+		}
+
+		auto words = storage_.leaf(node.pointer)->words;
+		std::size_t word = 0;
+		while (rank >= popcount(words[word]))
+		{
+			rank -= popcount(words[word]);
+			++word;
+		}
+		return index + word * word_bits + select(words[word], rank);
+	}
+
+	std::size_t size() const
+	{
+		return root_.size;
+	}
+
+	std::size_t ones() const
+	{
+		return root_.ones;
+	}
+};
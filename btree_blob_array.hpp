@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "detail/btree_tree.hpp"
+
+// A read only view of the bytes of an element, standing in for
+// std::string_view which needs C++17. It is invalidated by any insert
+
+class btree_blob_view_t
+{
+private:
+	char const * data_;
+	std::size_t size_;
+
+public:
+	btree_blob_view_t(char const * data, std::size_t size)
+	:
+		data_{data},
+		size_{size}
+	{}
+
+	char const * data() const { return data_; }
+	std::size_t size() const { return size_; }
+	char const * begin() const { return data_; }
+	char const * end() const { return data_ + size_; }
+	std::string str() const { return std::string(data_, size_); }
+};
+
+namespace btree_detail
+{
+
+template<std::size_t target_branch_size, std::size_t target_leaf_size, std::size_t maximum_size>
+struct blob_policy_t : basic_policy_t<basic_node_t<std::size_t, void *>>
+{
+	typedef basic_node_t<std::size_t, void *> node_t;
+
+	typedef typename std::conditional<
+		target_leaf_size <= std::numeric_limits<std::uint16_t>::max(),
+		std::uint16_t,
+		std::uint32_t>::type offset_t;
+
+	static std::size_t constexpr maximum_branch_size = target_branch_size  / sizeof(node_t);
+	static std::size_t constexpr leaf_words = target_leaf_size / sizeof(offset_t);
+
+	// A leaf may hold a single element, so only branches bound the height
+
+	static std::size_t constexpr minimum_branch_size = (maximum_branch_size + 1) / 2;
+	static std::size_t constexpr stack_size = log(maximum_size, minimum_branch_size);
+
+	typedef basic_branch_t<node_t, maximum_branch_size> branch_t;
+
+	struct leaf_t
+	{
+		offset_t words[leaf_words];
+	};
+
+	typedef btree_heap_storage_t<branch_t, leaf_t> storage_t;
+};
+
+}
+
+// A btree_array_t of variable length byte strings. Each leaf is a slotted
+// page: the bytes of its elements are packed in order from the front and
+// a table of their end offsets grows from the back, so an element costs
+// its bytes plus one offset. Leaves split by bytes rather than by count
+
+template<
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 4096,
+	std::size_t maximum_size = std::numeric_limits<std::size_t>::max()>
+class btree_blob_array_t
+:
+	private btree_detail::tree_t<btree_detail::blob_policy_t<target_branch_size, target_leaf_size, maximum_size>>
+{
+private:
+	typedef btree_detail::blob_policy_t<target_branch_size, target_leaf_size, maximum_size> policy_t;
+	typedef btree_detail::tree_t<policy_t> tree_t;
+	typedef typename tree_t::node_t node_t;
+	typedef typename tree_t::leaf_t leaf_t;
+	typedef typename tree_t::branch_entry_t branch_entry_t;
+	typedef typename tree_t::leaf_entry_t leaf_entry_t;
+	typedef typename policy_t::offset_t offset_t;
+
+	using tree_t::stack_size;
+	static std::size_t constexpr leaf_words = policy_t::leaf_words;
+	static std::size_t constexpr leaf_bytes = leaf_words * sizeof(offset_t);
+
+	static_assert(leaf_bytes >= 64, "target_leaf_size must be at least 64");
+
+	// Halving a full leaf leaves room for any element of up to a quarter
+	// leaf, so one split is always enough to make room
+
+	static std::size_t constexpr maximum_element_size = leaf_bytes / 4 - sizeof(offset_t);
+
+	using tree_t::storage_;
+	using tree_t::root_;
+	using tree_t::height_;
+	using tree_t::make_node;
+	using tree_t::delete_node;
+	using tree_t::seek;
+	using tree_t::locate;
+	using tree_t::update_sizes;
+	using tree_t::insert_sibling;
+	using tree_t::visit_leaves;
+
+	static char * bytes(leaf_t * leaf)
+	{
+		return reinterpret_cast<char *>(leaf->words);
+	}
+
+	// End offset of element index, the table runs backward from the end
+
+	static offset_t & end(leaf_t * leaf, std::size_t index)
+	{
+		return leaf->words[leaf_words - 1 - index];
+	}
+
+	static std::size_t begin(leaf_t * leaf, std::size_t index)
+	{
+		return index != 0 ? end(leaf, index - 1) : 0;
+	}
+
+	// Bytes taken by the first count elements and their offsets
+
+	static std::size_t used(leaf_t * leaf, std::size_t count)
+	{
+		return begin(leaf, count) + count * sizeof(offset_t);
+	}
+
+	static btree_blob_view_t view(leaf_t * leaf, std::size_t index)
+	{
+		auto first = begin(leaf, index);
+		return btree_blob_view_t(bytes(leaf) + first, end(leaf, index) - first);
+	}
+
+	// Move the elements past the first half of the bytes of a leaf to a
+	// new leaf
+
+	void split_leaf(branch_entry_t * first, branch_entry_t * last, leaf_entry_t & entry)
+	{
+		auto leaf = entry.pointer;
+		auto half = used(leaf, entry.size) / 2;
+		std::size_t left_size = 1;
+		while (used(leaf, left_size) < half) ++left_size;
+
+		auto link = storage_.make_leaf();
+		auto right = storage_.leaf(link);
+		auto right_size = entry.size - left_size;
+		auto offset = begin(leaf, left_size);
+		std::memcpy(bytes(right), bytes(leaf) + offset, end(leaf, entry.size - 1) - offset);
+		for (std::size_t I = 0; I != right_size; ++I)
+		{
+			end(right, I) = end(leaf, left_size + I) - offset;
+		}
+		insert_sibling(first, last, make_node(left_size, nullptr), make_node(right_size, link), make_node(0, nullptr));
+	}
+
+public:
+	btree_blob_array_t()
+	{}
+
+	~btree_blob_array_t()
+	{
+		if (root_.pointer != nullptr) delete_node(root_, height_);
+	}
+
+	btree_blob_array_t(btree_blob_array_t const &) = delete;
+	btree_blob_array_t & operator=(btree_blob_array_t const &) = delete;
+
+	// Elements may be up to max_element_size() bytes long, a quarter of a
+	// leaf minus one offset, longer ones throw std::length_error and leave
+	// the array unchanged
+
+	void insert(std::size_t index, char const * data, std::size_t size)
+	{
+		assert(index <= this->size());
+		if (size > maximum_element_size) throw std::length_error("btree_blob_array_t element too long");
+		if (root_.pointer == nullptr) root_.pointer = storage_.make_leaf();
+
+		branch_entry_t stack[stack_size];
+		auto entry = seek(stack, stack + height_, index);
+		if (used(entry.pointer, entry.size) + size + sizeof(offset_t) > leaf_bytes)
+		{
+			split_leaf(stack, stack + height_, entry);
+			entry = seek(stack, stack + height_, index);
+		}
+
+		// Open a gap in the bytes and in the offset table
+		auto leaf = entry.pointer;
+		auto first = begin(leaf, entry.index);
+		auto last = begin(leaf, entry.size);
+		std::memmove(bytes(leaf) + first + size, bytes(leaf) + first, last - first);
+		std::memcpy(bytes(leaf) + first, data, size);
+		std::char_traits<offset_t>::move(
+			&end(leaf, entry.size),
+			&end(leaf, entry.size - 1),
+			entry.size - entry.index);
+		end(leaf, entry.index) = first + size;
+		for (auto I = entry.index + 1; I <= entry.size; ++I) end(leaf, I) += size;
+
+		update_sizes(stack, stack + height_, make_node(1, nullptr));
+	}
+
+	void insert(std::size_t index, std::string const & value)
+	{
+		insert(index, value.data(), value.size());
+	}
+
+	void push_back(char const * data, std::size_t size)
+	{
+		insert(this->size(), data, size);
+	}
+
+	void push_back(std::string const & value)
+	{
+		insert(size(), value.data(), value.size());
+	}
+
+	btree_blob_view_t get(std::size_t index) const
+	{
+		assert(index < size());
+		auto entry = locate(index);
+		return view(entry.pointer, entry.index);
+	}
+
+	// Call functor(view) for each element in order
+
+	template<typename Functor>
+	void iterate(Functor functor) const
+	{
+		if (root_.pointer == nullptr) return;
+		auto visit = [&](leaf_t * leaf, std::size_t size)
+		{
+			for (std::size_t index = 0; index != size; ++index) functor(view(leaf, index));
+		};
+		visit_leaves(root_, height_, visit);
+	}
+
+	std::size_t size() const
+	{
+		return root_.size;
+	}
+
+	static std::size_t constexpr max_element_size()
+	{
+		return maximum_element_size;
+	}
+};
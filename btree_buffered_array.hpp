@@ -0,0 +1,428 @@
+#pragma once
+
+#include <cassert>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "detail/btree_tree.hpp"
+
+namespace btree_detail
+{
+
+template<typename T, std::size_t target_branch_size, std::size_t target_leaf_size, std::size_t buffer_size, std::size_t maximum_size>
+struct buffered_policy_t : basic_policy_t<basic_node_t<std::size_t, void *>>
+{
+	typedef basic_node_t<std::size_t, void *> node_t;
+
+	// An insert of value at index, relative to the subtree of the branch
+	// holding it after all older messages of that branch are applied
+
+	struct message_t
+	{
+		std::size_t index;
+		T value;
+	};
+
+	static std::size_t constexpr maximum_branch_size = target_branch_size  / sizeof(node_t);
+	static std::size_t constexpr maximum_leaf_size = target_leaf_size / sizeof(T);
+	static std::size_t constexpr minimum_branch_size = maximum_branch_size / 2;
+	static std::size_t constexpr minimum_leaf_size = maximum_leaf_size / 2;
+	static std::size_t constexpr stack_size = log(maximum_size / minimum_leaf_size, minimum_branch_size) + 1;
+
+	struct branch_t
+	{
+		node_t children[maximum_branch_size];
+		std::size_t pending;
+		message_t buffer[buffer_size];
+	};
+
+	struct leaf_t
+	{
+		T buffer[maximum_leaf_size];
+	};
+
+	typedef btree_heap_storage_t<branch_t, leaf_t> storage_t;
+
+	// The size of a branch counts its pending inserts, its children do not
+
+	static std::size_t length(branch_t const * branch, std::size_t size)
+	{
+		return get_length(branch->children, size - branch->pending);
+	}
+};
+
+}
+
+// A write optimized relative of btree_array_t. Every branch keeps a small
+// buffer of pending positional inserts, an insert only lands in the root
+// buffer and a full buffer is pushed down a single level, so one descent
+// is shared by a whole buffer of inserts. Reads and iteration apply the
+// pending inserts on the fly
+
+template<
+	typename T,
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 512,
+	std::size_t buffer_size = 32,
+	std::size_t maximum_size = std::numeric_limits<std::size_t>::max()>
+class btree_buffered_array_t
+:
+	private btree_detail::tree_t<btree_detail::buffered_policy_t<T, target_branch_size, target_leaf_size, buffer_size, maximum_size>>
+{
+private:
+	static_assert(std::is_pod<T>::value, "T must be a pod");
+
+	typedef btree_detail::buffered_policy_t<T, target_branch_size, target_leaf_size, buffer_size, maximum_size> policy_t;
+	typedef btree_detail::tree_t<policy_t> tree_t;
+	typedef typename tree_t::node_t node_t;
+	typedef typename tree_t::branch_t branch_t;
+	typedef typename tree_t::leaf_t leaf_t;
+	typedef typename policy_t::message_t message_t;
+
+	using tree_t::maximum_branch_size;
+	using tree_t::stack_size;
+	static std::size_t constexpr maximum_leaf_size = policy_t::maximum_leaf_size;
+
+	static_assert(maximum_branch_size >= 4, "maximum_branch_size must be at least 4");
+	static_assert(maximum_leaf_size >= 2, "maximum_leaf_size must be at least 2");
+	static_assert(buffer_size >= 1, "buffer_size must be at least 1");
+
+	using tree_t::storage_;
+	using tree_t::root_;
+	using tree_t::height_;
+	using tree_t::get_length;
+	using tree_t::merge;
+	using tree_t::delete_node;
+
+	// Pending inserts of one branch in their final order, used to splice
+	// them into the stream of its children while iterating
+
+	struct splice_t
+	{
+		std::size_t count;
+		std::size_t next;
+		std::size_t position;
+		std::size_t indices[buffer_size];
+		T values[buffer_size];
+	};
+
+	std::size_t get_length(node_t node) const
+	{
+		return get_length(storage_.branch(node.pointer), node.size);
+	}
+
+	// Split the child at index in two, the parent must have room for
+	// another child
+
+	void split_child(branch_t * parent, std::size_t length, std::size_t index, std::size_t height)
+	{
+		auto & left = parent->children[index];
+		node_t right;
+
+		if (height == 0)
+		{
+			auto leaf = storage_.leaf(left.pointer);
+			right.pointer = storage_.make_leaf();
+			auto right_leaf = storage_.leaf(right.pointer);
+			auto left_size = left.size / 2;
+			right.size = left.size - left_size;
+			std::char_traits<T>::copy(right_leaf->buffer, leaf->buffer + left_size, right.size);
+			left.size = left_size;
+		}
+		else
+		{
+			auto branch = storage_.branch(left.pointer);
+			right.pointer = storage_.make_branch();
+			auto right_branch = storage_.branch(right.pointer);
+			auto branch_length = get_length(left);
+			auto left_length = branch_length / 2;
+			auto right_length = branch_length - left_length;
+			std::char_traits<node_t>::copy(
+				right_branch->children,
+				branch->children + left_length,
+				right_length);
+
+			std::size_t left_size = 0;
+			for (std::size_t I = 0; I != left_length; ++I) left_size += branch->children[I].size;
+			std::size_t right_size = left.size - branch->pending - left_size;
+
+			// Replay the messages in order to find which half each lands in
+			std::size_t pending = 0;
+			right_branch->pending = 0;
+			for (std::size_t I = 0; I != branch->pending; ++I)
+			{
+				auto message = branch->buffer[I];
+				if (message.index <= left_size)
+				{
+					branch->buffer[pending++] = message;
+					++left_size;
+				}
+				else
+				{
+					message.index -= left_size;
+					right_branch->buffer[right_branch->pending++] = message;
+					++right_size;
+				}
+			}
+			branch->pending = pending;
+
+			left.size = left_size;
+			right.size = right_size;
+		}
+
+		merge(index + 1, parent->children, length, right);
+	}
+
+	// Push the buffered messages of a branch down one level, stopping
+	// early if the branch runs out of room for new children. The branch
+	// must have room for at least one more child, so at least one message
+	// is always moved
+
+	void flush(node_t node, std::size_t height)
+	{
+		auto branch = storage_.branch(node.pointer);
+		auto length = get_length(node);
+		std::size_t done = 0;
+
+		while (done != branch->pending && length != maximum_branch_size)
+		{
+			auto message = branch->buffer[done++];
+
+			// Find the child, preferring the left one on a boundary
+			std::size_t index = 0;
+			while (message.index > branch->children[index].size)
+			{
+				message.index -= branch->children[index].size;
+				++index;
+			}
+
+			if (height == 1)
+			{
+				if (branch->children[index].size == maximum_leaf_size)
+				{
+					split_child(branch, length++, index, 0);
+					if (message.index > branch->children[index].size)
+					{
+						message.index -= branch->children[index].size;
+						++index;
+					}
+				}
+
+				auto & child = branch->children[index];
+				auto leaf = storage_.leaf(child.pointer);
+				merge(message.index, leaf->buffer, child.size, message.value);
+				++child.size;
+			}
+			else
+			{
+				auto child_branch = storage_.branch(branch->children[index].pointer);
+				if (child_branch->pending == buffer_size)
+				{
+					if (get_length(branch->children[index]) == maximum_branch_size)
+					{
+						split_child(branch, length++, index, height - 1);
+						if (message.index > branch->children[index].size)
+						{
+							message.index -= branch->children[index].size;
+							++index;
+						}
+						child_branch = storage_.branch(branch->children[index].pointer);
+					}
+					flush(branch->children[index], height - 1);
+				}
+
+				child_branch->buffer[child_branch->pending++] = message;
+				++branch->children[index].size;
+			}
+		}
+
+		std::char_traits<message_t>::move(
+			branch->buffer,
+			branch->buffer + done,
+			branch->pending - done);
+		branch->pending -= done;
+	}
+
+	// Make the root a branch with a single child, which is then split
+
+	void grow()
+	{
+		auto link = storage_.make_branch();
+		auto branch = storage_.branch(link);
+		branch->children[0] = root_;
+		branch->pending = 0;
+		root_.pointer = link;
+		split_child(branch, 1, 0, height_);
+		height_++;
+	}
+
+	// Pass a run of elements of the branch at height up to the next
+	// level, splicing in the pending inserts of that branch
+
+	template<typename Functor>
+	static void emit(
+		splice_t * splices, std::size_t height, std::size_t top,
+		T const * data, std::size_t size,
+		Functor & functor)
+	{
+		if (height > top)
+		{
+			functor(data, size);
+			return;
+		}
+
+		auto & splice = splices[height];
+		while (size != 0)
+		{
+			while (splice.next != splice.count && splice.indices[splice.next] == splice.position)
+			{
+				emit(splices, height + 1, top, splice.values + splice.next, 1, functor);
+				++splice.next;
+				++splice.position;
+			}
+
+			auto run = size;
+			if (splice.next != splice.count && splice.indices[splice.next] - splice.position < run)
+			{
+				run = splice.indices[splice.next] - splice.position;
+			}
+			emit(splices, height + 1, top, data, run, functor);
+			splice.position += run;
+			data += run;
+			size -= run;
+		}
+	}
+
+	template<typename Functor>
+	void iterate(
+		splice_t * splices, std::size_t top,
+		node_t node, std::size_t height,
+		Functor & functor) const
+	{
+		if (height == 0)
+		{
+			auto leaf = storage_.leaf(node.pointer);
+			emit(splices, 1, top, leaf->buffer, node.size, functor);
+			return;
+		}
+
+		// Work out where each pending insert ends up once all are applied
+		auto branch = storage_.branch(node.pointer);
+		auto & splice = splices[height];
+		splice.count = branch->pending;
+		splice.next = 0;
+		splice.position = 0;
+		for (std::size_t I = 0; I != branch->pending; ++I)
+		{
+			auto index = branch->buffer[I].index;
+			std::size_t J = I;
+			while (J != 0 && splice.indices[J - 1] >= index)
+			{
+				splice.indices[J] = splice.indices[J - 1] + 1;
+				splice.values[J] = splice.values[J - 1];
+				--J;
+			}
+			splice.indices[J] = index;
+			splice.values[J] = branch->buffer[I].value;
+		}
+
+		auto length = get_length(node);
+		for (std::size_t index = 0; index != length; ++index)
+		{
+			iterate(splices, top, branch->children[index], height - 1, functor);
+		}
+
+		// Inserts past the last child
+		while (splice.next != splice.count)
+		{
+			emit(splices, height + 1, top, splice.values + splice.next, 1, functor);
+			++splice.next;
+		}
+	}
+
+public:
+	btree_buffered_array_t()
+	{}
+
+	~btree_buffered_array_t()
+	{
+		if (root_.pointer != nullptr) delete_node(root_, height_);
+	}
+
+	btree_buffered_array_t(btree_buffered_array_t const &) = delete;
+	btree_buffered_array_t & operator=(btree_buffered_array_t const &) = delete;
+
+	void insert(std::size_t index, T value)
+	{
+		assert(index <= size());
+		if (root_.pointer == nullptr) root_.pointer = storage_.make_leaf();
+
+		if (height_ == 0)
+		{
+			if (root_.size != maximum_leaf_size)
+			{
+				auto leaf = storage_.leaf(root_.pointer);
+				merge(index, leaf->buffer, root_.size, value);
+				++root_.size;
+				return;
+			}
+			grow();
+		}
+
+		auto branch = storage_.branch(root_.pointer);
+		if (branch->pending == buffer_size)
+		{
+			if (get_length(root_) == maximum_branch_size)
+			{
+				grow();
+				branch = storage_.branch(root_.pointer);
+			}
+			flush(root_, height_);
+		}
+
+		branch->buffer[branch->pending++] = {index, value};
+		++root_.size;
+	}
+
+	T get(std::size_t index) const
+	{
+		assert(index < size());
+		auto node = root_;
+		for (auto height = height_; height != 0; --height)
+		{
+			auto branch = storage_.branch(node.pointer);
+
+			// Undo the pending inserts, newest first
+			for (auto I = branch->pending; I-- != 0;)
+			{
+				auto & message = branch->buffer[I];
+				if (index == message.index) return message.value;
+				if (index > message.index) --index;
+			}
+
+			std::size_t branch_index = 0;
+			while (index >= branch->children[branch_index].size)
+			{
+				index -= branch->children[branch_index].size;
+				++branch_index;
+			}
+			node = branch->children[branch_index];
+		}
+
+		return storage_.leaf(node.pointer)->buffer[index];
+	}
+
+	template<typename Functor>
+	void iterate(Functor functor) const
+	{
+		if (root_.pointer == nullptr) return;
+		splice_t splices[stack_size + 1];
+		iterate(splices, height_, root_, height_, functor);
+	}
+
+	std::size_t size() const
+	{
+		return root_.size;
+	}
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include "detail/btree_tree.hpp"
+
+// The width of a row of columns and whether every column is a pod
+
+template<typename... Ts>
+struct btree_row_t;
+
+template<>
+struct btree_row_t<>
+{
+	static std::size_t constexpr size = 0;
+	static bool constexpr pod = true;
+};
+
+template<typename T, typename... Ts>
+struct btree_row_t<T, Ts...>
+{
+	static std::size_t constexpr size = sizeof(T) + btree_row_t<Ts...>::size;
+	static bool constexpr pod = std::is_pod<T>::value && btree_row_t<Ts...>::pod;
+};
+
+namespace btree_detail
+{
+
+template<std::size_t target_branch_size, std::size_t target_leaf_size, typename... Ts>
+struct columns_policy_t : basic_policy_t<basic_node_t<std::size_t, void *>>
+{
+	typedef basic_node_t<std::size_t, void *> node_t;
+
+	static std::size_t constexpr maximum_branch_size = target_branch_size  / sizeof(node_t);
+	static std::size_t constexpr maximum_leaf_size = target_leaf_size / btree_row_t<Ts...>::size;
+	static std::size_t constexpr minimum_branch_size = (maximum_branch_size + 1) / 2;
+	static std::size_t constexpr minimum_leaf_size = (maximum_leaf_size + 1) / 2;
+	static std::size_t constexpr stack_size = log(
+		std::numeric_limits<std::size_t>::max() / minimum_leaf_size,
+		minimum_branch_size);
+
+	typedef basic_branch_t<node_t, maximum_branch_size> branch_t;
+
+	struct leaf_t
+	{
+		std::tuple<std::array<Ts, maximum_leaf_size>...> columns;
+	};
+
+	typedef btree_heap_storage_t<branch_t, leaf_t> storage_t;
+};
+
+}
+
+// A btree_array_t of rows whose leaves keep each column in its own array.
+// Inserts and splits shift all columns of a leaf together, while a scan
+// of one column only reads that column
+
+template<
+	std::size_t target_branch_size,
+	std::size_t target_leaf_size,
+	typename... Ts>
+class btree_basic_columns_t
+:
+	private btree_detail::tree_t<btree_detail::columns_policy_t<target_branch_size, target_leaf_size, Ts...>>
+{
+public:
+	typedef std::tuple<Ts...> row_t;
+
+	template<std::size_t K>
+	using column_t = typename std::tuple_element<K, row_t>::type;
+
+private:
+	static_assert(btree_row_t<Ts...>::pod, "every column must be a pod");
+
+	typedef btree_detail::columns_policy_t<target_branch_size, target_leaf_size, Ts...> policy_t;
+	typedef btree_detail::tree_t<policy_t> tree_t;
+	typedef typename tree_t::node_t node_t;
+	typedef typename tree_t::leaf_t leaf_t;
+	typedef typename tree_t::branch_entry_t branch_entry_t;
+
+	static std::size_t constexpr columns = sizeof...(Ts);
+	using tree_t::stack_size;
+	static std::size_t constexpr maximum_leaf_size = policy_t::maximum_leaf_size;
+
+	static_assert(columns >= 1, "there must be at least one column");
+	static_assert(maximum_leaf_size >= 2, "maximum_leaf_size must be at least 2");
+
+	template<std::size_t K>
+	using column_tag_t = std::integral_constant<std::size_t, K>;
+
+	using tree_t::storage_;
+	using tree_t::root_;
+	using tree_t::height_;
+	using tree_t::make_node;
+	using tree_t::merge;
+	using tree_t::split;
+	using tree_t::delete_node;
+	using tree_t::seek;
+	using tree_t::locate;
+	using tree_t::update_sizes;
+	using tree_t::insert_sibling;
+	using tree_t::visit_leaves;
+
+	template<std::size_t K>
+	static column_t<K> * column(leaf_t * leaf)
+	{
+		return std::get<K>(leaf->columns).data();
+	}
+
+	// Apply merge and split to every column of a leaf in turn
+
+	static void merge(std::size_t index, leaf_t * leaf, std::size_t size, row_t const & row, column_tag_t<columns>) {}
+
+	template<std::size_t K>
+	static void merge(std::size_t index, leaf_t * leaf, std::size_t size, row_t const & row, column_tag_t<K>)
+	{
+		merge(index, column<K>(leaf), size, std::get<K>(row));
+		merge(index, leaf, size, row, column_tag_t<K + 1>());
+	}
+
+	static void split(
+		std::size_t index,
+		std::size_t left_size, std::size_t right_size, leaf_t * right,
+		leaf_t * orig, std::size_t orig_size,
+		row_t const & row, column_tag_t<columns>)
+	{}
+
+	template<std::size_t K>
+	static void split(
+		std::size_t index,
+		std::size_t left_size, std::size_t right_size, leaf_t * right,
+		leaf_t * orig, std::size_t orig_size,
+		row_t const & row, column_tag_t<K>)
+	{
+		split(
+			index,
+			left_size, right_size, column<K>(right),
+			column<K>(orig), orig_size,
+			std::get<K>(row));
+		split(
+			index,
+			left_size, right_size, right,
+			orig, orig_size,
+			row, column_tag_t<K + 1>());
+	}
+
+	static void get(leaf_t * leaf, std::size_t index, row_t & row, column_tag_t<columns>) {}
+
+	template<std::size_t K>
+	static void get(leaf_t * leaf, std::size_t index, row_t & row, column_tag_t<K>)
+	{
+		std::get<K>(row) = column<K>(leaf)[index];
+		get(leaf, index, row, column_tag_t<K + 1>());
+	}
+
+public:
+	btree_basic_columns_t()
+	{}
+
+	~btree_basic_columns_t()
+	{
+		if (root_.pointer != nullptr) delete_node(root_, height_);
+	}
+
+	btree_basic_columns_t(btree_basic_columns_t const &) = delete;
+	btree_basic_columns_t & operator=(btree_basic_columns_t const &) = delete;
+
+	void insert(std::size_t index, Ts... values)
+	{
+		assert(index <= size());
+		if (root_.pointer == nullptr) root_.pointer = storage_.make_leaf();
+
+		row_t row(values...);
+		branch_entry_t stack[stack_size];
+		auto entry = seek(stack, stack + height_, index);
+		auto sum = entry.size + 1;
+
+		// If we have room for the data in this leaf, we are done
+		if (sum <= maximum_leaf_size)
+		{
+			merge(entry.index, entry.pointer, entry.size, row, column_tag_t<0>());
+			update_sizes(stack, stack + height_, make_node(1, nullptr));
+			return;
+		}
+
+		// No room, split into 2 and insert the first half in the parent
+		auto left_size = sum / 2;
+		auto right_size = sum - left_size;
+		auto link = storage_.make_leaf();
+		auto right = storage_.leaf(link);
+		split(
+			entry.index,
+			left_size, right_size, right,
+			entry.pointer, entry.size,
+			row, column_tag_t<0>());
+		insert_sibling(stack, stack + height_, make_node(left_size, nullptr), make_node(right_size, link), make_node(1, nullptr));
+	}
+
+	void push_back(Ts... values)
+	{
+		insert(size(), values...);
+	}
+
+	row_t get(std::size_t index) const
+	{
+		assert(index < size());
+		auto entry = locate(index);
+		row_t row;
+		get(entry.pointer, entry.index, row, column_tag_t<0>());
+		return row;
+	}
+
+	template<std::size_t K>
+	column_t<K> get(std::size_t index) const
+	{
+		assert(index < size());
+		auto entry = locate(index);
+		return column<K>(entry.pointer)[entry.index];
+	}
+
+	// Call functor(data, size) on consecutive runs of column K
+
+	template<std::size_t K, typename Functor>
+	void iterate_column(Functor functor) const
+	{
+		static_assert(K < columns, "no such column");
+		if (root_.pointer == nullptr) return;
+		auto visit = [&](leaf_t * leaf, std::size_t size)
+		{
+			functor(const_cast<column_t<K> const *>(column<K>(leaf)), size);
+		};
+		visit_leaves(root_, height_, visit);
+	}
+
+	std::size_t size() const
+	{
+		return root_.size;
+	}
+};
+
+// Leaves hold about as many bytes per column as a btree_array_t leaf
+
+template<typename... Ts>
+using btree_columns_t = btree_basic_columns_t<512, 512 * sizeof...(Ts), Ts...>;
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <cassert>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "detail/btree_tree.hpp"
+
+namespace btree_detail
+{
+
+template<typename T, std::size_t target_branch_size, std::size_t target_leaf_size, std::size_t maximum_size>
+struct handle_policy_t : basic_policy_t<basic_node_t<std::size_t, void *>>
+{
+	typedef basic_node_t<std::size_t, void *> node_t;
+	typedef std::size_t handle_t;
+
+	static std::size_t constexpr maximum_branch_size = target_branch_size  / sizeof(node_t);
+	static std::size_t constexpr maximum_leaf_size = target_leaf_size / sizeof(T);
+
+	// Erasing only drops empty nodes, so any node may be nearly empty
+
+	static std::size_t constexpr stack_size = log(maximum_size, 2);
+
+	struct branch_t
+	{
+		node_t children[maximum_branch_size];
+		branch_t * parent;
+	};
+
+	struct leaf_t
+	{
+		T buffer[maximum_leaf_size];
+		handle_t handles[maximum_leaf_size];
+		branch_t * parent;
+	};
+
+	typedef btree_heap_storage_t<branch_t, leaf_t> storage_t;
+
+	static void adopt(storage_t & storage, node_t const & node, std::size_t height, branch_t * parent)
+	{
+		if (height != 0)
+		{
+			storage.branch(node.pointer)->parent = parent;
+		}
+		else
+		{
+			storage.leaf(node.pointer)->parent = parent;
+		}
+	}
+};
+
+}
+
+// A btree_array_t that hands out a stable handle for every element. Each
+// leaf keeps the handle of every element it holds, a handle table maps
+// handles back to their leaf and offset, and nodes keep parent pointers,
+// so the current index of a handle is found by walking up to the root
+// and summing the sizes of left siblings
+
+template<
+	typename T,
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 512,
+	std::size_t maximum_size = std::numeric_limits<std::size_t>::max()>
+class btree_handle_array_t
+:
+	private btree_detail::tree_t<btree_detail::handle_policy_t<T, target_branch_size, target_leaf_size, maximum_size>>
+{
+public:
+	typedef std::size_t handle_t;
+
+private:
+	static_assert(std::is_pod<T>::value, "T must be a pod");
+
+	typedef btree_detail::handle_policy_t<T, target_branch_size, target_leaf_size, maximum_size> policy_t;
+	typedef btree_detail::tree_t<policy_t> tree_t;
+	typedef typename tree_t::node_t node_t;
+	typedef typename tree_t::branch_t branch_t;
+	typedef typename tree_t::leaf_t leaf_t;
+	typedef typename tree_t::branch_entry_t branch_entry_t;
+
+	using tree_t::stack_size;
+	static std::size_t constexpr maximum_leaf_size = policy_t::maximum_leaf_size;
+
+	static_assert(maximum_leaf_size >= 2, "maximum_leaf_size must be at least 2");
+
+	using tree_t::storage_;
+	using tree_t::root_;
+	using tree_t::height_;
+	using tree_t::make_node;
+	using tree_t::get_length;
+	using tree_t::merge;
+	using tree_t::split;
+	using tree_t::delete_node;
+	using tree_t::seek;
+	using tree_t::locate;
+	using tree_t::update_sizes;
+	using tree_t::insert_sibling;
+	using tree_t::visit_leaves;
+
+	// Where a handle lives, a released handle links to the next free one
+	// through index
+
+	struct slot_t
+	{
+		leaf_t * leaf;
+		std::size_t index;
+	};
+
+	static handle_t constexpr no_handle = std::numeric_limits<handle_t>::max();
+
+	std::vector<slot_t> slots_;
+	handle_t free_;
+
+	// Point the handles of the elements in [first, last) of a leaf at
+	// their current place
+
+	void place(leaf_t * leaf, std::size_t first, std::size_t last)
+	{
+		for (auto index = first; index != last; ++index)
+		{
+			auto & slot = slots_[leaf->handles[index]];
+			slot.leaf = leaf;
+			slot.index = index;
+		}
+	}
+
+	handle_t acquire()
+	{
+		if (free_ == no_handle)
+		{
+			slots_.push_back({nullptr, 0});
+			return slots_.size() - 1;
+		}
+
+		auto handle = free_;
+		free_ = slots_[handle].index;
+		return handle;
+	}
+
+	void release(handle_t handle)
+	{
+		slots_[handle].leaf = nullptr;
+		slots_[handle].index = free_;
+		free_ = handle;
+	}
+
+	// Find the link to a child in its parent, or the root
+
+	node_t & link_of(void * child, branch_t * parent)
+	{
+		if (parent == nullptr) return root_;
+		std::size_t index = 0;
+		while (parent->children[index].pointer != child) ++index;
+		return parent->children[index];
+	}
+
+public:
+	btree_handle_array_t()
+	:
+		free_{no_handle}
+	{}
+
+	~btree_handle_array_t()
+	{
+		if (root_.pointer != nullptr) delete_node(root_, height_);
+	}
+
+	btree_handle_array_t(btree_handle_array_t const &) = delete;
+	btree_handle_array_t & operator=(btree_handle_array_t const &) = delete;
+
+	handle_t insert(std::size_t index, T value)
+	{
+		assert(index <= size());
+		if (root_.pointer == nullptr)
+		{
+			root_.pointer = storage_.make_leaf();
+			storage_.leaf(root_.pointer)->parent = nullptr;
+		}
+
+		auto handle = acquire();
+		branch_entry_t stack[stack_size];
+		auto entry = seek(stack, stack + height_, index);
+		auto leaf = entry.pointer;
+		index = entry.index;
+
+		// If we have room for the data in this leaf, we are done
+		if (entry.size != maximum_leaf_size)
+		{
+			merge(index, leaf->buffer, entry.size, value);
+			merge(index, leaf->handles, entry.size, handle);
+			place(leaf, index, entry.size + 1);
+			update_sizes(stack, stack + height_, make_node(1, nullptr));
+			return handle;
+		}
+
+		// No room, split into 2 and insert the first half in the parent
+		auto sum = entry.size + 1;
+		auto left_size = sum / 2;
+		auto right_size = sum - left_size;
+		auto link = storage_.make_leaf();
+		auto right = storage_.leaf(link);
+		right->parent = leaf->parent;
+		split(
+			index,
+			left_size, right_size, right->buffer,
+			leaf->buffer, entry.size,
+			value);
+		split(
+			index,
+			left_size, right_size, right->handles,
+			leaf->handles, entry.size,
+			handle);
+		if (index < left_size) place(leaf, index, left_size);
+		place(right, 0, right_size);
+		insert_sibling(stack, stack + height_, make_node(left_size, nullptr), make_node(right_size, link), make_node(1, nullptr));
+		return handle;
+	}
+
+	// Remove the element of a handle, the handle may be reused afterwards
+
+	void erase(handle_t handle)
+	{
+		auto slot = slots_[handle];
+		release(handle);
+		if (root_.size == 1)
+		{
+			delete_node(root_, height_);
+			root_ = make_node(0, nullptr);
+			height_ = 0;
+			return;
+		}
+
+		auto leaf = slot.leaf;
+		auto size = link_of(leaf, leaf->parent).size;
+		std::char_traits<T>::move(leaf->buffer + slot.index, leaf->buffer + slot.index + 1, size - slot.index - 1);
+		std::char_traits<handle_t>::move(leaf->handles + slot.index, leaf->handles + slot.index + 1, size - slot.index - 1);
+		place(leaf, slot.index, size - 1);
+
+		// Count the element out all the way up, dropping nodes left empty
+		void * child = leaf;
+		auto parent = leaf->parent;
+		std::size_t height = 0;
+		while (parent != nullptr)
+		{
+			auto & child_link = link_of(child, parent);
+			if (child_link.size == 1)
+			{
+				auto length = get_length(parent, link_of(parent, parent->parent).size);
+				auto index = &child_link - parent->children;
+				std::char_traits<node_t>::move(
+					parent->children + index,
+					parent->children + index + 1,
+					length - index - 1);
+				if (height == 0) storage_.free_leaf(child);
+				else storage_.free_branch(child);
+			}
+			else
+			{
+				--child_link.size;
+			}
+			child = parent;
+			parent = parent->parent;
+			++height;
+		}
+		--root_.size;
+
+		// Remove roots that are left with a single child
+		while (height_ != 0)
+		{
+			auto link = root_.pointer;
+			if (storage_.branch(link)->children[0].size != root_.size) break;
+			root_.pointer = storage_.branch(link)->children[0].pointer;
+			policy_t::adopt(storage_, root_, height_ - 1, nullptr);
+			storage_.free_branch(link);
+			height_--;
+		}
+	}
+
+	// Current index of the element of a handle
+
+	std::size_t position(handle_t handle) const
+	{
+		auto slot = slots_[handle];
+		auto index = slot.index;
+		void * child = slot.leaf;
+		for (auto parent = slot.leaf->parent; parent != nullptr; parent = parent->parent)
+		{
+			for (auto link = parent->children; link->pointer != child; ++link) index += link->size;
+			child = parent;
+		}
+		return index;
+	}
+
+	T get(handle_t handle) const
+	{
+		auto slot = slots_[handle];
+		return slot.leaf->buffer[slot.index];
+	}
+
+	handle_t handle_at(std::size_t index) const
+	{
+		assert(index < size());
+		auto entry = locate(index);
+		return entry.pointer->handles[entry.index];
+	}
+
+	template<typename Functor>
+	void iterate(Functor functor) const
+	{
+		if (root_.pointer == nullptr) return;
+		auto visit = [&](leaf_t * leaf, std::size_t size)
+		{
+			functor(leaf->buffer, size);
+		};
+		visit_leaves(root_, height_, visit);
+	}
+
+	std::size_t size() const
+	{
+		return root_.size;
+	}
+};
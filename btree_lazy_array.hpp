@@ -0,0 +1,671 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "detail/btree_tree.hpp"
+
+namespace btree_detail
+{
+
+// Pending updates of a subtree: its order is reversed if reversed is set,
+// then every value v becomes (assigned ? assign : v) + add
+
+template<typename T>
+struct lazy_tag_t
+{
+	T add;
+	T assign;
+	bool assigned;
+	bool reversed;
+};
+
+template<typename T>
+struct lazy_node_t
+{
+	typedef void * link_t;
+
+	std::size_t size;
+	void * pointer;
+	lazy_tag_t<T> tag;
+};
+
+template<typename T, std::size_t target_branch_size, std::size_t target_leaf_size, std::size_t maximum_size>
+struct lazy_policy_t : basic_policy_t<lazy_node_t<T>>
+{
+	typedef lazy_node_t<T> node_t;
+	typedef lazy_tag_t<T> tag_t;
+
+	static std::size_t constexpr maximum_branch_size = target_branch_size  / sizeof(node_t);
+	static std::size_t constexpr maximum_leaf_size = target_leaf_size / sizeof(T);
+
+	// Splits and joins keep every node but the root at least half full
+
+	static std::size_t constexpr minimum_branch_size = maximum_branch_size / 2;
+	static std::size_t constexpr minimum_leaf_size = maximum_leaf_size / 2;
+	static std::size_t constexpr stack_size = log(maximum_size / minimum_leaf_size, minimum_branch_size) + 1;
+
+	typedef basic_branch_t<node_t, maximum_branch_size> branch_t;
+
+	struct leaf_t
+	{
+		T buffer[maximum_leaf_size];
+	};
+
+	typedef btree_heap_storage_t<branch_t, leaf_t> storage_t;
+
+	static tag_t identity()
+	{
+		tag_t tag;
+		tag.add = T();
+		tag.assign = T();
+		tag.assigned = false;
+		tag.reversed = false;
+		return tag;
+	}
+
+	static bool is_identity(tag_t const & tag)
+	{
+		return !tag.assigned && !tag.reversed && tag.add == T();
+	}
+
+	static node_t make_node(std::size_t size, void * pointer)
+	{
+		node_t node;
+		node.size = size;
+		node.pointer = pointer;
+		node.tag = identity();
+		return node;
+	}
+
+	static node_t sum(node_t const * nodes, std::size_t length, void * pointer)
+	{
+		std::size_t size = 0;
+		for (std::size_t I = 0; I != length; ++I) size += nodes[I].size;
+		return make_node(size, pointer);
+	}
+
+	static T transform(tag_t const & tag, T value)
+	{
+		return (tag.assigned ? tag.assign : value) + tag.add;
+	}
+
+	// Queue the values part of tag after that of pending, the order is
+	// left to the caller
+
+	static void compose(tag_t & pending, tag_t const & tag)
+	{
+		if (tag.assigned)
+		{
+			pending.assigned = true;
+			pending.assign = tag.assign;
+			pending.add = tag.add;
+		}
+		else
+		{
+			pending.add += tag.add;
+		}
+	}
+
+	// Queue tag after the updates already pending on node
+
+	static void apply(node_t & node, tag_t const & tag)
+	{
+		compose(node.tag, tag);
+		node.tag.reversed ^= tag.reversed;
+	}
+
+	// Carry out the tag of a node, handing it down to its children
+
+	static void descend(storage_t const & storage, node_t & node, std::size_t height)
+	{
+		if (is_identity(node.tag)) return;
+		if (height == 0)
+		{
+			auto buffer = storage.leaf(node.pointer)->buffer;
+			for (std::size_t index = 0; index != node.size; ++index)
+			{
+				buffer[index] = transform(node.tag, buffer[index]);
+			}
+			if (node.tag.reversed) std::reverse(buffer, buffer + node.size);
+		}
+		else
+		{
+			auto children = storage.branch(node.pointer)->children;
+			auto length = get_length(children, node.size);
+			for (std::size_t index = 0; index != length; ++index)
+			{
+				apply(children[index], node.tag);
+			}
+			if (node.tag.reversed) std::reverse(children, children + length);
+		}
+		node.tag = identity();
+	}
+};
+
+}
+
+// A btree_array_t with lazy range updates. Every child link carries a tag
+// of updates that apply to its whole subtree, a range update tags the
+// O(log n) subtrees covering the range, and a tag is pushed down one level
+// whenever an insert or an update passes through it. Reversing a range
+// splits the tree around it, tags the middle part and joins the three
+// parts back together.
+//
+// Reads leave the tags where they are and combine the ones on their path
+// instead, so const member functions only read the tree as in btree_array_t
+
+template<
+	typename T,
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 512,
+	std::size_t maximum_size = std::numeric_limits<std::size_t>::max()>
+class btree_lazy_array_t
+:
+	private btree_detail::tree_t<btree_detail::lazy_policy_t<T, target_branch_size, target_leaf_size, maximum_size>>
+{
+private:
+	static_assert(std::is_arithmetic<T>::value, "T must be arithmetic");
+
+	typedef btree_detail::lazy_policy_t<T, target_branch_size, target_leaf_size, maximum_size> policy_t;
+	typedef btree_detail::tree_t<policy_t> tree_t;
+	typedef typename tree_t::node_t node_t;
+	typedef typename tree_t::branch_t branch_t;
+	typedef typename tree_t::leaf_t leaf_t;
+	typedef typename tree_t::branch_entry_t branch_entry_t;
+	typedef typename policy_t::tag_t tag_t;
+
+	using tree_t::maximum_branch_size;
+	using tree_t::stack_size;
+	static std::size_t constexpr maximum_leaf_size = policy_t::maximum_leaf_size;
+
+	static_assert(maximum_branch_size >= 4, "maximum_branch_size must be at least 4");
+	static_assert(maximum_leaf_size >= 2, "maximum_leaf_size must be at least 2");
+
+	struct subtree_t
+	{
+		node_t root;
+		std::size_t height;
+	};
+
+	using tree_t::storage_;
+	using tree_t::root_;
+	using tree_t::height_;
+	using tree_t::make_node;
+	using tree_t::get_length;
+	using tree_t::merge;
+	using tree_t::split;
+	using tree_t::delete_node;
+	using tree_t::seek;
+	using tree_t::update_sizes;
+	using tree_t::insert_sibling;
+
+	branch_t * branch(node_t const & node) const
+	{
+		return storage_.branch(node.pointer);
+	}
+
+	leaf_t * leaf(node_t const & node) const
+	{
+		return storage_.leaf(node.pointer);
+	}
+
+	void push(node_t & node, std::size_t height)
+	{
+		policy_t::descend(storage_, node, height);
+	}
+
+	// The tag of node followed by the tags above it, which apply later
+
+	static tag_t below(node_t const & node, tag_t const & above)
+	{
+		auto tag = node.tag;
+		policy_t::compose(tag, above);
+		return tag;
+	}
+
+	// Hand out the leaves of a subtree in order, backwards if reversed,
+	// with the tags above applied to a copy of the values
+
+	template<typename Functor>
+	void iterate(node_t const & node, std::size_t height, tag_t const & above, bool reversed, Functor & functor) const
+	{
+		auto tag = below(node, above);
+		reversed ^= node.tag.reversed;
+		if (height != 0)
+		{
+			auto children = branch(node)->children;
+			auto length = get_length(branch(node), node.size);
+			for (std::size_t index = 0; index != length; ++index)
+			{
+				iterate(children[reversed ? length - 1 - index : index], height - 1, tag, reversed, functor);
+			}
+			return;
+		}
+
+		auto buffer = leaf(node)->buffer;
+		if (!reversed && policy_t::is_identity(tag))
+		{
+			functor(const_cast<T const *>(buffer), node.size);
+			return;
+		}
+
+		T values[maximum_leaf_size];
+		for (std::size_t index = 0; index != node.size; ++index)
+		{
+			values[index] = policy_t::transform(tag, buffer[reversed ? node.size - 1 - index : index]);
+		}
+		functor(const_cast<T const *>(values), node.size);
+	}
+
+	static subtree_t empty()
+	{
+		return {make_node(0, nullptr), 0};
+	}
+
+	// Move everything into left if it fits, otherwise share it evenly.
+	// Returns whether right still holds anything
+
+	template<typename Kind>
+	static bool combine(
+		Kind * left, std::size_t & left_length,
+		Kind * right, std::size_t & right_length,
+		std::size_t maximum)
+	{
+		auto total = left_length + right_length;
+		if (total <= maximum)
+		{
+			std::char_traits<Kind>::copy(left + left_length, right, right_length);
+			left_length = total;
+			right_length = 0;
+			return false;
+		}
+
+		auto target = total / 2;
+		if (left_length > target)
+		{
+			auto moved = left_length - target;
+			std::char_traits<Kind>::move(right + moved, right, right_length);
+			std::char_traits<Kind>::copy(right, left + target, moved);
+		}
+		else
+		{
+			auto moved = target - left_length;
+			std::char_traits<Kind>::copy(left + left_length, right, moved);
+			std::char_traits<Kind>::move(right, right + moved, right_length - moved);
+		}
+		left_length = target;
+		right_length = total - target;
+		return true;
+	}
+
+	// Combine two neighbouring nodes of the same height, right is freed if
+	// everything fits in left
+
+	bool combine(node_t & left, node_t & right, std::size_t height)
+	{
+		push(left, height);
+		push(right, height);
+
+		if (height == 0)
+		{
+			auto kept = combine(
+				leaf(left)->buffer, left.size,
+				leaf(right)->buffer, right.size,
+				maximum_leaf_size);
+			if (!kept) storage_.free_leaf(right.pointer);
+			return kept;
+		}
+
+		auto total = left.size + right.size;
+		auto left_length = get_length(branch(left), left.size);
+		auto right_length = get_length(branch(right), right.size);
+		auto kept = combine(
+			branch(left)->children, left_length,
+			branch(right)->children, right_length,
+			maximum_branch_size);
+		if (!kept)
+		{
+			storage_.free_branch(right.pointer);
+			left.size = total;
+			return false;
+		}
+
+		left.size = 0;
+		for (std::size_t I = 0; I != left_length; ++I) left.size += branch(left)->children[I].size;
+		right.size = total - left.size;
+		return true;
+	}
+
+	// Insert child into the branch of node at index, splitting the branch
+	// if it is full. Returns the right half of a split, if any
+
+	node_t link(node_t & node, std::size_t length, std::size_t index, node_t child)
+	{
+		auto children = branch(node)->children;
+		node.size += child.size;
+		if (length != maximum_branch_size)
+		{
+			merge(index, children, length, child);
+			return make_node(0, nullptr);
+		}
+
+		auto sum = length + 1;
+		auto left_length = sum / 2;
+		auto right_length = sum - left_length;
+		auto link = storage_.make_branch();
+		auto right = storage_.branch(link);
+		split(
+			index,
+			left_length, right_length, right->children,
+			children, length,
+			child);
+		auto right_node = policy_t::sum(right->children, right_length, link);
+		node.size -= right_node.size;
+		return right_node;
+	}
+
+	// Attach the tree b below the right spine of the node a, which is at
+	// least as high. Returns a node to link right after a, if any
+
+	node_t join_right(node_t & a, std::size_t a_height, node_t b, std::size_t b_height)
+	{
+		if (a_height == b_height) return combine(a, b, a_height) ? b : make_node(0, nullptr);
+
+		push(a, a_height);
+		auto length = get_length(branch(a), a.size);
+		auto & last = branch(a)->children[length - 1];
+		a.size -= last.size;
+		auto extra = join_right(last, a_height - 1, b, b_height);
+		a.size += last.size;
+		if (extra.pointer == nullptr) return extra;
+		return link(a, length, length, extra);
+	}
+
+	// Attach the tree a below the left spine of the node b, which is at
+	// least as high. Returns a node to link right after b, if any
+
+	node_t join_left(node_t a, std::size_t a_height, node_t & b, std::size_t b_height)
+	{
+		if (a_height == b_height)
+		{
+			auto kept = combine(a, b, a_height);
+			std::swap(a, b);
+			return kept ? a : make_node(0, nullptr);
+		}
+
+		push(b, b_height);
+		auto length = get_length(branch(b), b.size);
+		auto & first = branch(b)->children[0];
+		b.size -= first.size;
+		auto extra = join_left(a, a_height, first, b_height - 1);
+		b.size += first.size;
+		if (extra.pointer == nullptr) return extra;
+		return link(b, length, 1, extra);
+	}
+
+	subtree_t join(subtree_t left, subtree_t right)
+	{
+		if (left.root.pointer == nullptr) return right;
+		if (right.root.pointer == nullptr) return left;
+
+		subtree_t tree;
+		node_t extra;
+		if (left.height >= right.height)
+		{
+			extra = join_right(left.root, left.height, right.root, right.height);
+			tree = left;
+		}
+		else
+		{
+			extra = join_left(left.root, left.height, right.root, right.height);
+			tree = right;
+		}
+
+		// The root was split, grow upward
+		if (extra.pointer != nullptr)
+		{
+			auto link = storage_.make_branch();
+			auto branch = storage_.branch(link);
+			branch->children[0] = tree.root;
+			branch->children[1] = extra;
+			tree.root = make_node(tree.root.size + extra.size, link);
+			++tree.height;
+		}
+		return tree;
+	}
+
+	// Split a subtree in two at 0 < index < node.size. The children left
+	// and right of the cut go as they are, the child holding the cut is
+	// split in turn and the pieces are joined back up
+
+	void split(node_t node, std::size_t height, std::size_t index, subtree_t & left, subtree_t & right)
+	{
+		push(node, height);
+		if (height == 0)
+		{
+			auto link = storage_.make_leaf();
+			std::char_traits<T>::copy(leaf(make_node(0, link))->buffer, leaf(node)->buffer + index, node.size - index);
+			left = {make_node(index, node.pointer), 0};
+			right = {make_node(node.size - index, link), 0};
+			return;
+		}
+
+		auto children = branch(node)->children;
+		auto length = get_length(branch(node), node.size);
+		std::size_t child = 0;
+		std::size_t offset = 0;
+		while (index >= offset + children[child].size)
+		{
+			offset += children[child].size;
+			++child;
+		}
+
+		auto inner = children[child];
+		auto after = empty();
+		auto count = length - child - 1;
+		if (count == 1)
+		{
+			after = {children[length - 1], height - 1};
+		}
+		else if (count > 1)
+		{
+			auto link = storage_.make_branch();
+			std::char_traits<node_t>::copy(storage_.branch(link)->children, children + child + 1, count);
+			after = {make_node(node.size - offset - inner.size, link), height};
+		}
+
+		auto before = empty();
+		if (child == 1) before = {children[0], height - 1};
+		else if (child > 1) before = {make_node(offset, node.pointer), height};
+		if (child < 2) storage_.free_branch(node.pointer);
+
+		subtree_t inner_left = empty();
+		subtree_t inner_right = {inner, height - 1};
+		if (index != offset) split(inner, height - 1, index - offset, inner_left, inner_right);
+
+		left = join(before, inner_left);
+		right = join(inner_right, after);
+	}
+
+	void split(subtree_t tree, std::size_t index, subtree_t & left, subtree_t & right)
+	{
+		if (index == 0)
+		{
+			left = empty();
+			right = tree;
+		}
+		else if (index == tree.root.size)
+		{
+			left = tree;
+			right = empty();
+		}
+		else
+		{
+			split(tree.root, tree.height, index, left, right);
+		}
+	}
+
+	// Apply tag to [first, last) of a subtree, tagging the children that
+	// are covered entirely
+
+	void update(node_t & node, std::size_t height, std::size_t first, std::size_t last, tag_t const & tag)
+	{
+		if (first == 0 && last == node.size)
+		{
+			policy_t::apply(node, tag);
+			return;
+		}
+
+		push(node, height);
+		if (height == 0)
+		{
+			auto buffer = leaf(node)->buffer;
+			for (auto index = first; index != last; ++index) buffer[index] = policy_t::transform(tag, buffer[index]);
+			return;
+		}
+
+		std::size_t offset = 0;
+		for (std::size_t index = 0; offset < last; ++index)
+		{
+			auto & child = branch(node)->children[index];
+			if (first < offset + child.size)
+			{
+				auto child_first = first > offset ? first - offset : 0;
+				auto child_last = last - offset < child.size ? last - offset : child.size;
+				update(child, height - 1, child_first, child_last, tag);
+			}
+			offset += child.size;
+		}
+	}
+
+	void update(std::size_t first, std::size_t last, tag_t const & tag)
+	{
+		assert(first <= last && last <= size());
+		if (first == last) return;
+		update(root_, height_, first, last, tag);
+	}
+
+public:
+	btree_lazy_array_t()
+	{}
+
+	~btree_lazy_array_t()
+	{
+		if (root_.pointer != nullptr) delete_node(root_, height_);
+	}
+
+	btree_lazy_array_t(btree_lazy_array_t const &) = delete;
+	btree_lazy_array_t & operator=(btree_lazy_array_t const &) = delete;
+
+	void insert(std::size_t index, T value)
+	{
+		assert(index <= size());
+		if (root_.pointer == nullptr) root_.pointer = storage_.make_leaf();
+
+		branch_entry_t stack[stack_size];
+		auto entry = seek(stack, stack + height_, index);
+		auto sum = entry.size + 1;
+
+		// If we have room for the data in this leaf, we are done
+		if (sum <= maximum_leaf_size)
+		{
+			merge(entry.index, entry.pointer->buffer, entry.size, value);
+			update_sizes(stack, stack + height_, make_node(1, nullptr));
+			return;
+		}
+
+		// No room, split into 2 and insert the first half in the parent
+		auto left_size = sum / 2;
+		auto right_size = sum - left_size;
+		auto link = storage_.make_leaf();
+		split(
+			entry.index,
+			left_size, right_size, storage_.leaf(link)->buffer,
+			entry.pointer->buffer, entry.size,
+			value);
+		insert_sibling(stack, stack + height_, make_node(left_size, nullptr), make_node(right_size, link), make_node(1, nullptr));
+	}
+
+	void push_back(T value)
+	{
+		insert(size(), value);
+	}
+
+	T get(std::size_t index) const
+	{
+		assert(index < size());
+		auto node = root_;
+		auto tag = below(node, policy_t::identity());
+		for (auto height = height_; height != 0; --height)
+		{
+			if (node.tag.reversed) index = node.size - 1 - index;
+			auto branch = this->branch(node);
+			std::size_t branch_index = 0;
+			while (index >= branch->children[branch_index].size)
+			{
+				index -= branch->children[branch_index].size;
+				++branch_index;
+			}
+			node = branch->children[branch_index];
+			tag = below(node, tag);
+		}
+
+		if (node.tag.reversed) index = node.size - 1 - index;
+		return policy_t::transform(tag, leaf(node)->buffer[index]);
+	}
+
+	// Add delta to every element in [first, last)
+
+	void range_add(std::size_t first, std::size_t last, T delta)
+	{
+		auto tag = policy_t::identity();
+		tag.add = delta;
+		update(first, last, tag);
+	}
+
+	// Set every element in [first, last) to value
+
+	void range_assign(std::size_t first, std::size_t last, T value)
+	{
+		auto tag = policy_t::identity();
+		tag.assign = value;
+		tag.assigned = true;
+		update(first, last, tag);
+	}
+
+	// Reverse the order of the elements in [first, last)
+
+	void range_reverse(std::size_t first, std::size_t last)
+	{
+		assert(first <= last && last <= size());
+		if (last - first < 2) return;
+
+		subtree_t head, middle, tail;
+		split({root_, height_}, last, head, tail);
+		split(head, first, head, middle);
+
+		auto tag = policy_t::identity();
+		tag.reversed = true;
+		policy_t::apply(middle.root, tag);
+
+		auto tree = join(join(head, middle), tail);
+		root_ = tree.root;
+		height_ = tree.height;
+	}
+
+	template<typename Functor>
+	void iterate(Functor functor) const
+	{
+		if (root_.pointer == nullptr) return;
+		iterate(root_, height_, policy_t::identity(), false, functor);
+	}
+
+	std::size_t size() const
+	{
+		return root_.size;
+	}
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include "btree_array.hpp"
+
+// A btree_array_t for large elements. The tree only holds 32-bit indices
+// into a pool of elements that never move, so the fanout of its leaves and
+// the cost of shifting them no longer depend on sizeof(T). It has the same
+// interface as btree_array_t, iterate hands out T const * runs
+
+template<
+	typename T,
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 512,
+	std::size_t maximum_size = std::numeric_limits<std::uint32_t>::max() - 1>
+class btree_payload_array_t
+{
+private:
+	static_assert(std::is_pod<T>::value, "T must be a pod");
+	static_assert(
+		maximum_size < std::numeric_limits<std::uint32_t>::max(),
+		"elements are indexed in 32 bits");
+
+	typedef std::uint32_t index_t;
+
+	// Elements are copied out a few at a time for iterate, and indices are
+	// looked up a few at a time for get_batch and gather
+
+	static std::size_t constexpr gather_size = 4096 / sizeof(T) != 0 ? 4096 / sizeof(T) : 1;
+
+	btree_arena_t<T> pool_;
+	btree_array_t<index_t, target_branch_size, target_leaf_size, maximum_size> indices_;
+
+	index_t make(T const & value)
+	{
+		auto index = pool_.allocate();
+		*pool_.get(index) = value;
+		return index;
+	}
+
+	T const & at(index_t index) const
+	{
+		return *pool_.get(index);
+	}
+
+	// Look up indices in slices with lookup(indices, count, slots), then
+	// copy the elements of the slots out
+
+	template<typename Lookup>
+	void resolve(std::size_t const * indices, std::size_t count, T * out, Lookup lookup) const
+	{
+		index_t slots[gather_size];
+		while (count != 0)
+		{
+			auto slice = count < gather_size ? count : gather_size;
+			lookup(indices, slice, slots);
+			for (std::size_t I = 0; I != slice; ++I) out[I] = at(slots[I]);
+			indices += slice;
+			out += slice;
+			count -= slice;
+		}
+	}
+
+public:
+	void insert(std::size_t index, T value)
+	{
+		indices_.insert(index, make(value));
+	}
+
+	void push_back(T value)
+	{
+		indices_.push_back(make(value));
+	}
+
+	void push_front(T value)
+	{
+		indices_.push_front(make(value));
+	}
+
+	void pop_back()
+	{
+		pool_.deallocate(indices_.back());
+		indices_.pop_back();
+	}
+
+	void pop_front()
+	{
+		pool_.deallocate(indices_.front());
+		indices_.pop_front();
+	}
+
+	T front() const
+	{
+		return at(indices_.front());
+	}
+
+	T back() const
+	{
+		return at(indices_.back());
+	}
+
+	T get(std::size_t index) const
+	{
+		return at(indices_.get(index));
+	}
+
+	void get_batch(std::size_t const * indices, std::size_t count, T * out) const
+	{
+		resolve(indices, count, out, [&](std::size_t const * first, std::size_t size, index_t * slots)
+		{
+			indices_.get_batch(first, size, slots);
+		});
+	}
+
+	void gather(std::size_t const * indices, std::size_t count, T * out) const
+	{
+		resolve(indices, count, out, [&](std::size_t const * first, std::size_t size, index_t * slots)
+		{
+			indices_.gather(first, size, slots);
+		});
+	}
+
+	// Call functor(data, size) on consecutive runs of elements, copied into
+	// a buffer since they are not contiguous in the pool
+
+	template<typename Functor>
+	void iterate(Functor functor) const
+	{
+		indices_.iterate([&](index_t const * data, std::size_t size)
+		{
+			T buffer[gather_size];
+			while (size != 0)
+			{
+				auto count = size < gather_size ? size : gather_size;
+				for (std::size_t I = 0; I != count; ++I) buffer[I] = at(data[I]);
+				functor(const_cast<T const *>(buffer), count);
+				data += count;
+				size -= count;
+			}
+		});
+	}
+
+	template<typename Predicate>
+	std::size_t find_if(Predicate predicate, std::size_t from = 0) const
+	{
+		return indices_.find_if([&](index_t index)
+		{
+			return predicate(at(index));
+		}, from);
+	}
+
+	std::size_t find(T value, std::size_t from = 0) const
+	{
+		return find_if([&](T const & element)
+		{
+			return element == value;
+		}, from);
+	}
+
+	template<typename Predicate>
+	std::size_t count_if(Predicate predicate) const
+	{
+		return indices_.count_if([&](index_t index)
+		{
+			return predicate(at(index));
+		});
+	}
+
+	std::size_t count(T value) const
+	{
+		return count_if([&](T const & element)
+		{
+			return element == value;
+		});
+	}
+
+	template<typename Predicate>
+	std::size_t parallel_find_if(Predicate predicate, std::size_t threads = std::thread::hardware_concurrency()) const
+	{
+		return indices_.parallel_find_if([&](index_t index)
+		{
+			return predicate(at(index));
+		}, threads);
+	}
+
+	std::size_t parallel_find(T value, std::size_t threads = std::thread::hardware_concurrency()) const
+	{
+		return parallel_find_if([&](T const & element)
+		{
+			return element == value;
+		}, threads);
+	}
+
+	template<typename Predicate>
+	std::size_t parallel_count_if(Predicate predicate, std::size_t threads = std::thread::hardware_concurrency()) const
+	{
+		return indices_.parallel_count_if([&](index_t index)
+		{
+			return predicate(at(index));
+		}, threads);
+	}
+
+	std::size_t parallel_count(T value, std::size_t threads = std::thread::hardware_concurrency()) const
+	{
+		return parallel_count_if([&](T const & element)
+		{
+			return element == value;
+		}, threads);
+	}
+
+	// Sorting only moves the indices
+
+	template<typename Compare = std::less<T>>
+	void sort(Compare compare = Compare(), std::size_t threads = std::thread::hardware_concurrency())
+	{
+		indices_.sort([&](index_t left, index_t right)
+		{
+			return compare(at(left), at(right));
+		}, threads);
+	}
+
+	template<typename Compare = std::less<T>>
+	void stable_sort(Compare compare = Compare(), std::size_t threads = std::thread::hardware_concurrency())
+	{
+		indices_.stable_sort([&](index_t left, index_t right)
+		{
+			return compare(at(left), at(right));
+		}, threads);
+	}
+
+	// Compaction repacks the tree of indices, the elements stay in place
+
+	void compact(double fill_factor = 1.0)
+	{
+		indices_.compact(fill_factor);
+	}
+
+	bool compact_step(std::size_t budget, double fill_factor = 1.0)
+	{
+		return indices_.compact_step(budget, fill_factor);
+	}
+
+	std::size_t size() const
+	{
+		return indices_.size();
+	}
+};
+
+// Store elements larger than payload_threshold bytes out of line. Both
+// choices have the same interface, so code written against one compiles
+// against the other
+
+template<
+	typename T,
+	std::size_t payload_threshold = 64,
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 512>
+using btree_auto_array_t = typename std::conditional<
+	(sizeof(T) > payload_threshold),
+	btree_payload_array_t<T, target_branch_size, target_leaf_size>,
+	btree_array_t<T, target_branch_size, target_leaf_size>>::type;
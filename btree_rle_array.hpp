@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cassert>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "detail/btree_tree.hpp"
+
+namespace btree_detail
+{
+
+template<typename T, std::size_t target_branch_size, std::size_t target_leaf_size, std::size_t maximum_size>
+struct rle_policy_t : basic_policy_t<basic_node_t<std::size_t, void *>>
+{
+	typedef basic_node_t<std::size_t, void *> node_t;
+
+	struct run_t
+	{
+		T value;
+		std::size_t count;
+	};
+
+	static std::size_t constexpr maximum_branch_size = target_branch_size  / sizeof(node_t);
+	static std::size_t constexpr maximum_leaf_size = (target_leaf_size - sizeof(std::size_t)) / sizeof(run_t);
+
+	// A leaf holds at least half its runs, each of at least one element
+
+	static std::size_t constexpr minimum_branch_size = (maximum_branch_size + 1) / 2;
+	static std::size_t constexpr minimum_leaf_size = maximum_leaf_size / 2;
+	static std::size_t constexpr stack_size = log(maximum_size / minimum_leaf_size, minimum_branch_size);
+
+	typedef basic_branch_t<node_t, maximum_branch_size> branch_t;
+
+	struct leaf_t
+	{
+		std::size_t length;
+		run_t runs[maximum_leaf_size];
+	};
+
+	typedef btree_heap_storage_t<branch_t, leaf_t> storage_t;
+};
+
+}
+
+// A btree_array_t whose leaves hold runs of equal values instead of single
+// elements. Branch sizes still count elements, so positional access works
+// as usual, while memory and scans are proportional to the number of runs
+
+template<
+	typename T,
+	std::size_t target_branch_size = 512,
+	std::size_t target_leaf_size = 512,
+	std::size_t maximum_size = std::numeric_limits<std::size_t>::max()>
+class btree_rle_array_t
+:
+	private btree_detail::tree_t<btree_detail::rle_policy_t<T, target_branch_size, target_leaf_size, maximum_size>>
+{
+private:
+	static_assert(std::is_pod<T>::value, "T must be a pod");
+
+	typedef btree_detail::rle_policy_t<T, target_branch_size, target_leaf_size, maximum_size> policy_t;
+	typedef btree_detail::tree_t<policy_t> tree_t;
+	typedef typename tree_t::node_t node_t;
+	typedef typename tree_t::leaf_t leaf_t;
+	typedef typename tree_t::branch_entry_t branch_entry_t;
+	typedef typename tree_t::leaf_entry_t leaf_entry_t;
+	typedef typename policy_t::run_t run_t;
+
+	using tree_t::stack_size;
+	static std::size_t constexpr maximum_leaf_size = policy_t::maximum_leaf_size;
+
+	static_assert(maximum_leaf_size >= 4, "maximum_leaf_size must be at least 4");
+
+	using tree_t::storage_;
+	using tree_t::root_;
+	using tree_t::height_;
+	using tree_t::make_node;
+	using tree_t::merge;
+	using tree_t::delete_node;
+	using tree_t::seek;
+	using tree_t::locate;
+	using tree_t::update_sizes;
+	using tree_t::insert_sibling;
+	using tree_t::visit_leaves;
+
+	// Move the upper half of the runs of a full leaf to a new leaf
+
+	void split_leaf(branch_entry_t * first, branch_entry_t * last, leaf_entry_t & entry)
+	{
+		auto leaf = entry.pointer;
+		auto link = storage_.make_leaf();
+		auto right = storage_.leaf(link);
+		auto left_length = leaf->length / 2;
+		right->length = leaf->length - left_length;
+		std::char_traits<run_t>::copy(right->runs, leaf->runs + left_length, right->length);
+		leaf->length = left_length;
+
+		std::size_t right_size = 0;
+		for (std::size_t I = 0; I != right->length; ++I) right_size += right->runs[I].count;
+		insert_sibling(first, last, make_node(entry.size - right_size, nullptr), make_node(right_size, link), make_node(0, nullptr));
+	}
+
+public:
+	btree_rle_array_t()
+	{}
+
+	~btree_rle_array_t()
+	{
+		if (root_.pointer != nullptr) delete_node(root_, height_);
+	}
+
+	btree_rle_array_t(btree_rle_array_t const &) = delete;
+	btree_rle_array_t & operator=(btree_rle_array_t const &) = delete;
+
+	// Insert count copies of value before index. Only the run at index is
+	// touched: it grows if it holds value already, otherwise it is split
+	// around a new run
+
+	void insert(std::size_t index, std::size_t count, T value)
+	{
+		assert(index <= size());
+		if (count == 0) return;
+		if (root_.pointer == nullptr)
+		{
+			root_.pointer = storage_.make_leaf();
+			storage_.leaf(root_.pointer)->length = 0;
+		}
+
+		branch_entry_t stack[stack_size];
+		auto entry = seek(stack, stack + height_, index);
+
+		// A new run inside another one takes 2 slots, make sure they exist
+		if (entry.pointer->length + 2 > maximum_leaf_size)
+		{
+			split_leaf(stack, stack + height_, entry);
+			entry = seek(stack, stack + height_, index);
+		}
+
+		auto leaf = entry.pointer;
+		auto offset = entry.index;
+		std::size_t run = 0;
+		while (run != leaf->length && offset >= leaf->runs[run].count)
+		{
+			offset -= leaf->runs[run].count;
+			++run;
+		}
+
+		if (offset != 0)
+		{
+			auto & inner = leaf->runs[run];
+			if (inner.value == value)
+			{
+				inner.count += count;
+			}
+			else
+			{
+				merge(run + 1, leaf->runs, leaf->length, {inner.value, inner.count - offset});
+				merge(run + 1, leaf->runs, leaf->length + 1, {value, count});
+				inner.count = offset;
+				leaf->length += 2;
+			}
+		}
+		else if (run != 0 && leaf->runs[run - 1].value == value)
+		{
+			leaf->runs[run - 1].count += count;
+		}
+		else if (run != leaf->length && leaf->runs[run].value == value)
+		{
+			leaf->runs[run].count += count;
+		}
+		else
+		{
+			merge(run, leaf->runs, leaf->length, {value, count});
+			++leaf->length;
+		}
+
+		update_sizes(stack, stack + height_, make_node(count, nullptr));
+	}
+
+	void insert(std::size_t index, T value)
+	{
+		insert(index, 1, value);
+	}
+
+	T get(std::size_t index) const
+	{
+		assert(index < size());
+		auto entry = locate(index);
+		auto leaf = entry.pointer;
+		index = entry.index;
+		std::size_t run = 0;
+		while (index >= leaf->runs[run].count)
+		{
+			index -= leaf->runs[run].count;
+			++run;
+		}
+		return leaf->runs[run].value;
+	}
+
+	// Call functor(value, count) for each run in order. Runs in different
+	// leaves are not merged, so neighbouring runs may hold the same value
+
+	template<typename Functor>
+	void iterate(Functor functor) const
+	{
+		if (root_.pointer == nullptr) return;
+		auto visit = [&](leaf_t const * leaf, std::size_t size)
+		{
+			for (std::size_t index = 0; index != leaf->length; ++index)
+			{
+				functor(leaf->runs[index].value, leaf->runs[index].count);
+			}
+		};
+		visit_leaves(root_, height_, visit);
+	}
+
+	std::size_t size() const
+	{
+		return root_.size;
+	}
+};
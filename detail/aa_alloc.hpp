@@ -13,6 +13,8 @@
   Private helper methods for nodes allocation/deallocation
 
   new_node(): Allocate and construct a new node (O(1))
+  new_node(t,dp): idem, copying or moving t, as dp says (O(1))
+  emplace_node(): idem, forwarding any arguments (O(1))
   delete_node(): Destruct and deallocate a node (O(1))
 */
 
@@ -34,15 +36,16 @@ namespace mkr  // Public namespace
 // t is null, use T's default constructor. If it is not NULL (it
 // points to a valid T object), use T's copy constructor.
 // Note: T's constructors are not called directly, but through the
-// node constructors
+// node constructors. If they throw, the memory is deallocated
+// before rethrowing
 //
 // Complexity: O(1) (regarded that T's constructor is O(1) ;)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::node_t *
-  avl_array<T,A,W,P>::new_node
-  (typename avl_array<T,A,W,P>::const_pointer t)
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::new_node
+  (typename avl_array<T,A,W,P,S>::const_pointer t)
 {
   payload_node_t * p;
 
@@ -51,27 +54,113 @@ inline
   if (p==NULL)                       // If the allocator didn't
     throw allocator_returned_null(); // throw an exception, but
                                      // it returned NULL, throw
-  if (t)
-    new (p) payload_node_t(*t);      // Call the constructor
-  else                               // through the placement
-    new (p) payload_node_t;          // new operator
+  try
+  {
+    if (t)
+      new (p) payload_node_t(*t);    // Call the constructor
+    else                             // through the placement
+      new (p) payload_node_t;        // new operator
+  }
+  catch (...)
+  {
+    allocator.deallocate (p, 1);
+    throw;
+  }
 
   return static_cast<node_t*>(p);    // Return allocated node
 }
 
-// delete_node(): Destruct and deallocate an existing node
+// new_node(): Allocate and construct a new node with the
+// object t given by a data provider (see construct_nodes_list()
+// in build_list.hpp). Objects of a move_data_provider are moved
+// (see below). All other data providers give objects to copy
+//
+// Complexity: O(1) (regarded that T's constructor is O(1) ;)
+
+template<class T,class A,class W,class P,class S>
+template<class DP>
+inline
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::new_node
+  (typename avl_array<T,A,W,P,S>::const_pointer t, DP &)
+{
+  return new_node (t);
+}
+
+#if __cplusplus >= 201103L
+
+// new_node() _move_: Allocate a new node and move construct
+// its T object from t (or default construct it if t is NULL).
+// move_data_provider only returns pointers to non-const
+// objects, though typed as const_pointer
+//
+// Complexity: O(1) (regarded that T's constructor is O(1) ;)
+
+template<class T,class A,class W,class P,class S>
+template<class IT>
+inline
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::new_node
+  (typename avl_array<T,A,W,P,S>::const_pointer t,
+   move_data_provider<const_pointer,IT> &)
+{
+  if (!t)
+    return emplace_node ();
+
+  return emplace_node (std::move (*const_cast<pointer>(t)));
+}
+
+// emplace_node(): Allocate a new node and construct its T
+// object forwarding the given arguments to T's constructor.
+// If it throws, the memory is deallocated before rethrowing
+//
+// Complexity: O(1) (regarded that T's constructor is O(1) ;)
+
+template<class T,class A,class W,class P,class S>
+template<class... ARGS>
+inline
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::emplace_node
+  (ARGS &&... args)
+{
+  payload_node_t * p;
+
+  p = allocator.allocate (1); // Just one
+
+  if (p==NULL)                       // If the allocator didn't
+    throw allocator_returned_null(); // throw an exception, but
+                                     // it returned NULL, throw
+  try
+  {
+    new (p) payload_node_t(emplace_args(),          // Construct
+                           std::forward<ARGS>(args)...); // in
+  }                                                      // place
+  catch (...)
+  {
+    allocator.deallocate (p, 1);
+    throw;
+  }
+
+  return static_cast<node_t*>(p);    // Return allocated node
+}
+
+#endif
+
+// delete_node(): Destruct and deallocate an existing node.
+// The NPSV dirty list is forgotten, because p might be in it
 //
 // Complexity: O(1) (regarded that T's destructor is O(1) ;)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline void
-  avl_array<T,A,W,P>::delete_node
-  (typename avl_array<T,A,W,P>::node_t * p)
+  avl_array<T,A,W,P,S>::delete_node
+  (typename avl_array<T,A,W,P,S>::node_t * p)
 {
   AA_ASSERT (p);
   payload_node_t * q = static_cast<payload_node_t*>(p);
   q->~payload_node_t ();
   allocator.deallocate (q, 1);
+  m_dirty.clear ();
 }
 
 //////////////////////////////////////////////////////////////////
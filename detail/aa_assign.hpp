@@ -13,6 +13,7 @@
   Container assignment and swap operations:
 
   Container assignment (O(M+N): M to delete + N to copy)
+  Container move assignment (O(M): M to delete) (C++11 only)
   Container swap (O(1))
 
   Private helper method:
@@ -44,11 +45,11 @@ namespace mkr  // Public namespace
 // (where M is the number of T objects to delete, and N is
 // the number of T objects to copy)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  const typename avl_array<T,A,W,P>::my_class &
-  avl_array<T,A,W,P>::operator=
-  (const typename avl_array<T,A,W,P>::my_class & a)
+  const typename avl_array<T,A,W,P,S>::my_class &
+  avl_array<T,A,W,P,S>::operator=
+  (const typename avl_array<T,A,W,P,S>::my_class & a)
 {
   node_t * first, * last;
   iter_data_provider<const_pointer,
@@ -61,22 +62,53 @@ inline
   return *this;
 }
 
+#if __cplusplus >= 201103L
+
+// Move assignment operator: delete the current contents of
+// the avl_array and take the tree of a, which is left empty.
+// T objects of a are not touched (see move constructor)
+//
+// Complexity: O(M) (where M is the number of T objects to
+// delete)
+
+template<class T,class A,class W,class P,class S>
+inline
+  const typename avl_array<T,A,W,P,S>::my_class &
+  avl_array<T,A,W,P,S>::operator=
+  (typename avl_array<T,A,W,P,S>::my_class && a) noexcept
+{
+  if (&a != this)
+  {
+    clear ();
+    swap (a);
+  }
+
+  return *this;
+}
+
+#endif
+
 // swap(): interchange the contents of two avl_array
 // containers. This operation only requires changing some
-// pointers. T objects are not touched
+// pointers. T objects are not touched. The NPSV dirty state
+// goes with the trees
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::swap
-  (typename avl_array<T,A,W,P>::my_class & a)
+  avl_array<T,A,W,P,S>::swap
+  (typename avl_array<T,A,W,P,S>::my_class & a)
 {
   node_t tmp;
 
   if (&a == this) return;  // Self-swap is nonsense
 
+  std::swap (m_sums_out_of_date,    // NPSV state first (an
+             a.m_sums_out_of_date);  // empty tree resets it)
+  m_dirty.swap (a.m_dirty);
+
   tmp = *dummy ();           // tmp <-- *this
   acquire_tree (*a.dummy()); // *this <-- a
   a.acquire_tree (tmp);      // a <-- tmp
@@ -90,11 +122,11 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::acquire_tree
-  (const typename avl_array<T,A,W,P>::node_t & nf)
+  avl_array<T,A,W,P,S>::acquire_tree
+  (const typename avl_array<T,A,W,P,S>::node_t & nf)
 {
   if (!nf.m_children[L])   // If the tree to acquire is empty,
     init ();            // just initialize
@@ -103,11 +135,15 @@ inline
     *dummy () = nf;               // Link dummy to the tree
 
     node_t::m_children[L]->m_parent =   // Link the tree to dummy
-    node_t::m_prev->m_next =
-    node_t::m_next->m_prev = dummy ();
+                                 dummy ();
+    if (S::threaded)
+    {
+      threads_t::link (threads_t::prev (dummy ()), dummy ());
+      threads_t::link (dummy (), threads_t::next (dummy ()));
+    }
 
     node_t::m_total_width =                         // Copy total
-           node_t::m_children[L]->total_width ();   // width into
+           node_t::m_children[L]->m_total_width;    // width into
   }                                                 // dummy node
 }
 
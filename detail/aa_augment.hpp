@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////
+//                                                               //
+//  Copyright (c) 2006, Universidad de Alcala                    //
+//                                                               //
+//  See accompanying LICENSE.TXT                                 //
+//                                                               //
+///////////////////////////////////////////////////////////////////
+
+/*
+  detail/aa_augment.hpp
+  ---------------------
+
+  Methods for any kind of widths (see monoid_traits.hpp), not
+  only the numeric ones of NPSV:
+
+  set_width(): set an element's width O(log N) or O(1)**
+  reduce(from,to): combine the widths of a range O(log N)*
+  search(pred): first prefix accepted by pred O(log N)*
+  (*) width sums need to be updated (see aa_npsv.hpp)
+  (**) don't update width sums (lazy mode)
+
+  Private helper method:
+
+  reduce_subtree(): combine the widths of a range in a subtree
+*/
+
+#ifndef _AVL_ARRAY_AUGMENT_HPP_
+#define _AVL_ARRAY_AUGMENT_HPP_
+
+#ifndef _AVL_ARRAY_HPP_
+#error "Don't include this file. Include avl_array.hpp instead."
+#endif
+
+namespace mkr  // Public namespace
+{
+
+//////////////////////////////////////////////////////////////////
+
+// ---------------------- PUBLIC INTERFACE -----------------------
+
+// set_width(): modify the width of a node. If the third
+// parameter is false, don't update width sums (lazy mode,
+// see npsv_set_width(), which works like this one but
+// checks that numeric widths are not negative)
+//
+// Complexity: O(log N), or O(1) if update_sums==false
+// (plus the pending updates, if sums were out of date)
+
+template<class T,class A,class W,class P,class S>
+//not inline
+  void
+  avl_array<T,A,W,P,S>::set_width
+  (const typename avl_array<T,A,W,P,S>::iterator & it,
+   W w,
+   bool update_sums)
+{
+  node_t * p;
+
+  AA_ASSERT (it.ptr);                 // it must point somewhere
+  AA_ASSERT_HO (owner(it.ptr)==this); // it must point here
+
+  AA_ASSERT_EXC (it.ptr->m_parent,       // Can't change
+                 invalid_op_with_end()); // end's width
+
+  it.ptr->m_node_width = w;     // Set the new width
+
+  if (update_sums)              // If required, climb to the
+  {                             // root updating sums in the
+    for (p=it.ptr; p; p=p->m_parent)  // way, and then the
+      p->m_total_width =              // rest of the tree (if
+              p->subtree_width ();    // they were out of date)
+
+    if (m_sums_out_of_date)
+      npsv_update_sums ();
+  }
+  else                          // If no sums update, remember
+  {                             // the node (unless all sums
+    if (!m_sums_out_of_date ||  // must be updated anyway) and
+        !m_dirty.empty ())      // set NPSV dirty bit. With too
+      if (!m_dirty.push_back    // many nodes, forget them all
+             (it.ptr, size () / node_t::m_height))
+        m_dirty.clear ();
+
+    m_sums_out_of_date = true;
+  }
+}
+
+// reduce(): combine the widths of the elements in the range
+// [from,to), in order. The result for an empty range is the
+// identity, and for the whole array it's the total width
+//
+// Complexity: O(log N), or O(N) if sums are out of date
+
+template<class T,class A,class W,class P,class S>
+//not inline
+  W
+  avl_array<T,A,W,P,S>::reduce
+  (typename avl_array<T,A,W,P,S>::const_iterator from,
+   typename avl_array<T,A,W,P,S>::const_iterator to) const
+{
+  my_class * a, * b;
+  size_type lo, hi;
+
+  AA_ASSERT (from.ptr);        // NULL pointer dereference
+  AA_ASSERT (to.ptr);
+
+  lo = position_of_node (from.ptr, a, false);
+  hi = position_of_node (to.ptr, b, false);
+
+  AA_ASSERT (a==this && b==this);  // Both must point here
+
+  if (m_sums_out_of_date)
+    npsv_update_sums ();
+
+  return reduce_subtree (node_t::m_children[L], lo, hi);
+}
+
+// search(): find the first element e such that pred(w) is
+// true, being w the combination of the widths of all the
+// elements from begin() to e (both included). pred must be
+// false for the first prefixes and true for all the others
+// (e.g. with NPSV, "w > pos" finds the element at pos). If
+// pred is false for the whole array, return end().
+// It travels down from the root, accumulating the widths
+// left behind
+//
+// Complexity: O(log N), or O(N) if sums are out of date
+
+template<class T,class A,class W,class P,class S>
+template<class PRED>
+//not inline
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::search
+  (PRED pred)
+{
+  node_t * p;
+  W acc, w;
+
+  if (m_sums_out_of_date)
+    npsv_update_sums ();
+
+  acc = monoid_traits<W>::identity ();   // Width of the nodes
+  p = node_t::m_children[L];             // at the left side
+
+  while (p)
+  {
+    w = monoid_traits<W>::combine (acc, p->left_width ());
+
+    if (p->m_children[L] && pred (w))    // Found on the left?
+      p = p->m_children[L];
+    else
+    {
+      w = monoid_traits<W>::combine (w, p->m_node_width);
+
+      if (pred (w))                      // This one?
+        return p;
+
+      acc = w;                           // Go on to the right
+      p = p->m_children[R];
+    }
+  }
+
+  return dummy ();  // Not found
+}
+
+// search() _const_: See non-const version (above) for
+// details.
+
+template<class T,class A,class W,class P,class S>
+template<class PRED>
+inline
+  typename avl_array<T,A,W,P,S>::const_iterator
+  avl_array<T,A,W,P,S>::search
+  (PRED pred)                          const
+{
+  return (const_cast<my_class*>(this))->search (pred);
+}
+
+// ------------------- PRIVATE HELPER METHODS --------------------
+
+// reduce_subtree(): combine the widths of the positions
+// [lo,hi) of the subtree whose root is p. A subtree fully
+// inside the range contributes its total width. Otherwise,
+// the range is split among the left subtree, p and the
+// right subtree. Only the two paths to the ends of the range
+// are travelled
+//
+// Complexity: O(log N)
+
+template<class T,class A,class W,class P,class S>
+//not inline static
+  W
+  avl_array<T,A,W,P,S>::reduce_subtree
+  (const typename avl_array<T,A,W,P,S>::node_t * p,
+   typename avl_array<T,A,W,P,S>::size_type lo,
+   typename avl_array<T,A,W,P,S>::size_type hi)
+{
+  W w;
+  size_type l;
+
+  if (!p || lo>=hi)                 // Nothing here
+    return monoid_traits<W>::identity ();
+
+  if (!lo && hi>=p->m_count)        // The whole subtree
+    return p->m_total_width;
+
+  w = monoid_traits<W>::identity ();
+  l = p->left_count ();
+
+  if (lo<l)                                       // Left part
+    w = reduce_subtree (p->m_children[L],
+                        lo, hi<l ? hi : l);
+
+  if (lo<=l && l<hi)                              // p itself
+    w = monoid_traits<W>::combine (w, p->m_node_width);
+
+  if (hi>l+1)                                     // Right part
+    w = monoid_traits<W>::combine
+          (w, reduce_subtree (p->m_children[R],
+                              lo>l+1 ? lo-l-1 : 0, hi-l-1));
+  return w;
+}
+
+//////////////////////////////////////////////////////////////////
+
+}  // namespace mkr
+
+#endif
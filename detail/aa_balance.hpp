@@ -41,10 +41,10 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
   void
-  avl_array<T,A,W,P>::update_counters
-  (typename avl_array<T,A,W,P>::node_t * p)
+  avl_array<T,A,W,P,S>::update_counters
+  (typename avl_array<T,A,W,P,S>::node_t * p)
 {
   size_type i, j;
 
@@ -60,12 +60,11 @@ template<class T,class A,class W,class P>
                                  // The count is the sum of the
     p->m_count = i + j + 1;      // subtrees' counts plus one
 
-                                           // The width works
-    p->m_total_width = p->left_width () +  // like count, but
-                       p->right_width () + // adding the node's
-                       p->m_node_width;    // width instead of
-                                           // just 1
-
+                                         // The width works
+    p->m_total_width = p->subtree_width (); // like count, but
+                                         // combining the node's
+                                         // width instead of
+                                         // adding just 1
     p = p->m_parent;             // Step up
   }
 }
@@ -78,11 +77,11 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 // not inline
   void
-  avl_array<T,A,W,P>::update_counters_and_rebalance
-  (typename avl_array<T,A,W,P>::node_t * p)
+  avl_array<T,A,W,P,S>::update_counters_and_rebalance
+  (typename avl_array<T,A,W,P,S>::node_t * p)
 {
   size_type i, j;
   int s;
@@ -96,12 +95,11 @@ template<class T,class A,class W,class P>
     p->m_height = (i>j?i:j) + 1; // The height is that of the
                                  // largest branch, plus one
 
-                                           // The width works
-    p->m_total_width = p->left_width () +  // like count, but
-                       p->right_width () + // adding the node's
-                       p->m_node_width;    // width instead of
-                                           // just 1
-
+                                         // The width works
+    p->m_total_width = p->subtree_width (); // like count, but
+                                         // combining the node's
+                                         // width instead of
+                                         // adding just 1
     s = -1; // -1 means balanced
 
     if (p->m_parent)  // (don't re-balance dummy node)
@@ -268,9 +266,8 @@ template<class T,class A,class W,class P>
                                     // next iteration
       r->m_count = i + j + 1;
 
-      r->m_total_width = r->left_width () +  // Update B's
-                         r->right_width () + // width too
-                         r->m_node_width;
+      r->m_total_width = r->subtree_width (); // Update B's
+                                              // width too
     }
   }
 }
@@ -40,28 +40,28 @@ namespace mkr  // Public namespace
 // begin(): return an iterator pointing to the beginnig
 // of the sequence
 //
-// Complexity: O(1)
+// Complexity: O(1) (O(log N) without threads)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::begin ()
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::begin ()
 {
-  return iterator(node_t::m_next);
+  return iterator(next (dummy ()));
 }
 
 // begin()_const_: return an const_iterator (can be moved,
 // but can't modify the referenced data) pointing to the
 // beginnig of the sequence
 //
-// Complexity: O(1)
+// Complexity: O(1) (O(log N) without threads)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::const_iterator
-  avl_array<T,A,W,P>::begin () const
+  typename avl_array<T,A,W,P,S>::const_iterator
+  avl_array<T,A,W,P,S>::begin () const
 {
-  return const_iterator(node_t::m_next);
+  return const_iterator(next (dummy ()));
 }
 
 // end(): return an iterator pointing to the end of the
@@ -69,10 +69,10 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::end ()
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::end ()
 {
   return iterator(dummy());
 }
@@ -84,10 +84,10 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::const_iterator
-  avl_array<T,A,W,P>::end () const
+  typename avl_array<T,A,W,P,S>::const_iterator
+  avl_array<T,A,W,P,S>::end () const
 {
   return const_iterator(dummy());
 }
@@ -95,28 +95,28 @@ inline
 // rbegin(): return a reverse iterator pointing to the
 // beginnig of the reverse sequence (the last element)
 //
-// Complexity: O(1)
+// Complexity: O(1) (O(log N) without threads)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reverse_iterator
-  avl_array<T,A,W,P>::rbegin ()
+  typename avl_array<T,A,W,P,S>::reverse_iterator
+  avl_array<T,A,W,P,S>::rbegin ()
 {
-  return reverse_iterator(node_t::m_prev);
+  return reverse_iterator(prev (dummy ()));
 }
 
 // rbegin()_const_: return a const reverse iterator
 // pointing to the beginnig of the reverse sequence
 // (the last element)
 //
-// Complexity: O(1)
+// Complexity: O(1) (O(log N) without threads)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::const_reverse_iterator
-  avl_array<T,A,W,P>::rbegin () const
+  typename avl_array<T,A,W,P,S>::const_reverse_iterator
+  avl_array<T,A,W,P,S>::rbegin () const
 {
-  return const_reverse_iterator(node_t::m_prev);
+  return const_reverse_iterator(prev (dummy ()));
 }
 
 // rend(): return a reverse iterator pointing to the end of
@@ -125,10 +125,10 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reverse_iterator
-  avl_array<T,A,W,P>::rend ()
+  typename avl_array<T,A,W,P,S>::reverse_iterator
+  avl_array<T,A,W,P,S>::rend ()
 {
   return reverse_iterator(dummy());
 }
@@ -139,10 +139,10 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::const_reverse_iterator
-  avl_array<T,A,W,P>::rend () const
+  typename avl_array<T,A,W,P,S>::const_reverse_iterator
+  avl_array<T,A,W,P,S>::rend () const
 {
   return const_reverse_iterator(dummy());
 }
@@ -10,9 +10,12 @@
   detail/aa_build_list.hpp
   ------------------------
 
-  Private helper method for massive operations (temp. lists)
+  Private helper methods for massive operations (temp. lists)
 
   construct_nodes_list(): prepare a list of new nodes (O(N))
+  construct_nodes_list_nothrow(): idem, without rollback_list
+  flatten(): turn the tree into a list (O(N) without threads)
+  detach_list(): turn the tree into a NULL terminated list
 */
 
 #ifndef _AVL_ARRAY_BUILD_LIST_HPP_
@@ -35,23 +38,27 @@ namespace mkr  // Public namespace
 // called data_provider, or default constructed if the
 // functor returns NULL. The functor can be any object with
 // an overloaded operator () that returns pointers to
-// existing T objects, or NULL. Finally, return the number
-// of objects constructed.
+// existing T objects, or NULL (objects given by a
+// move_data_provider are moved instead of copied). Finally,
+// return the number of objects constructed.
 // If an exception occurs, roll back (destroy the already
-// constructed objects) and re-throw the exception
+// constructed objects) and re-throw the exception. When the
+// T constructors used can't throw (see nothrow_provided in
+// data_provider.hpp), construct_nodes_list_nothrow() does
+// the work instead
 //
 // Complexity: O(n)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class DP>
 //not inline
-  typename avl_array<T,A,W,P>::size_type    // # of nodes created
-  avl_array<T,A,W,P>::construct_nodes_list
+  typename avl_array<T,A,W,P,S>::size_type    // # of nodes created
+  avl_array<T,A,W,P,S>::construct_nodes_list
 
-  (typename avl_array<T,A,W,P>::node_t *& first, // First and last
-   typename avl_array<T,A,W,P>::node_t *& last,  // of the list
+  (typename avl_array<T,A,W,P,S>::node_t *& first, // First and last
+   typename avl_array<T,A,W,P,S>::node_t *& last,  // of the list
 
-   typename avl_array<T,A,W,P>::size_type n, // # nodes to create
+   typename avl_array<T,A,W,P,S>::size_type n, // # nodes to create
 
    DP & data_provider,         // Functor whose operator ()
                                // will provide pointers to
@@ -64,6 +71,11 @@ template<class DP>
   size_type count;             // returns NULL
   const_pointer t;
   node_t * newnode;
+
+  if (nothrow_provided<DP,value_type>::value)   // Fast path
+    return construct_nodes_list_nothrow (first, last, n,
+                                         data_provider,
+                                         reverse, exhaust_dp);
   rollback_list_t nodes_list(this);
 
   first = last = NULL;    // Start with an empty list
@@ -77,8 +89,8 @@ template<class DP>
       !t && !n)           // stop when data_provider
     return 0;             // returns NULL
 
-  newnode = new_node (t);   // t ? copy : default
-
+  newnode = new_node (t, data_provider); // t ? copy/move
+                                         //   : default
   nodes_list.push_back (newnode);
 
   for (count=1; exhaust_dp || count<n; count ++)
@@ -89,8 +101,8 @@ template<class DP>
         count>=n)            // specified, stop when
       break;                 // data_prov. returns NULL
 
-    newnode = new_node (t);  // t ? copy : default
-
+    newnode = new_node (t, data_provider); // t ? copy/move
+                                           //   : default
     if (reverse)
       nodes_list.push_front (newnode);
     else
@@ -102,6 +114,156 @@ template<class DP>
   return count;  // Number of objects actually constructed
 }
 
+// construct_nodes_list_nothrow(): Same as
+// construct_nodes_list(), for T constructors that can't
+// throw. Nodes are linked directly into a NULL terminated
+// list (only list_next() links are set, which is all that
+// the callers use), without the rollback_list bookkeeping.
+// With a pool allocator, room for the n nodes is reserved
+// in advance. Allocation (or the data provider) can still
+// throw: then the nodes of the list are deleted before
+// re-throwing the exception
+//
+// Complexity: O(n)
+
+template<class T,class A,class W,class P,class S>
+template<class DP>
+//not inline
+  typename avl_array<T,A,W,P,S>::size_type    // # of nodes created
+  avl_array<T,A,W,P,S>::construct_nodes_list_nothrow
+
+  (typename avl_array<T,A,W,P,S>::node_t *& first, // First and last
+   typename avl_array<T,A,W,P,S>::node_t *& last,  // of the list
+
+   typename avl_array<T,A,W,P,S>::size_type n, // # nodes to create
+
+   DP & data_provider,         // Functor whose operator ()
+                               // will provide pointers to
+                               // the objects to copy
+
+   bool reverse,               // Direction
+
+   bool exhaust_dp)            // Take objects from
+{                              // data_provider until it
+  size_type count;             // returns NULL
+  const_pointer t;
+  node_t * newnode;
+
+  first = last = NULL;    // Start with an empty list
+
+  pool_traits<allocator_t>::reserve (allocator, n);
+
+  try
+  {
+    for (count=0; exhaust_dp || count<n; count ++)
+    {
+      t = data_provider ();    // Get next object to copy
+
+      if (exhaust_dp && !t &&  // If the number was not
+          count>=n)            // specified, stop when
+        break;                 // data_prov. returns NULL
+
+      newnode = new_node (t, data_provider); // t ? copy/move
+                                             //   : default
+      if (!first)
+      {
+        newnode->list_next () = NULL;   // First one: it will
+        first = last = newnode;         // be the last one too
+      }                                 // in reverse order
+      else if (reverse)
+      {
+        newnode->list_next () = first;  // Prepend
+        first = newnode;
+      }
+      else
+      {
+        last->list_next () = newnode;   // Append
+        last = newnode;
+      }
+    }
+
+    if (last)
+      last->list_next () = NULL;        // Terminate the list
+  }
+  catch (...)
+  {
+    if (last)                           // Delete what was built
+      last->list_next () = NULL;        // and re-throw
+
+    while (first)
+    {
+      newnode = first;
+      first = first->list_next ();
+      delete_node (newnode);
+    }
+
+    throw;
+  }
+
+  return count;  // Number of objects actually constructed
+}
+
+// flatten(): Make the list links (list_next()/list_prev())
+// of all nodes and the dummy form a circular doubly linked
+// list, in order. With threads, they already do (they are
+// m_next/m_prev). Without threads, they are the children
+// pointers, so the tree is turned into a vine by right
+// rotations (the first half of the Day-Stout-Warren
+// algorithm), and then the left links are fixed. Note that
+// the tree is destroyed: only list operations and
+// build_known_size_tree() can be used after this
+//
+// Complexity: O(1) with threads, O(N) without them
+
+template<class T,class A,class W,class P,class S>
+//not inline
+  void avl_array<T,A,W,P,S>::flatten ()
+{
+  node_t * rest, * tail, * q;
+
+  if (S::threaded)          // Already a list
+    return;
+
+  rest = dummy ()->m_children[L];   // The tree
+  tail = dummy ();                  // End of the vine
+
+  while (rest)
+    if (rest->m_children[L])        // Rotate right until
+    {                               // there's no left
+      q = rest->m_children[L];      // subtree
+      rest->m_children[L] = q->m_children[R];
+      q->m_children[R] = rest;
+      rest = q;
+    }
+    else                            // Then this is the next
+    {                               // node: append it to the
+      tail->m_children[R] = rest;   // vine and go on with its
+      rest->m_children[L] = tail;   // right subtree
+      tail = rest;
+      rest = rest->m_children[R];
+    }
+
+  tail->m_children[R] = dummy ();   // Close the circle
+  dummy ()->m_children[L] = tail;
+}
+
+// detach_list(): Turn the whole tree into a NULL terminated
+// list of nodes (linked with list_next()) and return its
+// first node. The tree is left invalid: it must be rebuilt
+// with init() or build_known_size_tree()
+//
+// Complexity: O(1) with threads, O(N) without them
+
+template<class T,class A,class W,class P,class S>
+inline
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::detach_list ()
+{
+  flatten ();
+  node_t::list_prev ()->list_next () = NULL;
+  return node_t::list_next ();
+}
+
 //////////////////////////////////////////////////////////////////
 
 }  // namespace mkr
@@ -36,12 +36,12 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::worth_rebuild
-  (typename avl_array<T,A,W,P>::size_type n, // # to insert/erase
-   typename avl_array<T,A,W,P>::size_type N, // Current size
+  avl_array<T,A,W,P,S>::worth_rebuild
+  (typename avl_array<T,A,W,P,S>::size_type n, // # to insert/erase
+   typename avl_array<T,A,W,P,S>::size_type N, // Current size
    bool erase)                               // true=erase,
 {                                            //   false=insert
   size_type average_size, final_size, ratio;
@@ -85,14 +85,15 @@ inline
 //
 // Complexity: O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
-  typename avl_array<T,A,W,P>::node_t *     // First unused node
-  avl_array<T,A,W,P>::build_known_size_tree
-  (typename avl_array<T,A,W,P>::size_type n,   // Total # of nodes
-   typename avl_array<T,A,W,P>::node_t * next) // List with nodes
+  typename avl_array<T,A,W,P,S>::node_t *     // First unused node
+  avl_array<T,A,W,P,S>::build_known_size_tree
+  (typename avl_array<T,A,W,P,S>::size_type n,   // Total # of nodes
+   typename avl_array<T,A,W,P,S>::node_t * next) // List with nodes
 {                                              // to link
   size_type depth;     // Current depth
+  W w;                 // Width of the current node
   node_t * p, * last;  // Current and last nodes
 
   size_type                 // Per level: number of nodes
@@ -131,14 +132,15 @@ template<class T,class A,class W,class P>
 
     AA_ASSERT (next);   // Enough nodes in the list?
 
-    p = next;              // Grab the next node
-    next = next->m_next;   // Advance in the list
-    p->init ();            // Clear the node
+    p = next;                  // Grab the next node
+    next = next->list_next (); // Advance in the list
+    w = p->m_node_width;       // Clear the node, but keep
+    p->init ();                // its NPSV width
+    p->m_node_width = p->m_total_width = w;
 
-    p->m_prev = last;          // Insert the node after the
-    p->m_next = last->m_next;  // last one in the circular
-    p->m_prev->m_next = p;     // doubly linked list
-    p->m_next->m_prev = p;
+    threads_t::link (last, p);     // Insert the node after the
+    threads_t::link (p, dummy ()); // last one in the circular
+                                   // doubly linked list (if any)
                                // The last one is now the one
     last = p;                  // we've just inserted
 
@@ -152,8 +154,9 @@ template<class T,class A,class W,class P>
       p->m_count += nodes[depth+1]->m_count;
       p->m_height += nodes[depth+1]->m_height; // Link it
 
-      p->m_total_width = p->m_node_width +
-                         nodes[depth+1]->m_total_width;
+      p->m_total_width = monoid_traits<W>::combine
+                           (nodes[depth+1]->m_total_width,
+                            p->m_node_width);
 
       nodes[depth+1] = NULL;                   // Forget it
     }
@@ -188,7 +191,9 @@ template<class T,class A,class W,class P>
           nodes[depth+1] = NULL;         // its right subtree
           p->m_parent = nodes[depth];
 
-          nodes[depth]->m_total_width += p->m_total_width;
+          nodes[depth]->m_total_width =
+              monoid_traits<W>::combine
+                (nodes[depth]->m_total_width, p->m_total_width);
 
           nodes[depth]->m_children[R] = p;      // Link it
           nodes[depth]->m_count += p->m_count;  // (the height
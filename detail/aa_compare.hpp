@@ -46,11 +46,11 @@ namespace mkr  // Public namespace
 // (where N is the number of T objects in the smaller
 // avl_array)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline  MKR: should I make inline at least the 1st part?
   bool
-  avl_array<T,A,W,P>::operator==
-  (const typename avl_array<T,A,W,P>::my_class & a)   const
+  avl_array<T,A,W,P,S>::operator==
+  (const typename avl_array<T,A,W,P,S>::my_class & a)   const
 {
   if (size()!=a.size()) return false; // If they have different
                                       // sizes, they can't be
@@ -69,11 +69,11 @@ template<class T,class A,class W,class P>
 // (where N is the number of T objects in the smaller
 // avl_array)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::operator!=
-  (const typename avl_array<T,A,W,P>::my_class & a)   const
+  avl_array<T,A,W,P,S>::operator!=
+  (const typename avl_array<T,A,W,P,S>::my_class & a)   const
 {
   return !(*this==a);
 }
@@ -89,11 +89,11 @@ inline
 // (where N is the number of T objects in the smaller
 // avl_array)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline  MKR: should I make inline at least the 1st part?
   bool
-  avl_array<T,A,W,P>::operator<
-  (const typename avl_array<T,A,W,P>::my_class & a)   const
+  avl_array<T,A,W,P,S>::operator<
+  (const typename avl_array<T,A,W,P,S>::my_class & a)   const
 {
   if (!size()) return a.size()!=0;  // Both empty --> equal
                                     // This empty --> lesser
@@ -114,11 +114,11 @@ template<class T,class A,class W,class P>
 // (where N is the number of T objects in the smaller
 // avl_array)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::operator>
-  (const typename avl_array<T,A,W,P>::my_class & a)   const
+  avl_array<T,A,W,P,S>::operator>
+  (const typename avl_array<T,A,W,P,S>::my_class & a)   const
 {
   return a<*this;
 }
@@ -129,11 +129,11 @@ inline
 // (where N is the number of T objects in the smaller
 // avl_array)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::operator<=
-  (const typename avl_array<T,A,W,P>::my_class & a)   const
+  avl_array<T,A,W,P,S>::operator<=
+  (const typename avl_array<T,A,W,P,S>::my_class & a)   const
 {
   return !(a<*this);
 }
@@ -144,11 +144,11 @@ inline
 // (where N is the number of T objects in the smaller
 // avl_array)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::operator>=
-  (const typename avl_array<T,A,W,P>::my_class & a)   const
+  avl_array<T,A,W,P,S>::operator>=
+  (const typename avl_array<T,A,W,P,S>::my_class & a)   const
 {
   return !(*this<a);
 }
@@ -18,7 +18,10 @@
   Vector def. con.: " with n default-constructed elem. (O(N))
   Sequence con.: " with copies of [from,to) (O(N))
   Sequence con.: " with copies of [from,from+n) (O(N))
+  Move con.: take the contents of other avl_array (O(1))*
+  Sequence move con.: " moving the objects of [from,to) (O(N))*
   Destructor (O(N))
+  (*) C++11 only
 
   Private helper method:
 
@@ -43,9 +46,9 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  avl_array<T,A,W,P>::avl_array ()
+  avl_array<T,A,W,P,S>::avl_array ()
 {
   init ();
 }
@@ -57,10 +60,10 @@ inline
 //
 // Complexity: O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  avl_array<T,A,W,P>::avl_array
-  (const typename avl_array<T,A,W,P>::my_class & a)
+  avl_array<T,A,W,P,S>::avl_array
+  (const typename avl_array<T,A,W,P,S>::my_class & a)
 {
   node_t * first, * last;
   iter_data_provider<const_pointer,
@@ -78,11 +81,11 @@ inline
 //
 // Complexity: O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  avl_array<T,A,W,P>::avl_array
-  (typename avl_array<T,A,W,P>::size_type n,
-   typename avl_array<T,A,W,P>::const_reference t)
+  avl_array<T,A,W,P,S>::avl_array
+  (typename avl_array<T,A,W,P,S>::size_type n,
+   typename avl_array<T,A,W,P,S>::const_reference t)
 {
   node_t * first, * last;
   copy_data_provider<const_pointer> dp(&t);
@@ -91,11 +94,11 @@ inline
   build_known_size_tree (n, first);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  avl_array<T,A,W,P>::avl_array
+  avl_array<T,A,W,P,S>::avl_array
   (int n,
-   typename avl_array<T,A,W,P>::const_reference t)
+   typename avl_array<T,A,W,P,S>::const_reference t)
 {
   node_t * first, * last;
   copy_data_provider<const_pointer> dp(&t);
@@ -105,11 +108,11 @@ inline
   build_known_size_tree (n, first);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  avl_array<T,A,W,P>::avl_array
+  avl_array<T,A,W,P,S>::avl_array
   (long n,
-   typename avl_array<T,A,W,P>::const_reference t)
+   typename avl_array<T,A,W,P,S>::const_reference t)
 {
   node_t * first, * last;
   copy_data_provider<const_pointer> dp(&t);
@@ -125,10 +128,10 @@ inline
 //
 // Complexity: O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  avl_array<T,A,W,P>::avl_array
-  (typename avl_array<T,A,W,P>::size_type n)
+  avl_array<T,A,W,P,S>::avl_array
+  (typename avl_array<T,A,W,P,S>::size_type n)
 {
   node_t * first, * last;
   null_data_provider<const_pointer> dp;
@@ -144,10 +147,10 @@ inline
 //
 // Complexity: O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template <class IT>
 inline
-  avl_array<T,A,W,P>::avl_array (IT from, IT to)
+  avl_array<T,A,W,P,S>::avl_array (IT from, IT to)
 {
 #ifdef BOOST_CLASS_REQUIRE
   function_requires< InputIteratorConcept<IT> >();
@@ -167,12 +170,12 @@ inline
 //
 // Complexity: O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template <class IT>
 inline
-  avl_array<T,A,W,P>::avl_array
+  avl_array<T,A,W,P,S>::avl_array
   (IT from,
-   typename avl_array<T,A,W,P>::size_type n)
+   typename avl_array<T,A,W,P,S>::size_type n)
 {
 #ifdef BOOST_CLASS_REQUIRE
   function_requires< InputIteratorConcept<IT> >();
@@ -185,13 +188,57 @@ inline
   build_known_size_tree (n, first);
 }
 
+#if __cplusplus >= 201103L
+
+// Move constructor: create an avl_array taking the tree of
+// a, which is left empty. No T object is touched, and no
+// node is allocated, so iterators to the elements of a
+// (but not end()) remain valid, now referring to elements
+// of the new avl_array. The NPSV dirty state goes with the
+// tree
+//
+// Complexity: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline
+  avl_array<T,A,W,P,S>::avl_array
+  (typename avl_array<T,A,W,P,S>::my_class && a) noexcept
+{
+  init ();
+  swap (a);
+}
+
+// Sequence [from,to) move constructor: like the sequence
+// constructor (see above), but the objects are moved from
+// the sequence instead of copied (e.g. with
+// std::make_move_iterator(v.begin()), ...(v.end()))
+//
+// Complexity: O(N)
+
+template<class T,class A,class W,class P,class S>
+template <class IT>
+inline
+  avl_array<T,A,W,P,S>::avl_array
+  (std::move_iterator<IT> from,
+   std::move_iterator<IT> to)
+{
+  node_t * first, * last;
+  move_data_provider<const_pointer,IT> dp(from.base(),to.base());
+  size_type n;
+
+  n = construct_nodes_list (first, last, 0, dp, false, true);
+  build_known_size_tree (n, first);
+}
+
+#endif
+
 // Destructor: deallocate contents
 //
 // Complexity: O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  avl_array<T,A,W,P>::~avl_array ()
+  avl_array<T,A,W,P,S>::~avl_array ()
 {
   clear ();  // (See impl. of clear() in erase.hpp)
 }
@@ -203,21 +250,23 @@ inline
 // corresponding to an "empty" state (O(1), regarded that W's
 // constructor is O(1) ;)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline void
-  avl_array<T,A,W,P>::init ()
+  avl_array<T,A,W,P,S>::init ()
 {
   node_t::m_parent =
   node_t::m_children[0] =
   node_t::m_children[1] = NULL;               // Lonely node
 
-  node_t::m_next = node_t::m_prev = dummy (); // List: loop
+  threads_t::link (dummy (), dummy ());        // List: loop
   node_t::m_count = node_t::m_height = 1;     // Nodes: one (dummy)
 
   node_t::m_node_width =
-  node_t::m_total_width = W(0);            // Zero width
+  node_t::m_total_width =                  // Zero width
+                monoid_traits<W>::identity ();
 
   m_sums_out_of_date = false;      // Sums up to date
+  m_dirty.release ();              // (no dirty nodes)
 }
 
 //////////////////////////////////////////////////////////////////
@@ -17,7 +17,9 @@
   rit erase(rit,n): vector-erase (reverse) (O(min{N, n log N}))
   it erase(from,to): range-erase (O(min{N, n log N}))
   rit erase(rfrom,rto): range-erase (reverse) (O(min{N, n log N}))
-  clear(): delete all (O(N))
+  remove_if(pred): erase where pred is true (O(min{N, n log N}))
+  erase_positions(from,to): erase sorted positions (idem)
+  clear(): delete all (O(N), or O(chunks) with a pool*)
 
   Private helper methods:
 
@@ -45,20 +47,20 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::erase
-  (typename avl_array<T,A,W,P>::iterator it)
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::erase
+  (typename avl_array<T,A,W,P,S>::iterator it)
 {
   return erase_it (it);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reverse_iterator
-  avl_array<T,A,W,P>::erase
-  (typename avl_array<T,A,W,P>::reverse_iterator it)
+  typename avl_array<T,A,W,P,S>::reverse_iterator
+  avl_array<T,A,W,P,S>::erase
+  (typename avl_array<T,A,W,P,S>::reverse_iterator it)
 {
   return erase_it (it);
 }
@@ -68,22 +70,22 @@ inline
 //
 // Complexity: O(min{N, n log N})
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::erase
-  (typename avl_array<T,A,W,P>::iterator from,
-   typename avl_array<T,A,W,P>::size_type n)
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::erase
+  (typename avl_array<T,A,W,P,S>::iterator from,
+   typename avl_array<T,A,W,P,S>::size_type n)
 {
   return erase_it (from, n); // Just call private templ. method
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reverse_iterator
-  avl_array<T,A,W,P>::erase
-  (typename avl_array<T,A,W,P>::reverse_iterator from,
-   typename avl_array<T,A,W,P>::size_type n)
+  typename avl_array<T,A,W,P,S>::reverse_iterator
+  avl_array<T,A,W,P,S>::erase
+  (typename avl_array<T,A,W,P,S>::reverse_iterator from,
+   typename avl_array<T,A,W,P,S>::size_type n)
 {
   return erase_it (from, n); // Just call private templ. method
 }
@@ -93,12 +95,12 @@ inline
 //
 // Complexity: O(min{N, n log N})
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::erase
-  (typename avl_array<T,A,W,P>::iterator from,
-   typename avl_array<T,A,W,P>::iterator to)
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::erase
+  (typename avl_array<T,A,W,P,S>::iterator from,
+   typename avl_array<T,A,W,P,S>::iterator to)
 {
   AA_ASSERT_HO (owner(from.ptr)==this); // from and to must point
   AA_ASSERT_HO (owner(to.ptr)==this);   // into this array
@@ -106,12 +108,12 @@ inline
   return erase_it (from, to-from); // Get the difference and use
 }                                  // vector erase
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reverse_iterator
-  avl_array<T,A,W,P>::erase
-  (typename avl_array<T,A,W,P>::reverse_iterator from,
-   typename avl_array<T,A,W,P>::reverse_iterator to)
+  typename avl_array<T,A,W,P,S>::reverse_iterator
+  avl_array<T,A,W,P,S>::erase
+  (typename avl_array<T,A,W,P,S>::reverse_iterator from,
+   typename avl_array<T,A,W,P,S>::reverse_iterator to)
 {
   AA_ASSERT_HO (owner(from.ptr)==this); // from and to must point
   AA_ASSERT_HO (owner(to.ptr)==this);   // into this array
@@ -119,27 +121,213 @@ inline
   return erase_it (from, to-from); // Get the difference and use
 }                                  // vector erase
 
+// remove_if(): erase all the elements for which pred returns
+// true (pred is called once per element, in sequence order),
+// and return how many were erased. While it's cheaper than
+// rebuilding the tree (see worth_rebuild()), they are erased
+// one by one. From then on, the rest of the sequence is
+// scanned as a list, unlinking the matching nodes, and the
+// tree is rebuilt at the end. The remaining nodes are not
+// moved, so iterators to them remain valid. If pred throws,
+// the elements already found are erased anyway
+//
+// Complexity: O(min{N, n log N}) (plus N calls to pred)
+
+template<class T,class A,class W,class P,class S>
+template<class PRED>
+//not inline
+  typename avl_array<T,A,W,P,S>::size_type
+  avl_array<T,A,W,P,S>::remove_if
+  (PRED pred)
+{
+  node_t * p, * q, * r;
+  size_type N, n;
+
+  if (!m_dirty.empty ())     // Update pending NPSV paths now
+    npsv_update_sums ();     // (delete_node() forgets them)
+
+  N = size ();
+  n = 0;
+
+  for (p=next (dummy ()); p!=dummy (); p=q)   // While they are
+  {                                           // few, erase them
+    q = next (p);                             // one by one
+
+    if (!pred (data (p)))
+      continue;
+
+    if (worth_rebuild (n+1, N, true))  // Too many: go on
+      break;                           // with the list
+
+    r = extract_node (p);
+    update_counters_and_rebalance (r);
+    delete_node (p);
+    n ++;
+  }
+
+  if (p==dummy ())           // Done?
+    return n;
+
+  flatten ();                // p must be erased, and maybe
+                             // many others
+  try
+  {
+    do
+    {
+      q = p->list_next ();                  // Unlink p from the
+      q->list_prev () = p->list_prev ();    // circular doubly
+      p->list_prev ()->list_next () = q;    // linked list and
+      delete_node (p);                      // delete it
+      n ++;
+
+      for (p=q; p!=dummy () &&              // Look for the
+                !pred (data (p));           // next one
+           p=p->list_next ());
+    }
+    while (p!=dummy ());
+  }
+  catch (...)
+  {
+    build_known_size_tree (N-n, node_t::list_next ());
+    throw;
+  }
+
+  build_known_size_tree (N-n, node_t::list_next ());
+  return n;
+}
+
+// erase_positions(): erase the elements whose positions (as
+// they were before the call) are given in the sequence
+// [from,to), sorted in ascending order (repeated positions
+// are erased only once). Return how many were erased. Like
+// remove_if(), they are erased one by one, reaching every
+// position from the root, while it's cheaper than rebuilding
+// the tree; then, the rest of the positions are reached
+// stepping along the list. Iterators to the remaining
+// elements remain valid
+//
+// Complexity: O(min{N, n log N})
+
+template<class T,class A,class W,class P,class S>
+template<class IT>
+//not inline
+  typename avl_array<T,A,W,P,S>::size_type
+  avl_array<T,A,W,P,S>::erase_positions
+  (IT from, IT to)
+{
+  node_t * p, * q, * r;
+  size_type N, n, pos, last, cur;
+
+  if (!m_dirty.empty ())     // Update pending NPSV paths now
+    npsv_update_sums ();     // (delete_node() forgets them)
+
+  N = size ();
+  n = last = 0;
+  p = NULL;
+
+  for (; from!=to; ++ from)  // While they are few, erase them
+  {                          // one by one
+    pos = *from;
+
+    if (n && pos==last)      // Repeated
+      continue;
+
+    AA_ASSERT (!n || pos>last);   // Must be sorted
+    AA_ASSERT_EXC (pos<N, index_out_of_bounds());
+
+    p = node_at_pos (pos-n);    // (n elements before it have
+                                // been erased)
+    if (worth_rebuild (n+1, N, true))  // Too many: go on
+      break;                           // with the list
+
+    r = extract_node (p);
+    update_counters_and_rebalance (r);
+    delete_node (p);
+    n ++;
+    last = pos;
+  }
+
+  if (from==to)              // Done?
+    return n;
+
+  flatten ();                // p (at position pos) must be
+  cur = pos;                 // erased, and maybe many others
+
+  try
+  {
+    for (;;)
+    {
+      q = p->list_next ();                  // Unlink p from the
+      q->list_prev () = p->list_prev ();    // circular doubly
+      p->list_prev ()->list_next () = q;    // linked list and
+      delete_node (p);                      // delete it
+      n ++;
+      last = pos;
+
+      p = q;                                // p is now at the
+      cur ++;                               // next position
+
+      do                                    // Skip repeated
+        ++ from;                            // positions
+      while (from!=to && size_type(*from)==last);
+
+      if (from==to)
+        break;
+
+      pos = *from;
+
+      AA_ASSERT (pos>last);                 // Must be sorted
+      AA_ASSERT_EXC (pos<N, index_out_of_bounds());
+
+      for (; cur<pos; cur++)                // Step to the
+        p = p->list_next ();                // next one
+    }
+  }
+  catch (...)
+  {
+    build_known_size_tree (N-n, node_t::list_next ());
+    throw;
+  }
+
+  build_known_size_tree (N-n, node_t::list_next ());
+  return n;
+}
+
 // clear(): delete all the contents of the array, leaving
-// it empty
+// it empty. If the nodes come from a pool allocator that
+// contains nothing else, and destructing them is a no-op,
+// the whole pool is freed at once instead of node by node.
+// The pool is shared by all the arrays with the same
+// allocator type and Tag, so this only happens while the
+// others are empty. If the pool gets empty, its memory is
+// freed as well
 //
-// Complexity: O(N)
+// Complexity: O(N), or O(chunks) with a pool (see above)
 
-template<class T,class A,class W,class P>
-void avl_array<T,A,W,P>::clear ()
+template<class T,class A,class W,class P,class S>
+void avl_array<T,A,W,P,S>::clear ()
 {
   node_t * p, * q;
 
-  node_t::m_prev->m_next = NULL;
-  p = node_t::m_next;
+  if (trivially_destructible<payload_node_t>::value &&
+      pool_traits<allocator_t>::release (allocator, size ()))
+  {
+    init ();           // The nodes are gone (nothing to do
+    return;            // with them, as they were trivial)
+  }
+
+  p = detach_list ();
 
   init ();             // Reset
 
   while (p)
   {
-    q = p;             // Traverse the list
-    p = p->m_next;     // deleting every element
+    q = p;                // Traverse the list
+    p = p->list_next ();  // deleting every element
     delete_node (q);
   }
+
+  pool_traits<allocator_t>::trim (allocator);
 }
 
 
@@ -152,11 +340,11 @@ void avl_array<T,A,W,P>::clear ()
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
-  typename avl_array<T,A,W,P>::node_t *
-  avl_array<T,A,W,P>::extract_node
-  (typename avl_array<T,A,W,P>::node_t * p)
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::extract_node
+  (typename avl_array<T,A,W,P,S>::node_t * p)
 {
   node_t * q, * r, * w;
   size_type cl, cr;
@@ -213,12 +401,12 @@ template<class T,class A,class W,class P>
     if (cl>cr)   // occupied, so both next and previous nodes
     {            // of the victim are down there
       side = L;
-      w = p->m_prev;
+      w = prev (p);
     }                  // Choose one of them (the one in
     else               // the most populated subtree), and
     {                  // put it in the place of the victim
       side = R;
-      w = p->m_next;
+      w = next (p);
     }                  // Potentially unbalanced branch: from
                        // the subsitute's parent and upwards
     r = w->m_parent;
@@ -242,8 +430,9 @@ template<class T,class A,class W,class P>
       q->m_children[R] = w;
   }
 
-  p->m_next->m_prev = p->m_prev;  // Bypass the victim in the
-  p->m_prev->m_next = p->m_next;  // circ. doubly linked list
+  threads_t::link (threads_t::prev (p),  // Bypass the victim in
+                   threads_t::next (p)); // the circular doubly
+                                         // linked list (if any)
 
   return r;  // Potentially unbalanced branch
 }            // (from r and upwards until the root)
@@ -254,10 +443,10 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class IT>
 inline
-  IT avl_array<T,A,W,P>::erase_it (IT it)
+  IT avl_array<T,A,W,P,S>::erase_it (IT it)
 {
 #ifdef BOOST_CLASS_REQUIRE
 #ifdef AA_USE_RANDOM_ACCESS_TAG
@@ -274,6 +463,9 @@ inline
   AA_ASSERT_HO (owner(it.ptr)==this); // it must point into
                                       // this arr.
 
+  if (!m_dirty.empty ())     // Update pending NPSV paths now
+    npsv_update_sums ();     // (delete_node() forgets them)
+
   p = it.ptr;
   ++ it;
   r = extract_node (p);
@@ -291,19 +483,19 @@ inline
 //
 // Complexity: (O(min{N, n log N})
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template <class IT>
 //not inline
   bool                              // Return true iff dst belongs
-  avl_array<T,A,W,P>::extract_nodes // to the extracted range
+  avl_array<T,A,W,P,S>::extract_nodes // to the extracted range
 
   (IT & from,                                // Source
-   typename avl_array<T,A,W,P>::size_type n, // # nodes to extract
+   typename avl_array<T,A,W,P,S>::size_type n, // # nodes to extract
 
-   typename avl_array<T,A,W,P>::node_t *& first, // List with
-   typename avl_array<T,A,W,P>::node_t *& last,  // extracted nodes
+   typename avl_array<T,A,W,P,S>::node_t *& first, // List with
+   typename avl_array<T,A,W,P,S>::node_t *& last,  // extracted nodes
 
-   typename avl_array<T,A,W,P>::node_t * dst, // Dest. to check
+   typename avl_array<T,A,W,P,S>::node_t * dst, // Dest. to check
 
    bool * delayed_rebuild,  // In: non-NULL means "delay tree
                             // reconstruction, cause the same tree
@@ -325,9 +517,9 @@ template <class IT>
 #endif
 #endif
 
-  node_t * p, * r;
+  node_t * p, * q, * r;
   size_type i;
-  bool dst_extracted;
+  bool dst_extracted, forward;
 
   first = last = NULL;
   if (n==0) return false;
@@ -352,13 +544,13 @@ template <class IT>
                                          // every time
       if (reverse)
       {                                  // Build the list
-        p->m_next = first;               // according to the
-        first = first->m_prev = p;       // direction of the
+        p->list_next () = first;         // according to the
+        first = first->list_prev () = p; // direction of the
       }                                  // iterator that
       else                               // specified the
       {                                  // destination point
-        p->m_prev = last;
-        last = last->m_next = p;
+        p->list_prev () = last;
+        last = last->list_next () = p;
       }
                          // Advance. Note that ++from is
       p = from.ptr;      // performed prior to extraction
@@ -366,46 +558,50 @@ template <class IT>
   }
   else             // If there are 'many' elements to extract
   {
-    first = last = p = from.ptr;
-                                         // Be careful:
+    forward = !is_reverse (from);        // (The tree is not
+    flatten ();                          // usable from here on,
+    first = last = p = from.ptr;         // so step in the list
+                                         // instead of ++from)
     for (i=0; i<n && p->m_parent; i++)   // from can be a
     {                                    // REVERSE iterator!
-                                         // (use its ++ optor.)
-                                         // and don't extract end
-
+                                         // Don't extract end
       if (p==dst)                        // Detect src-dest
         dst_extracted = true;            // overlapping
 
-                                         // Just extract them
-      ++ from;                           // from the circular
-      p->m_next->m_prev = p->m_prev;     // doubly linked list
-      p->m_prev->m_next = p->m_next;     // and reorganize the
-                                         // whole tree later
+      q = forward ? p->list_next () :    // Just extract them
+                    p->list_prev ();     // from the circular
+      p->list_next ()->list_prev () =    // doubly linked list
+                    p->list_prev ();     // and reorganize the
+      p->list_prev ()->list_next () =    // whole tree later
+                    p->list_next ();
+
       if (reverse)
       {                                  // Build the list
-        p->m_next = first;               // according to the
-        first = first->m_prev = p;       // direction of the
+        p->list_next () = first;         // according to the
+        first = first->list_prev () = p; // direction of the
       }                                  // iterator that
       else                               // specified the
       {                                  // destination point
-        p->m_prev = last;
-        last = last->m_next = p;
+        p->list_prev () = last;
+        last = last->list_next () = p;
       }
-                         // Advance. Note that ++from is
-      p = from.ptr;      // performed prior to extraction
+
+      p = q;           // Advance
     }
 
+    from.ptr = p;
+
     if (delayed_rebuild)         // The tree is broken now, so
     {                            // rebuild it, or indicate
       *delayed_rebuild = true;   // delayed rebuild and adjust
       node_t::m_count -= n;      // the size for it
     }
     else
-      build_known_size_tree (size()-n, node_t::m_next);
+      build_known_size_tree (size()-n, node_t::list_next ());
   }
 
-  first->m_prev = NULL;    // Isolate the extracted nodes
-  last->m_next = NULL;     // list (mark both ends)
+  first->list_prev () = NULL;  // Isolate the extracted nodes
+  last->list_next () = NULL;   // list (mark both ends)
 
   return dst_extracted;
 }
@@ -419,13 +615,13 @@ template <class IT>
     // (where N is the number of elements in the array and n is
     // the number of elements to erase)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template <class IT>
 //not inline
   IT
-  avl_array<T,A,W,P>::erase_it
+  avl_array<T,A,W,P,S>::erase_it
   (IT from,                                  // Where to start
-   typename avl_array<T,A,W,P>::size_type n) // # to erase
+   typename avl_array<T,A,W,P,S>::size_type n) // # to erase
 {
 #ifdef BOOST_CLASS_REQUIRE
   function_requires< InputIteratorConcept<IT> >();
@@ -442,7 +638,7 @@ template <class IT>
   while (n)
   {                         // Destruct removed nodes
     p = first;
-    first = first->m_next;
+    first = first->list_next ();
     delete_node (p);
     n --;
   }
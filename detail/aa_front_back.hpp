@@ -20,6 +20,13 @@
   back()_const_: idem but const_reference (O(1))
   push_back(): append after last element (O(log N))
   pop_back(): remove last element (O(log N))
+
+  With C++11, T objects can be moved in, or built in place:
+
+  push_front(&&t): move before first element (O(log N))
+  push_back(&&t): move after last element (O(log N))
+  emplace_front(args...): construct before first (O(log N))
+  emplace_back(args...): construct after last (O(log N))
 */
 
 #ifndef _AVL_ARRAY_FRONT_BACK_HPP_
@@ -40,10 +47,10 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reference
-  avl_array<T,A,W,P>::front ()
+  typename avl_array<T,A,W,P,S>::reference
+  avl_array<T,A,W,P,S>::front ()
 {
   return *begin();
 }
@@ -53,10 +60,10 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::const_reference
-  avl_array<T,A,W,P>::front ()                   const
+  typename avl_array<T,A,W,P,S>::const_reference
+  avl_array<T,A,W,P,S>::front ()                   const
 {
   return *begin();
 }
@@ -65,11 +72,11 @@ inline
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::push_front
-  (typename avl_array<T,A,W,P>::const_reference t)
+  avl_array<T,A,W,P,S>::push_front
+  (typename avl_array<T,A,W,P,S>::const_reference t)
 {
   insert (begin(), t);
 }
@@ -79,10 +86,10 @@ inline
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::pop_front ()
+  avl_array<T,A,W,P,S>::pop_front ()
 {
   erase (begin());
 }
@@ -91,10 +98,10 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reference
-  avl_array<T,A,W,P>::back ()
+  typename avl_array<T,A,W,P,S>::reference
+  avl_array<T,A,W,P,S>::back ()
 {
   return *--end();
 }
@@ -104,10 +111,10 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::const_reference
-  avl_array<T,A,W,P>::back ()                    const
+  typename avl_array<T,A,W,P,S>::const_reference
+  avl_array<T,A,W,P,S>::back ()                    const
 {
   return *--end();
 }
@@ -116,11 +123,11 @@ inline
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::push_back
-  (typename avl_array<T,A,W,P>::const_reference t)
+  avl_array<T,A,W,P,S>::push_back
+  (typename avl_array<T,A,W,P,S>::const_reference t)
 {
   insert (end(), t);
 }
@@ -130,13 +137,66 @@ inline
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  void avl_array<T,A,W,P>::pop_back ()
+  void avl_array<T,A,W,P,S>::pop_back ()
 {
   erase (--end());
 }
 
+#if __cplusplus >= 201103L
+
+// push_front() _move_, push_back() _move_: insert an element
+// at the beginning/end, moving t into it
+//
+// Complexity: O(log(N))
+
+template<class T,class A,class W,class P,class S>
+inline
+  void
+  avl_array<T,A,W,P,S>::push_front
+  (typename avl_array<T,A,W,P,S>::value_type && t)
+{
+  insert (begin(), std::move (t));
+}
+
+template<class T,class A,class W,class P,class S>
+inline
+  void
+  avl_array<T,A,W,P,S>::push_back
+  (typename avl_array<T,A,W,P,S>::value_type && t)
+{
+  insert (end(), std::move (t));
+}
+
+// emplace_front(), emplace_back(): insert an element at the
+// beginning/end, constructing it with the given arguments.
+// Return a reference to it
+//
+// Complexity: O(log(N))
+
+template<class T,class A,class W,class P,class S>
+template<class... ARGS>
+inline
+  typename avl_array<T,A,W,P,S>::reference
+  avl_array<T,A,W,P,S>::emplace_front
+  (ARGS &&... args)
+{
+  return *emplace (begin(), std::forward<ARGS>(args)...);
+}
+
+template<class T,class A,class W,class P,class S>
+template<class... ARGS>
+inline
+  typename avl_array<T,A,W,P,S>::reference
+  avl_array<T,A,W,P,S>::emplace_back
+  (ARGS &&... args)
+{
+  return *emplace (end(), std::forward<ARGS>(args)...);
+}
+
+#endif
+
 //////////////////////////////////////////////////////////////////
 
 }  // namespace mkr
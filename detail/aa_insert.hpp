@@ -22,8 +22,18 @@
   (*) "after" from a 'straight' point of view
   (**) "after and in reverse order" from a 'straight' POV
 
+  With C++11, T objects can be moved in, or built in place:
+
+  it insert(&&t): move-insert anywhere (O(log N))
+  it insert(it,&&t): move-insert before (O(log N))
+  rit insert(rit,&&t): move-insert before* (O(log N))
+  insert(it,mfrom,mto): sequence-move before (O(min{N, n log N}))
+  it emplace(it,args...): construct before (O(log N))
+
   Private helper methods:
 
+  insert_provided(): insert objects of a data provider before
+                     a given position (O(min{N, n log N}))
   insert_before(): insert a node in a given pos. (O(log N))
   insert_anywhere(): add a node to the tree (O(log N))
 */
@@ -58,11 +68,11 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::iterator     // Insert anywhere
-  avl_array<T,A,W,P>::insert
-  (typename avl_array<T,A,W,P>::const_reference t) // Original
+  typename avl_array<T,A,W,P,S>::iterator     // Insert anywhere
+  avl_array<T,A,W,P,S>::insert
+  (typename avl_array<T,A,W,P,S>::const_reference t) // Original
 {
   node_t * newnode;
 
@@ -77,12 +87,12 @@ inline
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::insert
-  (const typename avl_array<T,A,W,P>::iterator & it, // Where
-   typename avl_array<T,A,W,P>::const_reference t)   // Original
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::insert
+  (const typename avl_array<T,A,W,P,S>::iterator & it, // Where
+   typename avl_array<T,A,W,P,S>::const_reference t)   // Original
 {
   node_t * newnode;
 
@@ -99,18 +109,18 @@ inline
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reverse_iterator
-  avl_array<T,A,W,P>::insert
+  typename avl_array<T,A,W,P,S>::reverse_iterator
+  avl_array<T,A,W,P,S>::insert
   (const typename                                   // Where and
-     avl_array<T,A,W,P>::reverse_iterator & it,     // how (REV.)
-   typename avl_array<T,A,W,P>::const_reference t)  // Original
+     avl_array<T,A,W,P,S>::reverse_iterator & it,     // how (REV.)
+   typename avl_array<T,A,W,P,S>::const_reference t)  // Original
 {
   node_t * newnode;
 
   newnode = new_node (&t);
-  insert_before (newnode, it.ptr->m_next);
+  insert_before (newnode, next (it.ptr));
   return reverse_iterator(newnode);
 }
 
@@ -120,13 +130,13 @@ inline
 //
 // Complexity: O(min{N, n log N})
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::insert
-  (const typename avl_array<T,A,W,P>::iterator it,  // Where
-   typename avl_array<T,A,W,P>::size_type n,        // How many
-   typename avl_array<T,A,W,P>::const_reference t)  // Original
+  avl_array<T,A,W,P,S>::insert
+  (const typename avl_array<T,A,W,P,S>::iterator it,  // Where
+   typename avl_array<T,A,W,P,S>::size_type n,        // How many
+   typename avl_array<T,A,W,P,S>::const_reference t)  // Original
 {
   node_t * p, * next, * first, * last;
   copy_data_provider<const_pointer> dp(&t);
@@ -144,54 +154,55 @@ template<class T,class A,class W,class P>
     do
     {                                 // Repeat n times:
       next = first;                   // Insert before it
-      first = first->m_next;          // (after previously
+      first = first->list_next ();    // (after previously
       insert_before (next, p);        // inserted copies)
     }
     while (first);
   }
   else            // If there are 'many' elements to insert
   {
-    last->m_next = p;
-    p->m_prev->m_next = first;
+    flatten ();
+    last->list_next () = p;
+    p->list_prev ()->list_next () = first;
 
-    build_known_size_tree (n+size(), node_t::m_next);
+    build_known_size_tree (n+size(), node_t::list_next ());
   }
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::insert
-  (const typename avl_array<T,A,W,P>::iterator & it, // Where
+  avl_array<T,A,W,P,S>::insert
+  (const typename avl_array<T,A,W,P,S>::iterator & it, // Where
    int n,                                            // How many
-   typename avl_array<T,A,W,P>::const_reference t)   // Original
+   typename avl_array<T,A,W,P,S>::const_reference t)   // Original
 {
   AA_ASSERT (n>=0);  // Can't insert a negative amount
 
   insert (it, size_type(n>0?n:0), t);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::insert
-  (const typename avl_array<T,A,W,P>::iterator & it, // Where
+  avl_array<T,A,W,P,S>::insert
+  (const typename avl_array<T,A,W,P,S>::iterator & it, // Where
    long n,                                           // How many
-   typename avl_array<T,A,W,P>::const_reference t)   // Original
+   typename avl_array<T,A,W,P,S>::const_reference t)   // Original
 {
   AA_ASSERT (n>=0);  // Can't insert a negative amount
 
   insert (it, size_type(n>0?n:0), t);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::insert
+  avl_array<T,A,W,P,S>::insert
   (const typename                                   // Where and
-     avl_array<T,A,W,P>::reverse_iterator it,       // how (REV.)
-   typename avl_array<T,A,W,P>::size_type n,        // How many
-   typename avl_array<T,A,W,P>::const_reference t)  // Original
+     avl_array<T,A,W,P,S>::reverse_iterator it,       // how (REV.)
+   typename avl_array<T,A,W,P,S>::size_type n,        // How many
+   typename avl_array<T,A,W,P,S>::const_reference t)  // Original
 {
   node_t * first, * last, * p;
   copy_data_provider<const_pointer> dp(&t);
@@ -207,44 +218,44 @@ template<class T,class A,class W,class P>
     do                         // Insert them one by one after
     {                          // it (every node goes before
       p = first;               // the previously inserted one)
-      first = first->m_next;
-      insert_before (p, it.ptr->m_next);
+      first = first->list_next ();
+      insert_before (p, next (it.ptr));
     }
     while (first);
   }
   else            // If there are 'many' elements to insert
   {
-                                     // Insert them only in the
-    last->m_next = it.ptr->m_next;   // circular doubly linked
-    it.ptr->m_next = first;          // list, and then
-                                     // rebuild the tree
+    flatten ();                      // Insert them only in the
+    last->list_next () =             // circular doubly linked
+          it.ptr->list_next ();      // list, and then
+    it.ptr->list_next () = first;    // rebuild the tree
 
-    build_known_size_tree (n+size(), node_t::m_next);
+    build_known_size_tree (n+size(), node_t::list_next ());
   }
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::insert
+  avl_array<T,A,W,P,S>::insert
   (const typename                                   // Where and
-     avl_array<T,A,W,P>::reverse_iterator & it,     // how (REV.)
+     avl_array<T,A,W,P,S>::reverse_iterator & it,     // how (REV.)
    int n,                                           // How many
-   typename avl_array<T,A,W,P>::const_reference t)  // Original
+   typename avl_array<T,A,W,P,S>::const_reference t)  // Original
 {
   AA_ASSERT (n>=0);  // Can't insert a negative amount
 
   insert (it, size_type(n>0?n:0), t);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::insert
+  avl_array<T,A,W,P,S>::insert
   (const typename                                   // Where and
-     avl_array<T,A,W,P>::reverse_iterator & it,     // how (REV.)
+     avl_array<T,A,W,P,S>::reverse_iterator & it,     // how (REV.)
    long n,                                          // How many
-   typename avl_array<T,A,W,P>::const_reference t)  // Original
+   typename avl_array<T,A,W,P,S>::const_reference t)  // Original
 {
   AA_ASSERT (n>=0);  // Can't insert a negative amount
 
@@ -256,12 +267,12 @@ inline
 //
 // Complexity: O(min{N, n log N})
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template <class IT>
 //not inline
   void
-  avl_array<T,A,W,P>::insert
-  (typename avl_array<T,A,W,P>::iterator it,    // Where
+  avl_array<T,A,W,P,S>::insert
+  (typename avl_array<T,A,W,P,S>::iterator it,    // Where
    IT from,
    IT to)                // Originals (*to not included)
 {
@@ -269,44 +280,20 @@ template <class IT>
   function_requires< InputIteratorConcept<IT> >();
 #endif
 
-  node_t * first, * last, * p;
   range_data_provider<const_pointer,IT> dp(from,to);
-  size_type n;
                                       // it must point
   AA_ASSERT_HO (owner(it.ptr)==this); // into this arr.
 
-  if (from==to)              // Make a list with copies of the
-    return;                  // range [from,to) and count them
-
-  n = construct_nodes_list (first, last, 0, dp, false, true);
-
-  if (!worth_rebuild(n,size()))   // 'few' elements to insert
-  {
-    do
-    {
-      p = first;                  // Insert them one by one
-      first = first->m_next;      // before it (every one
-      insert_before (p, it.ptr);  // goes after the previously
-    }                             // inserted)
-    while (first);
-  }
-  else            // If there are 'many' elements to insert
-  {
-                                     // Insert them only in the
-    last->m_next = it.ptr;           // circular doubly linked
-    it.ptr->m_prev->m_next = first;  // list, and then
-                                     // rebuild the tree
-
-    build_known_size_tree (n+size(), node_t::m_next);
-  }
+  if (from!=to)              // Insert copies of the range
+    insert_provided (it.ptr, dp);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template <class IT>
 //not inline
   void
-  avl_array<T,A,W,P>::insert
-  (typename avl_array<T,A,W,P>::reverse_iterator it, // Where
+  avl_array<T,A,W,P,S>::insert
+  (typename avl_array<T,A,W,P,S>::reverse_iterator it, // Where
    IT from,
    IT to)                     // Originals (*to not included)
 {
@@ -330,25 +317,177 @@ template <class IT>
     do                         // Insert them one by one after
     {                          // it (every node goes before
       p = first;               // the previously inserted one)
-      first = first->m_next;
-      insert_before (p, it.ptr->m_next);
+      first = first->list_next ();
+      insert_before (p, next (it.ptr));
     }
     while (first);
   }
   else            // If there are 'many' elements to insert
   {
-                                     // Insert them only in the
-    last->m_next = it.ptr->m_next;   // circular doubly linked
-    it.ptr->m_next = first;          // list, and then
-                                     // rebuild the tree
+    flatten ();                      // Insert them only in the
+    last->list_next () =             // circular doubly linked
+          it.ptr->list_next ();      // list, and then
+    it.ptr->list_next () = first;    // rebuild the tree
 
-    build_known_size_tree (n+size(), node_t::m_next);
+    build_known_size_tree (n+size(), node_t::list_next ());
   }
 }
 
+#if __cplusplus >= 201103L
+
+// Insert anywhere _move_: like insert anywhere (see above),
+// but the new element is move constructed from t
+//
+// Complexity: O(log(N))
+
+template<class T,class A,class W,class P,class S>
+inline
+  typename avl_array<T,A,W,P,S>::iterator     // Insert anywhere
+  avl_array<T,A,W,P,S>::insert
+  (typename avl_array<T,A,W,P,S>::value_type && t) // Original
+{
+  node_t * newnode;
+
+  newnode = emplace_node (std::move (t));
+  insert_anywhere (newnode);
+  return iterator(newnode);
+}
+
+// Insert Before _move_: insert a new T move constructed
+// element before a given position. Return iterator pointing
+// to the new element
+//
+// Complexity: O(log(N))
+
+template<class T,class A,class W,class P,class S>
+inline
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::insert
+  (const typename avl_array<T,A,W,P,S>::iterator & it, // Where
+   typename avl_array<T,A,W,P,S>::value_type && t)     // Original
+{
+  node_t * newnode;
+
+  newnode = emplace_node (std::move (t));
+  insert_before (newnode, it.ptr);
+  return iterator(newnode);
+}
+
+// Insert Before _reverse_ _move_: see the two above
+//
+// Complexity: O(log(N))
+
+template<class T,class A,class W,class P,class S>
+inline
+  typename avl_array<T,A,W,P,S>::reverse_iterator
+  avl_array<T,A,W,P,S>::insert
+  (const typename                                   // Where and
+     avl_array<T,A,W,P,S>::reverse_iterator & it,     // how (REV.)
+   typename avl_array<T,A,W,P,S>::value_type && t)    // Original
+{
+  node_t * newnode;
+
+  newnode = emplace_node (std::move (t));
+  insert_before (newnode, next (it.ptr));
+  return reverse_iterator(newnode);
+}
+
+// Sequence insert _move_: move the objects of the sequence
+// [from,to) to new elements inserted before it (e.g. with
+// std::make_move_iterator(v.begin()), ...(v.end())). The
+// objects are left in the moved-from state of T
+//
+// Complexity: O(min{N, n log N})
+
+template<class T,class A,class W,class P,class S>
+template <class IT>
+//not inline
+  void
+  avl_array<T,A,W,P,S>::insert
+  (typename avl_array<T,A,W,P,S>::iterator it,    // Where
+   std::move_iterator<IT> from,
+   std::move_iterator<IT> to)   // Originals (*to not included)
+{
+  move_data_provider<const_pointer,IT> dp(from.base(),to.base());
+                                      // it must point
+  AA_ASSERT_HO (owner(it.ptr)==this); // into this arr.
+
+  if (from!=to)              // Insert the range, moving
+    insert_provided (it.ptr, dp);
+}
+
+// Emplace: insert a new element before a given position,
+// constructing its T object in place with the given
+// arguments. Return iterator pointing to the new element
+//
+// Complexity: O(log(N))
+
+template<class T,class A,class W,class P,class S>
+template <class... ARGS>
+inline
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::emplace
+  (const typename avl_array<T,A,W,P,S>::iterator & it, // Where
+   ARGS &&... args)                        // T ctor. arguments
+{
+  node_t * newnode;
+
+  newnode = emplace_node (std::forward<ARGS>(args)...);
+  insert_before (newnode, it.ptr);
+  return iterator(newnode);
+}
+
+#endif
+
 
 // ------------------- PRIVATE HELPER METHODS --------------------
 
+// insert_provided(): insert new elements, made with the
+// objects given by a data provider until it returns NULL
+// (see construct_nodes_list()), before the node p. If they
+// are 'few', insert them one by one; otherwise, put them in
+// the list and rebuild the tree
+//
+// Complexity: O(min{N, n log N})
+
+template<class T,class A,class W,class P,class S>
+template <class DP>
+//not inline
+  void
+  avl_array<T,A,W,P,S>::insert_provided
+  (typename avl_array<T,A,W,P,S>::node_t * p,   // Where
+   DP & dp)                                     // Originals
+{
+  node_t * first, * last, * q;
+  size_type n;
+                             // Make a list with the new
+                             // elements and count them
+  n = construct_nodes_list (first, last, 0, dp, false, true);
+
+  if (!n)
+    return;
+
+  if (!worth_rebuild(n,size()))   // 'few' elements to insert
+  {
+    do
+    {
+      q = first;                  // Insert them one by one
+      first = first->list_next ();// before p (every one
+      insert_before (q, p);       // goes after the previously
+    }                             // inserted)
+    while (first);
+  }
+  else            // If there are 'many' elements to insert
+  {
+    flatten ();                      // Insert them only in the
+    last->list_next () = p;          // circular doubly linked
+    p->list_prev ()->                // list, and then
+               list_next () = first; // rebuild the tree
+
+    build_known_size_tree (n+size(), node_t::list_next ());
+  }
+}
+
 // insert_before(): insert a given node in a given position
 // of the tree. The node is inserted as a leaf node and
 // then, if necessary, the tree is rebalanced. Anyway, a
@@ -360,12 +499,12 @@ template <class IT>
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::insert_before
-  (typename avl_array<T,A,W,P>::node_t * newnode,
-   typename avl_array<T,A,W,P>::node_t * p)
+  avl_array<T,A,W,P,S>::insert_before
+  (typename avl_array<T,A,W,P,S>::node_t * newnode,
+   typename avl_array<T,A,W,P,S>::node_t * p)
 {
   node_t * parent;       // Future parent of the new node
   int side;              // Side (of the parent) where the
@@ -374,9 +513,11 @@ template<class T,class A,class W,class P>
   AA_ASSERT (p);         // NULL pointer dereference
   AA_ASSERT (newnode);   // Can't insert NULL
 
+  make_leaf (newnode);   // (It might come from a list)
+
   if (p->m_children[L])  // If p has a left subtree, then the
   {                      // previous node (the rightmost node
-    parent = p->m_prev;  // in this left subtree) has no right
+    parent = prev (p);   // in this left subtree) has no right
     side = R;            // child. Put the new node there, as
   }                      // the right child of the previous
   else                   // node
@@ -385,11 +526,10 @@ template<class T,class A,class W,class P>
     side = L;            // be easier! Put the new node there
   }
 
-  newnode->m_prev = p->m_prev;
-  newnode->m_prev->m_next = newnode;  // Insert the new node in
-                                      // the circular doubly
-  newnode->m_next = p;                // linked list
-  p->m_prev = newnode;
+  threads_t::link (threads_t::prev (p),  // Insert the new node
+                   newnode);             // in the circular
+  threads_t::link (newnode, p);          // doubly linked list
+                                         // (if any)
                                       // Link the new node and
   parent->m_children[side] = newnode; // its new parent with
   newnode->m_parent = parent;         // each other
@@ -413,16 +553,18 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(log N)  (no rotations!)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::insert_anywhere
-  (typename avl_array<T,A,W,P>::node_t * newnode)
+  avl_array<T,A,W,P,S>::insert_anywhere
+  (typename avl_array<T,A,W,P,S>::node_t * newnode)
 {
   node_t * p;   // Future parent of the new node
 
   AA_ASSERT (newnode);     // Can't insert NULL
 
+  make_leaf (newnode);     // (It might come from a list)
+
   if (!node_t::m_children[L])   // If the tree is empty, use the
     p = dummy ();               // dummy node as parent
   else                          // Otherwise, go down through the
@@ -437,21 +579,19 @@ template<class T,class A,class W,class P>
                                    // Insert in the empty side
   if (!p->m_children[L])           // (try left first, just in
   {                                // case of p==dummy)
-    newnode->m_prev = p->m_prev;
-    newnode->m_next = p;                // Insert the new node
-                                        // _before_ p in the
-    newnode->m_prev->m_next = newnode;  // circular doubly
-    p->m_prev = newnode;                // linked list
+    threads_t::link (threads_t::prev (p), // Insert the new
+                     newnode);            // node _before_ p
+    threads_t::link (newnode, p);         // in the circular
+                                          // doubly linked list
 
     p->m_children[L] = newnode;         // Link the parent
   }
   else
   {
-    newnode->m_next = p->m_next;
-    newnode->m_prev = p;                // Insert the new node
-                                        // _after_ p in the
-    newnode->m_next->m_prev = newnode;  // circular doubly
-    p->m_next = newnode;                // linked list
+    threads_t::link (newnode,             // Insert the new
+                     threads_t::next (p));// node _after_ p
+    threads_t::link (p, newnode);         // in the circular
+                                          // doubly linked list
 
     p->m_children[R] = newnode;         // Link the parent
   }
@@ -461,6 +601,25 @@ template<class T,class A,class W,class P>
   update_counters (p);     // Travel to the root updating
 }                          // counts and heights
 
+// make_leaf(): reset the tree links and counters of a node
+// that is going to be inserted as a leaf. Nodes taken from
+// temporary lists might have stale values there (without
+// threads, the list links are the children pointers). The
+// node's own width is kept
+//
+// Complexity: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline //static
+  void
+  avl_array<T,A,W,P,S>::make_leaf
+  (typename avl_array<T,A,W,P,S>::node_t * p)
+{
+  p->m_children[L] = p->m_children[R] = NULL;
+  p->m_count = p->m_height = 1;
+  p->m_total_width = p->m_node_width;
+}
+
 //////////////////////////////////////////////////////////////////
 
 }  // namespace mkr
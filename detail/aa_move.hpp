@@ -30,11 +30,11 @@
   move_node(): extract and insert in other pos. (O(log N))
   move_nodes(): move n nodes to another pos. *
 
-  (*) Complexity of group moves:
-      If the source and destination containers are the same, then
-      the complexity is O(min{N, n log N})
-      Otherwise, it is O(min{N, n log N} + min{M, n log M}), where
-      M and N are the containers' sizes
+  (*) Complexity of group moves: O(log(M)+log(N)), where M and
+      N are the containers' sizes (the range is cut out, and
+      joined again at the destination, see split_join.hpp). If
+      the direction of the destination iterator inverts the
+      order of the group, add O(n)
 */
 
 #ifndef _AVL_ARRAY_MOVE_HPP_
@@ -55,46 +55,47 @@ namespace mkr  // Public namespace
 // they interchange their positions in the tree(s), but
 // don't move them in memory and don't touch their T
 // objects. The nodes can be from the same tree, or from
-// a different tree each one
+// a different tree each one. Every node keeps its NPSV
+// width
 //
-// Complexity: O(1)
+// Complexity: O(1), or O(log N) with NPSV
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::swap
-  (typename avl_array<T,A,W,P>::iterator it1,
-   typename avl_array<T,A,W,P>::iterator it2)
+  avl_array<T,A,W,P,S>::swap
+  (typename avl_array<T,A,W,P,S>::iterator it1,
+   typename avl_array<T,A,W,P,S>::iterator it2)
 {
   swap_nodes (it1.ptr, it2.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::swap
-  (typename avl_array<T,A,W,P>::iterator it1,
-   typename avl_array<T,A,W,P>::reverse_iterator it2)
+  avl_array<T,A,W,P,S>::swap
+  (typename avl_array<T,A,W,P,S>::iterator it1,
+   typename avl_array<T,A,W,P,S>::reverse_iterator it2)
 {
   swap_nodes (it1.ptr, it2.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::swap
-  (typename avl_array<T,A,W,P>::reverse_iterator it1,
-   typename avl_array<T,A,W,P>::iterator it2)
+  avl_array<T,A,W,P,S>::swap
+  (typename avl_array<T,A,W,P,S>::reverse_iterator it1,
+   typename avl_array<T,A,W,P,S>::iterator it2)
 {
   swap_nodes (it1.ptr, it2.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::swap
-  (typename avl_array<T,A,W,P>::reverse_iterator it1,
-   typename avl_array<T,A,W,P>::reverse_iterator it2)
+  avl_array<T,A,W,P,S>::swap
+  (typename avl_array<T,A,W,P,S>::reverse_iterator it1,
+   typename avl_array<T,A,W,P,S>::reverse_iterator it2)
 {
   swap_nodes (it1.ptr, it2.ptr);
 }
@@ -105,30 +106,28 @@ inline
 // T object. Two versions of this method are provided. One
 // receives a normal iterator. The other one receives a
 // reverse iterator, which inverts the sign of the move.
-// IF |n|==1 AND [ NPSV is not used, OR
-//                 both NPSV widths are the same, OR
-//                 m_sums_out_of_date==true ]
+// IF |n|==1 AND NPSV is not used
 // THEN the oparetion takes just O(1) time
 // ELSE it takes O(log n)
 //
 // Complexity: O(log(N)), or O(1) in special cases
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::iterator it,
-   typename avl_array<T,A,W,P>::difference_type n)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::iterator it,
+   typename avl_array<T,A,W,P,S>::difference_type n)
 {
   move_node (it.ptr, n);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::reverse_iterator it,
-   typename avl_array<T,A,W,P>::difference_type n)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::reverse_iterator it,
+   typename avl_array<T,A,W,P,S>::difference_type n)
 {
   move_node (it.ptr, -n);     // Reverse ---> -n
 }
@@ -141,44 +140,44 @@ inline
 // (where M and N are the numbers of elements in source
 // and destination arrays respectively)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::iterator src,
-   typename avl_array<T,A,W,P>::iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::iterator src,
+   typename avl_array<T,A,W,P,S>::iterator dst)
 {
   move_node (src.ptr, dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::iterator src,
-   typename avl_array<T,A,W,P>::reverse_iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::iterator src,
+   typename avl_array<T,A,W,P,S>::reverse_iterator dst)
 {
-  move_node (src.ptr, dst.ptr->m_next);
+  move_node (src.ptr, next (dst.ptr));
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::reverse_iterator src,
-   typename avl_array<T,A,W,P>::iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::reverse_iterator src,
+   typename avl_array<T,A,W,P,S>::iterator dst)
 {
   move_node (src.ptr, dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::reverse_iterator src,
-   typename avl_array<T,A,W,P>::reverse_iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::reverse_iterator src,
+   typename avl_array<T,A,W,P,S>::reverse_iterator dst)
 {
-  move_node (src.ptr, dst.ptr->m_next);
+  move_node (src.ptr, next (dst.ptr));
 }
 
 // Group move: extract n nodes starting with src_from, and
@@ -186,48 +185,48 @@ inline
 //
 // Complexity: see note at the beginnig of this file
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::iterator src_from,
-   typename avl_array<T,A,W,P>::size_type n,
-   typename avl_array<T,A,W,P>::iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::iterator src_from,
+   typename avl_array<T,A,W,P,S>::size_type n,
+   typename avl_array<T,A,W,P,S>::iterator dst)
 {
   move_nodes (src_from, n, dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::reverse_iterator src_from,
-   typename avl_array<T,A,W,P>::size_type n,
-   typename avl_array<T,A,W,P>::iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::reverse_iterator src_from,
+   typename avl_array<T,A,W,P,S>::size_type n,
+   typename avl_array<T,A,W,P,S>::iterator dst)
 {
   move_nodes (src_from, n, dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::iterator src_from,
-   typename avl_array<T,A,W,P>::size_type n,
-   typename avl_array<T,A,W,P>::reverse_iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::iterator src_from,
+   typename avl_array<T,A,W,P,S>::size_type n,
+   typename avl_array<T,A,W,P,S>::reverse_iterator dst)
 {
-  move_nodes (src_from, n, dst.ptr->m_next, true);
+  move_nodes (src_from, n, next (dst.ptr), true);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::reverse_iterator src_from,
-   typename avl_array<T,A,W,P>::size_type n,
-   typename avl_array<T,A,W,P>::reverse_iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::reverse_iterator src_from,
+   typename avl_array<T,A,W,P,S>::size_type n,
+   typename avl_array<T,A,W,P,S>::reverse_iterator dst)
 {
-  move_nodes (src_from, n, dst.ptr->m_next, true);
+  move_nodes (src_from, n, next (dst.ptr), true);
 }
 
 // Range move: extract nodes [src_from, src_to) and
@@ -235,13 +234,13 @@ inline
 //
 // Complexity: see note at the beginnig of this file
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::iterator src_from,
-   typename avl_array<T,A,W,P>::iterator src_to,
-   typename avl_array<T,A,W,P>::iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::iterator src_from,
+   typename avl_array<T,A,W,P,S>::iterator src_to,
+   typename avl_array<T,A,W,P,S>::iterator dst)
 {
   difference_type n;
   AA_ASSERT_HO (owner(src_from.ptr)==owner(src_to.ptr));
@@ -249,13 +248,13 @@ inline
   if (n>0) move_nodes (src_from, size_type(n), dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::reverse_iterator src_from,
-   typename avl_array<T,A,W,P>::reverse_iterator src_to,
-   typename avl_array<T,A,W,P>::iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::reverse_iterator src_from,
+   typename avl_array<T,A,W,P,S>::reverse_iterator src_to,
+   typename avl_array<T,A,W,P,S>::iterator dst)
 {
   difference_type n;
   AA_ASSERT_HO (owner(src_from.ptr)==owner(src_to.ptr));
@@ -263,34 +262,34 @@ inline
   if (n>0) move_nodes (src_from, size_type(n), dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::iterator src_from,
-   typename avl_array<T,A,W,P>::iterator src_to,
-   typename avl_array<T,A,W,P>::reverse_iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::iterator src_from,
+   typename avl_array<T,A,W,P,S>::iterator src_to,
+   typename avl_array<T,A,W,P,S>::reverse_iterator dst)
 {
   difference_type n;
   AA_ASSERT_HO (owner(src_from.ptr)==owner(src_to.ptr));
   n = src_to - src_from;
   if (n>0) move_nodes (src_from, size_type(n),
-                       dst.ptr->m_next, true);
+                       next (dst.ptr), true);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move
-  (typename avl_array<T,A,W,P>::reverse_iterator src_from,
-   typename avl_array<T,A,W,P>::reverse_iterator src_to,
-   typename avl_array<T,A,W,P>::reverse_iterator dst)
+  avl_array<T,A,W,P,S>::move
+  (typename avl_array<T,A,W,P,S>::reverse_iterator src_from,
+   typename avl_array<T,A,W,P,S>::reverse_iterator src_to,
+   typename avl_array<T,A,W,P,S>::reverse_iterator dst)
 {
   difference_type n;
   AA_ASSERT_HO (owner(src_from.ptr)==owner(src_to.ptr));
   n = src_to - src_from;
   if (n>0) move_nodes (src_from, size_type(n),
-                       dst.ptr->m_next, true);
+                       next (dst.ptr), true);
 }
 
 // splice (it/rit,cont): move all contents of another avl_array
@@ -298,12 +297,12 @@ inline
 //
 // Complexity: see note at the beginnig of this file
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src)
 {
   AA_ASSERT_HO (owner(dst.ptr)==this);
   AA_ASSERT (&src!=this);
@@ -312,18 +311,18 @@ inline
               dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::reverse_iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::reverse_iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src)
 {
   AA_ASSERT_HO (owner(dst.ptr)==this);
   AA_ASSERT (&src!=this);
 
   move_nodes (src.begin(), src.size(),
-              dst.ptr->m_next, true);    // Reverse
+              next (dst.ptr), true);    // Reverse
 }
 
 // splice (it/rit,cont,it/rit): move an elemnt of another
@@ -334,13 +333,13 @@ inline
 // (where M and N are the numbers of elements in source
 // and destination arrays respectively)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src,
-   typename avl_array<T,A,W,P>::iterator src_from)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src,
+   typename avl_array<T,A,W,P,S>::iterator src_from)
 {
   AA_ASSERT_HO (owner(dst.ptr)==this);
   AA_ASSERT_HO (owner(src_from.ptr)==&src);
@@ -348,27 +347,27 @@ inline
   move_node (src_from.ptr, dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::reverse_iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src,
-   typename avl_array<T,A,W,P>::iterator src_from)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::reverse_iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src,
+   typename avl_array<T,A,W,P,S>::iterator src_from)
 {
   AA_ASSERT_HO (owner(dst.ptr)==this);
   AA_ASSERT_HO (owner(src_from.ptr)==&src);
 
-  move_node (src_from.ptr, dst.ptr->m_next);
+  move_node (src_from.ptr, next (dst.ptr));
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src,
-   typename avl_array<T,A,W,P>::reverse_iterator src_from)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src,
+   typename avl_array<T,A,W,P,S>::reverse_iterator src_from)
 {
   AA_ASSERT_HO (owner(dst.ptr)==this);
   AA_ASSERT_HO (owner(src_from.ptr)==&src);
@@ -376,18 +375,18 @@ inline
   move_node (src_from.ptr, dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::reverse_iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src,
-   typename avl_array<T,A,W,P>::reverse_iterator src_from)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::reverse_iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src,
+   typename avl_array<T,A,W,P,S>::reverse_iterator src_from)
 {
   AA_ASSERT_HO (owner(dst.ptr)==this);
   AA_ASSERT_HO (owner(src_from.ptr)==&src);
 
-  move_node (src_from.ptr, dst.ptr->m_next);
+  move_node (src_from.ptr, next (dst.ptr));
 }
 
 // splice (it/rit,cont): move a range [from,to) of another
@@ -395,14 +394,14 @@ inline
 //
 // Complexity: see note at the beginnig of this file
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src,
-   typename avl_array<T,A,W,P>::iterator src_from,
-   typename avl_array<T,A,W,P>::iterator src_to)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src,
+   typename avl_array<T,A,W,P,S>::iterator src_from,
+   typename avl_array<T,A,W,P,S>::iterator src_to)
 {
   difference_type n;
 
@@ -415,14 +414,14 @@ inline
   if (n>0) move_nodes (src_from, n, dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::reverse_iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src,
-   typename avl_array<T,A,W,P>::iterator src_from,
-   typename avl_array<T,A,W,P>::iterator src_to)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::reverse_iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src,
+   typename avl_array<T,A,W,P,S>::iterator src_from,
+   typename avl_array<T,A,W,P,S>::iterator src_to)
 {
   difference_type n;
 
@@ -433,17 +432,17 @@ inline
   n = src_to - src_from;
 
   if (n>0) move_nodes (src_from, n,
-                       dst.ptr->m_next, true);  // Reverse
+                       next (dst.ptr), true);  // Reverse
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src,
-   typename avl_array<T,A,W,P>::reverse_iterator src_from,
-   typename avl_array<T,A,W,P>::reverse_iterator src_to)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src,
+   typename avl_array<T,A,W,P,S>::reverse_iterator src_from,
+   typename avl_array<T,A,W,P,S>::reverse_iterator src_to)
 {
   difference_type n;
 
@@ -456,14 +455,14 @@ inline
   if (n>0) move_nodes (src_from, n, dst.ptr);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::splice
-  (typename avl_array<T,A,W,P>::reverse_iterator dst,
-   typename avl_array<T,A,W,P>::my_class & src,
-   typename avl_array<T,A,W,P>::reverse_iterator src_from,
-   typename avl_array<T,A,W,P>::reverse_iterator src_to)
+  avl_array<T,A,W,P,S>::splice
+  (typename avl_array<T,A,W,P,S>::reverse_iterator dst,
+   typename avl_array<T,A,W,P,S>::my_class & src,
+   typename avl_array<T,A,W,P,S>::reverse_iterator src_from,
+   typename avl_array<T,A,W,P,S>::reverse_iterator src_to)
 {
   difference_type n;
 
@@ -474,7 +473,7 @@ inline
   n = src_to - src_from;
 
   if (n>0) move_nodes (src_from, n,
-                       dst.ptr->m_next, true);  // Reverse
+                       next (dst.ptr), true);  // Reverse
 }
 
 // reverse(): invert the sequence of the array without
@@ -483,31 +482,39 @@ inline
 //
 // Complexity: O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
-  void avl_array<T,A,W,P>::reverse ()
+  void avl_array<T,A,W,P,S>::reverse ()
 {
   node_t * p, * next, * tmp;
 
-  next = node_t::m_next;
+  if (!S::threaded)         // Without threads, just swap the
+  {                         // children links of every node
+    mirror_tree (node_t::m_children[L]);
+    return;
+  }
+
+  next = threads_t::next (dummy ());
 
   while (next!=dummy())   // For every node (excepting the
   {                       // dummy node)
     p = next;
-    next = p->m_next;
+    next = threads_t::next (p);
 
-    p->m_next = p->m_prev;    // Swap prev and next links
-    p->m_prev = next;         // (circular doubly linked list)
+    threads_t::next (p) =     // Swap prev and next links
+        threads_t::prev (p);  // (circular doubly linked list)
+    threads_t::prev (p) = next;
 
     tmp = p->m_children[L];              // Swap left and right
     p->m_children[L] = p->m_children[R]; // children links
     p->m_children[R] = tmp;              // (tree)
   }
 
-  tmp = node_t::m_next;             // For the dummy node, swap
-  node_t::m_next = node_t::m_prev;  // prev (last) and next (first)
-  node_t::m_prev = tmp;             // links, but don't touch
-}                                   // children links
+  tmp = threads_t::next (dummy ());    // For the dummy node, swap
+  threads_t::next (dummy ()) =         // prev (last) and next
+      threads_t::prev (dummy ());      // (first) links, but don't
+  threads_t::prev (dummy ()) = tmp;    // touch children links
+}
 
 
 // ------------------- PRIVATE HELPER METHODS --------------------
@@ -520,23 +527,25 @@ template<class T,class A,class W,class P>
 // The dificulty here is that a lot of corner cases have
 // to be taken into account when the nodes are directly
 // related (previous-next or parent-child)
-// If NPSV is not used, or both nodes have the same NPSV
-// width, or the NPSV dirty bit (m_sums_out_of_date) is
-// set, then the operation is O(1) (constant time).
-// Otherwise, the width sums must be updated, taking
-// O(log N) time.
+// If NPSV is not used, then the operation is O(1)
+// (constant time). Otherwise, the width sums of both
+// paths to the root must be updated, taking O(log N)
+// time: the NPSV width of every node goes with it, and
+// even with equal widths, the paths might have lazy
+// changes pending (see npsv_set_width()) that must stay
+// under the nodes in m_dirty. If the nodes are in
+// different trees, their dirty lists are forgotten
 //
-// Complexity: O(1) without NPSV or with NPSV but eq. widths
-//             O(log N) with NPSV and different widths
+// Complexity: O(1) without NPSV, O(log N) with NPSV
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::swap_nodes
-  (typename avl_array<T,A,W,P>::node_t * p,
-   typename avl_array<T,A,W,P>::node_t * q)
+  avl_array<T,A,W,P,S>::swap_nodes
+  (typename avl_array<T,A,W,P,S>::node_t * p,
+   typename avl_array<T,A,W,P,S>::node_t * q)
 {
-  node_t * tmp, tmpnode;
+  node_t * tmp, tmpnode, * dp, * dq;
 
   AA_ASSERT (p);            // NULL pointer dereference
   AA_ASSERT (q);            // NULL pointer dereference
@@ -548,37 +557,44 @@ template<class T,class A,class W,class P>
   if (p==q)   // Self swap is nosense
     return;
 
-  // 1st: doubly linked list swap
+  // 1st: doubly linked list swap (if any)
 
-  if (q->m_next==p)   // If they are contiguous, force
-  {                   // them to be in a concrete order
-    tmp = p;          // (swap the parameters p and q
-    p = q;            // if necessary). This helps
-    q = tmp;          // simplifying what comes next
-  }
-                          // With the previous trick,
-  p->m_prev->m_next = q;  // this applies for every case:
-  q->m_next->m_prev = p;  // fix outer side links to p and q
-
-  if (p->m_next==q)       // If they are contiguous,
-  {
-    q->m_prev = p->m_prev;   // Fix side links from p and q
-    p->m_next = q->m_next;
-    p->m_prev = q;           // Link p and q with each other
-    q->m_next = p;
-  }
-  else                    // Otherwise,
+  if (S::threaded)
   {
-    p->m_next->m_prev = q;   // Inner side links to p and q
-    q->m_prev->m_next = p;   // are just like outer links...
-
-    tmp = p->m_next;
-    p->m_next = q->m_next;   // Swap next links from p and q
-    q->m_next = tmp;
-
-    tmp = p->m_prev;
-    p->m_prev = q->m_prev;   // Swap prev links from p and q
-    q->m_prev = tmp;
+    if (threads_t::next (q)==p) // If they are contiguous, force
+    {                   // them to be in a concrete order
+      tmp = p;          // (swap the parameters p and q
+      p = q;            // if necessary). This helps
+      q = tmp;          // simplifying what comes next
+    }
+                                  // With the previous trick,
+    threads_t::next (threads_t::prev (p)) = q; // this applies
+    threads_t::prev (threads_t::next (q)) = p; // for every case:
+                                  // fix outer side links to p
+                                  // and q
+    if (threads_t::next (p)==q)   // If they are contiguous,
+    {
+      threads_t::prev (q) =          // Fix side links from p
+                 threads_t::prev (p);// and q
+      threads_t::next (p) =
+                 threads_t::next (q);
+      threads_t::link (q, p);        // Link p and q with each
+    }                                // other
+    else                    // Otherwise,
+    {
+      threads_t::prev (threads_t::next (p)) = q; // Inner side
+      threads_t::next (threads_t::prev (q)) = p; // links to p
+                                    // and q are just like outer
+      tmp = threads_t::next (p);    // links...
+      threads_t::next (p) =
+                 threads_t::next (q);// Swap next links from p
+      threads_t::next (q) = tmp;     // and q
+
+      tmp = threads_t::prev (p);
+      threads_t::prev (p) =
+                 threads_t::prev (q);// Swap prev links from p
+      threads_t::prev (q) = tmp;     // and q
+    }
   }
 
   // 2nd: binary tree swap
@@ -599,8 +615,6 @@ template<class T,class A,class W,class P>
   p->m_count = q->m_count;               // (excepting prev
   p->m_oldpos = q->m_oldpos;             // and next)
 
-  p->m_node_width = q->m_node_width;
-
   q->m_parent = tmpnode.m_parent;
   q->m_children[L] = tmpnode.m_children[L];
   q->m_children[R] = tmpnode.m_children[R];
@@ -608,8 +622,6 @@ template<class T,class A,class W,class P>
   q->m_count = tmpnode.m_count;           // (excepting prev
   q->m_oldpos = tmpnode.m_oldpos;         // and next)
 
-  q->m_node_width = tmpnode.m_node_width;
-
   if (p==p->m_parent)  // Very special case: parent-child
   {                    // (p its own parent?? That's because
     p->m_parent = q;   // of the previous pointers dance)
@@ -658,25 +670,29 @@ template<class T,class A,class W,class P>
   if (q->m_children[R])
     q->m_children[R]->m_parent = q;
 
-  if (p->m_node_width!=q->m_node_width)
+  if (npsv_used<W>::value)
   {
     do
     {
-      p->m_total_width = p->left_width () +
-                         p->right_width () +
-                         p->m_node_width;
+      p->m_total_width = p->subtree_width ();
+      dp = p;
       p = p->m_parent;
-    }                        // If necesary, update
+    }                        // With NPSV, update
     while (p);               // width sums from p
                              // to root, and from q
     do                       // to root
     {
-      q->m_total_width = q->left_width () +
-                         q->right_width () +
-                         q->m_node_width;
+      q->m_total_width = q->subtree_width ();
+      dq = q;
       q = q->m_parent;
     }
     while (q);
+
+    if (dp!=dq)                             // Different trees
+    {                                       // (dp and dq are
+      dummy_owner (dp)->m_dirty.clear ();   // their dummy
+      dummy_owner (dq)->m_dirty.clear ();   // nodes)
+    }
   }
 }
 
@@ -687,12 +703,12 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::move_node
-  (typename avl_array<T,A,W,P>::node_t * p,
-   typename avl_array<T,A,W,P>::difference_type n)
+  avl_array<T,A,W,P,S>::move_node
+  (typename avl_array<T,A,W,P,S>::node_t * p,
+   typename avl_array<T,A,W,P,S>::difference_type n)
 {
   int side;
   node_t * q, * r;
@@ -709,19 +725,19 @@ template<class T,class A,class W,class P>
 
   if (n==1)                      // Just one pos. right?
   {
-    AA_ASSERT_EXC (p->m_next->m_parent,
+    AA_ASSERT_EXC (next (p)->m_parent,
                    index_out_of_bounds());  // (don't swap end!)
 
-    swap_nodes (p, p->m_next);   // Swap with the next one
+    swap_nodes (p, next (p));    // Swap with the next one
     return;                      // Done
   }
 
   if (n==-1)                     // Just one pos. left?
   {
-    AA_ASSERT_EXC (p->m_prev->m_parent,
+    AA_ASSERT_EXC (prev (p)->m_parent,
                    index_out_of_bounds());  // (don't swap end!)
 
-    swap_nodes (p->m_prev, p);   // Swap with the previous one
+    swap_nodes (prev (p), p);    // Swap with the previous one
     return;                      // Done
   }
                                       // Find the node that is
@@ -734,7 +750,7 @@ template<class T,class A,class W,class P>
 
   if (r->m_children[L])  // If r has a left subtree, then the
   {                      // previous node (the rightmost node
-    r = r->m_prev;       // in this left subtree) has no right
+    r = prev (r);        // in this left subtree) has no right
     side = R;            // child. Point r there and insert
   }                      // after the new r
   else
@@ -742,24 +758,20 @@ template<class T,class A,class W,class P>
 
   if (side==L)           // Insert p as r's left child
   {
-    p->m_prev = r->m_prev;    // Link p with r's previous
-    p->m_prev->m_next = p;    // node and link p with r
-                              // in the circular doubly
-    p->m_next = r;            // linked list
-    r->m_prev = p;
-
-    r->m_children[L] = p;     // Make p the left child of r
-  }
+    threads_t::link (threads_t::prev (r), // Link p with r's
+                     p);                  // previous node and
+    threads_t::link (p, r);               // link p with r in
+                                          // the circular doubly
+    r->m_children[L] = p;     // Make p   // linked list (if any)
+  }                           // the left child of r
   else                   // Insert p as r's right child
   {
-    p->m_next = r->m_next;    // Link p with r's next
-    p->m_next->m_prev = p;    // node and link p with r
-                              // in the circular doubly
-    p->m_prev = r;            // linked list
-    r->m_next = p;
-
-    r->m_children[R] = p;     // Make p the right child of r
-  }
+    threads_t::link (p,                   // Link p with r's
+                     threads_t::next (r));// next node and link
+    threads_t::link (r, p);               // p with r in the
+                                          // circular doubly
+    r->m_children[R] = p;     // Make p   // linked list (if any)
+  }                           // the right child of r
 
   p->m_parent = r;       // Make r the parent of p
 
@@ -767,6 +779,7 @@ template<class T,class A,class W,class P>
   p->m_children[R] = NULL;   // Reset other links and
   p->m_count = 1;            // counters of p
   p->m_height = 1;
+  p->m_total_width = p->m_node_width;
                                      // Two branches might be
   update_counters_and_rebalance (q); // unbalanced now: source
   update_counters_and_rebalance (r); // and destination of p
@@ -774,45 +787,63 @@ template<class T,class A,class W,class P>
 
 // move_node(): extract a node p from where it is, and
 // insert it before another node q, which might belong to
-// the same container, or to another one.
+// the same container, or to another one. With NPSV, if p
+// leaves its container, the NPSV dirty list of the source
+// is forgotten (p might be in it)
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   void
-  avl_array<T,A,W,P>::move_node
-  (typename avl_array<T,A,W,P>::node_t * p,
-   typename avl_array<T,A,W,P>::node_t * q)
+  avl_array<T,A,W,P,S>::move_node
+  (typename avl_array<T,A,W,P,S>::node_t * p,
+   typename avl_array<T,A,W,P,S>::node_t * q)
 {
+  my_class * s;
+
   AA_ASSERT (p);            // NULL pointer dereference
   AA_ASSERT (q);            // NULL pointer dereference
 
-  if (q==p || q==p->m_next)
+  if (q==p || q==next (p))
     return;
 
   AA_ASSERT_EXC (p->m_parent,
                  invalid_op_with_end());  // Can't move end node
 
+  if (npsv_used<W>::value)
+  {
+    s = owner (p);
+
+    if (s!=owner (q))
+      s->m_dirty.clear ();
+  }
+
   update_counters_and_rebalance (extract_node (p));
   insert_before (p, q);
 }
 
 // move_nodes(): move n nodes, starting with src_from, to
-// the position dst. The parameter reverse indicates the
-// direction of the destination iterator (true: insert in
-// inverse order and _after_ dst)
+// the position dst (insert them before dst). The parameter
+// reverse indicates the direction of the destination
+// iterator (true: insert in inverse order). The range is cut
+// out of its tree, and then the destination tree is cut at
+// dst and joined again with the range in between (see
+// split_join.hpp). If the range is inverted, the subtree is
+// mirrored too. The range is counted in the direction of
+// src_from, and it is clipped at the end (or the beginning)
+// of the source
 //
-// Complexity: O(min{N, n log N})
+// Complexity: O(log(M)+log(N)), plus O(n) if inverted
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class IT>
 //not inline
   void
-  avl_array<T,A,W,P>::move_nodes
+  avl_array<T,A,W,P,S>::move_nodes
   (IT src_from,                                // Source
-   typename avl_array<T,A,W,P>::size_type n,   // # nodes to move
-   typename avl_array<T,A,W,P>::node_t * dst,  // Destination
+   typename avl_array<T,A,W,P,S>::size_type n,   // # nodes to move
+   typename avl_array<T,A,W,P,S>::node_t * dst,  // Destination
    bool reverse)                               // Dest. direction
 {
 #ifdef BOOST_CLASS_REQUIRE
@@ -826,53 +857,104 @@ template<class IT>
 #endif
 
   my_class * s, * d;
-  node_t * next, * first, * last;
-  bool rebuild_tree, dest_extracted;
+  node_t * first, * last, * after, * before, * dst_prev, * p, * q;
+  node_t block, rest;           // Temporary trees
+  size_type pos, from, to;
+  bool invert;
 
   AA_ASSERT (src_from.ptr);
   AA_ASSERT (dst);
 
-  s = owner (src_from.ptr);
-  d = owner (dst);
+  pos = position_of_node (src_from.ptr, s,
+                          is_reverse (src_from));
 
-  rebuild_tree = false;
-
-  dest_extracted =         // Detect source-destination overlap
-      s->extract_nodes
-        (src_from, n,      // Source
-         first, last,      // Pointers passed by reference!
-         dst,              // Destination (just for checking)
-         s==d ?            // If src and dest are in the same tree,
-           &rebuild_tree : // rebuild only once, after reinsertion
-           NULL,
-         reverse);         // If the destination was specified with
-                           // a reverse iter., make a reverse list
-
-  if (dest_extracted)      // If dest belongs to the extracted
-    dst = src_from.ptr;    // range, fix it (the nodes will be
-                           // reinserted in the same place, maybe
-                           // in revers order...)
-
-  if (reverse)             // If dest is reverse, "before" means
-    dst = dst->m_next;     // "after" from a 'straight' POV
-
-  if (!rebuild_tree &&                // No delayed rebuild _and_
-      !worth_rebuild(n,d->size()))    // 'few' elements
+  if (is_reverse (src_from))      // Find the range [from,to)
+  {                               // in straight order
+    to = pos + 1;                 // (rend() is -1)
+    from = n<to ? to-n : 0;
+  }
+  else
   {
-    while (first)                     // Repeat n times:
+    from = pos;
+    to = n<s->size()-pos ? pos+n : s->size();
+  }
+
+  if (from==to)
+    return;
+
+  first = jump (src_from.ptr,
+                difference_type(from)-difference_type(pos),
+                false);
+  after = jump (first, difference_type(to-from), false);
+
+  invert = is_reverse (src_from)!=reverse;
+  d = owner (dst);
+
+  if (s==d)                       // Is dst in the range, or at
+  {                               // one of its ends? Then the
+    pos = position_of_node (dst, d, false);  // range stays
+                                   // there (maybe inverted)
+    if (pos>=from && pos<=to)
     {
-      next = first;                   // Insert before dst
-      first = first->m_next;          // (after previously
-      insert_before (next, dst);      // inserted copies)
+      if (!invert)
+        return;
+
+      dst = after;
     }
   }
-  else                                // 'many' elements
+
+  last = before = dst_prev = NULL;
+
+  if (S::threaded)                // Ends of the list parts
+  {
+    last = threads_t::prev (after);
+    before = threads_t::prev (first);
+    dst_prev = dst==after ? before : threads_t::prev (dst);
+  }
+
+  make_dummy (&block);
+  make_dummy (&rest);
+
+  split_tree (s->dummy (), first, &block);  // Cut the range
+                                            // out of the source
+  if (after->m_parent)                      // (and join the
+  {                                         // rest again)
+    split_tree (&block, after, &rest);
+    join_trees (s->dummy (), NULL, &rest);
+  }
+
+  if (invert)
   {
-    last->m_next = dst;               // Splice list and
-    dst->m_prev->m_next = first;      // rebuild tree
+    mirror_tree (block.m_children[L]);
 
-    d->build_known_size_tree (n+d->size(), d->m_next);
+    if (S::threaded)
+    {
+      for (p=first; p!=after; p=q)      // Invert the list
+      {                                 // of the range
+        q = threads_t::next (p);
+        threads_t::next (p) = threads_t::prev (p);
+        threads_t::prev (p) = q;
+      }
+
+      p = first;
+      first = last;
+      last = p;
+    }
+  }
+
+  split_tree (d->dummy (), dst, &rest);   // Insert the range
+  join_trees (d->dummy (), NULL, &block); // before dst
+  join_trees (d->dummy (), NULL, &rest);
+
+  if (S::threaded)
+  {
+    threads_t::link (before, after);      // Close the gap and
+    threads_t::link (dst_prev, first);    // open another one
+    threads_t::link (last, dst);          // in the list
   }
+
+  if (s!=d)
+    d->npsv_nodes_from (*s);
 }
 
 //////////////////////////////////////////////////////////////////
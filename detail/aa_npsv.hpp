@@ -20,6 +20,17 @@
   npsv_at_pos(): get elem. of a position O(log N) or O(N)*
   (*) width sums need to be updated
   (**) don't update width sums (lazy mode)
+
+  Private helper method:
+
+  npsv_nodes_from(): take the dirty state of moved nodes O(1)
+
+  In lazy mode, the changed nodes are remembered (up to a limit)
+  in the list m_dirty, so that only their paths to the root need
+  to be updated later: O(k log N) for k changes, instead of O(N).
+  Operations that take nodes out of the tree, or move them to
+  another avl_array, forget the list (a pointer in it could
+  outlive its node), and then a full update is done instead.
 */
 
 #ifndef _AVL_ARRAY_NON_PROPORTIONAL_SEQUENCE_VIEW_HPP_
@@ -37,30 +48,47 @@ namespace mkr  // Public namespace
 // ---------------------- PUBLIC INTERFACE -----------------------
 
 // npsv_update_sums(): Update the m_total_width field of
-// every node in the tree. This is achieved in O(N) time
+// every node in the tree. If the nodes whose width changed
+// are in the list m_dirty, climb from every one of them to
+// the root, updating the sums in the way (a node updated
+// before one of its descendants will be updated again
+// after it). Otherwise, this is achieved in O(N) time
 // with a post-order traversal of the tree. This method
 // will be called when, after changing NPSV widths in the
 // lazy mode (see npsv_set_width()), they are required for
 // any operation. If the lazy mode is not used, or if the
 // sums are already up to date, then this method is a nop.
 //
-// Complexity: O(N)
+// Complexity: O(k log N) for k nodes in m_dirty, or O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::npsv_update_sums () const
+  avl_array<T,A,W,P,S>::npsv_update_sums () const
 {
   node_t * p;
+  size_type i;
 
   if (!m_sums_out_of_date)    // Already ok?
     return;                   // get out
 
-  p = node_t::m_next;   // Go to leftmost node in the tree
+  if (!m_dirty.empty ())      // Just a few paths?
+  {
+    for (i=0; i<m_dirty.size (); i++)
+      for (p=m_dirty[i]; p; p=p->m_parent)
+        p->m_total_width = p->subtree_width ();
+
+    m_dirty.clear ();
+    m_sums_out_of_date = false;
+    return;
+  }
+
+  p = next (dummy ());  // Go to leftmost node in the tree
 
   if (!p->m_parent)               // If the avl_array is empty
   {                               // just reset the
-    p->m_total_width = W(0);      // width, clear the
+    p->m_total_width =            // width, clear the
+          monoid_traits<W>::identity ();
     m_sums_out_of_date = false;   // NPSV dirty flag
     return;                       // and get out
   }
@@ -78,9 +106,7 @@ template<class T,class A,class W,class P>
     {                                            // last child
       p = p->m_parent;                           // update, go
                                                  // up an see
-      p->m_total_width = p->left_width () +      // again
-                         p->right_width () +
-                         p->m_node_width;
+      p->m_total_width = p->subtree_width ();    // again
 
       if (!p->m_parent)                // If we reached the
       {                                // root, it's done
@@ -100,9 +126,9 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(1), or O(N) if sums were not up to date
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  W avl_array<T,A,W,P>::npsv_width () const
+  W avl_array<T,A,W,P,S>::npsv_width () const
 {
   if (m_sums_out_of_date)
     npsv_update_sums ();
@@ -116,10 +142,10 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  W avl_array<T,A,W,P>::npsv_width
-  (typename avl_array<T,A,W,P>::const_iterator it) const
+  W avl_array<T,A,W,P,S>::npsv_width
+  (typename avl_array<T,A,W,P,S>::const_iterator it) const
 {
   AA_ASSERT (it.ptr);          // it must point somewhere
   return it.ptr->m_node_width;
@@ -128,25 +154,26 @@ inline
 // npsv_set_width(): modify the width of a node (the
 // width is the amount of 'space' it occupies in the
 // alternative sequence). If the third parameter is false,
-// don't update width sums (it will be done later for the
-// whole tree). This lazy technique will save time in
-// those cases where many widths need to be updated in a
-// row, getting O(N) complexity instead of O(n log N).
+// don't update width sums (it will be done later, only
+// for the paths of the changed nodes, or for the whole
+// tree if they are more than N/height). This lazy
+// technique will save time in those cases where many
+// widths need to be updated in a row, getting O(N)
+// complexity instead of O(n log N). The work is done
+// by set_width() (see aa_augment.hpp).
 //
 // Complexity: O(log N), or O(1) if update_sums==false
+// (plus the pending updates, if sums were out of date)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::npsv_set_width
-  (const typename avl_array<T,A,W,P>::iterator & it,
+  avl_array<T,A,W,P,S>::npsv_set_width
+  (const typename avl_array<T,A,W,P,S>::iterator & it,
    W w,
    bool update_sums)
 {
-  node_t * p;
-
   AA_ASSERT (it.ptr);                 // it must point somewhere
-  AA_ASSERT_HO (owner(it.ptr)==this); // it must point here
   AA_ASSERT (w>=W(0));                // Neg. width is forbidden
 
   AA_ASSERT_EXC (it.ptr->m_parent,       // Can't change
@@ -155,20 +182,7 @@ template<class T,class A,class W,class P>
   if (it.ptr->m_node_width==w)  // If the width w is not new
     return;                     // there's nothing to do
 
-  it.ptr->m_node_width = w;     // Set the new width
-
-  if (update_sums)              // If required, update all sums
-  {                             // of the tree, or just climb
-    if (m_sums_out_of_date)     // to the root updating sums
-      npsv_update_sums ();      // in the way
-    else
-      for (p=it.ptr; p; p=p->m_parent)
-        p->m_total_width = p->left_width () +
-                           p->right_width () +
-                           p->m_node_width;
-  }
-  else                          // If no sums update,
-    m_sums_out_of_date = true;  // set NPSV dirty bit
+  set_width (it, w, update_sums);
 }
 
 // npsv_pos_of(): given a node, calculate its position
@@ -177,11 +191,11 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(log N), or O(N) if sums are out of date
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   W
-  avl_array<T,A,W,P>::npsv_pos_of
-  (typename avl_array<T,A,W,P>::const_iterator it) const
+  avl_array<T,A,W,P,S>::npsv_pos_of
+  (typename avl_array<T,A,W,P,S>::const_iterator it) const
 {
   W pos;
   const node_t * p, * parent;
@@ -219,10 +233,10 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(log N), or O(N) if sums are out of date
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::npsv_at_pos
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::npsv_at_pos
   (W pos)
 {
   node_t * p;
@@ -234,7 +248,7 @@ template<class T,class A,class W,class P>
   if (size()==0 || pos<W(0) ||
       pos>node_t::m_total_width ||          // Out of bounds --> end
       (pos==node_t::m_total_width &&
-       node_t::m_prev->m_node_width!=W(0)))
+       prev (dummy ())->m_node_width!=W(0)))
     return dummy ();
 
   p = node_t::m_children[L]; // Start with the element at the
@@ -254,7 +268,7 @@ template<class T,class A,class W,class P>
     if (pos<left ||                 // down-right decreases pos
         (p->m_children[L] &&               // by the sum of the
          pos==left &&                           // widths of
-         p->m_prev->m_node_width==W(0)))       // the nodes
+         prev (p)->m_node_width==W(0)))       // the nodes
       p = p->m_children[L];                   // we leave at
     else if (pos<right ||                    // the left side
              (pos==right &&                 // (including the
@@ -274,10 +288,10 @@ template<class T,class A,class W,class P>
 // npsv_at_pos() _const_: See non-const version (above) for
 // details.
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
-  typename avl_array<T,A,W,P>::const_iterator
-  avl_array<T,A,W,P>::npsv_at_pos
+  typename avl_array<T,A,W,P,S>::const_iterator
+  avl_array<T,A,W,P,S>::npsv_at_pos
   (W pos)                          const
 {
   return (const_cast<my_class*>(this))->npsv_at_pos (pos);
@@ -297,11 +311,11 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(log N), or O(N) if sums are out of date
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 //not inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::npsv_at_pos
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::npsv_at_pos
   (W pos, CMP cmp)
 {
 #ifdef BOOST_CLASS_REQUIRE
@@ -320,7 +334,7 @@ template<class CMP>
       cmp(pos,W(0))<0 ||                             // pos<(W)0
       (c=cmp(pos,node_t::m_total_width))>0 ||        //  " >total_w
       (c==0 &&                                       //  " == "
-       cmp(node_t::m_prev->m_node_width,W(0))!=0))   // prev_w != 0
+       cmp(prev (dummy ())->m_node_width,W(0))!=0))   // prev_w != 0
     return dummy ();
 
   p = node_t::m_children[L];
@@ -335,7 +349,7 @@ template<class CMP>
     if ((c=cmp(pos,left))<0 ||              // pos < left
         (p->m_children[L] &&
          c==0 &&                            // pos == left
-         cmp(p->m_prev->m_node_width,W(0))
+         cmp(prev (p)->m_node_width,W(0))
                                       ==0)) // prev_w == 0
       p = p->m_children[L];
     else if ((c=cmp(pos,right))<0 ||        // pos < right
@@ -357,11 +371,11 @@ template<class CMP>
 // npsv_at_pos() _const_: See non-const version (above) for
 // details.
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 inline
-  typename avl_array<T,A,W,P>::const_iterator
-  avl_array<T,A,W,P>::npsv_at_pos
+  typename avl_array<T,A,W,P,S>::const_iterator
+  avl_array<T,A,W,P,S>::npsv_at_pos
   (W pos, CMP cmp)                      const
 {
 #ifdef BOOST_CLASS_REQUIRE
@@ -373,6 +387,32 @@ inline
                                  npsv_at_pos (pos, cmp);
 }
 
+// ------------------- PRIVATE HELPER METHODS --------------------
+
+// npsv_nodes_from(): Update the NPSV dirty state after moving
+// nodes (maybe whole subtrees) from s to this avl_array. The
+// list of s is forgotten, because some of its nodes might be
+// here now. If the sums of s were out of date, the moved
+// subtrees might have wrong sums, so a full update is
+// required here too
+//
+// Complexity: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline
+  void
+  avl_array<T,A,W,P,S>::npsv_nodes_from
+  (typename avl_array<T,A,W,P,S>::my_class & s)
+{
+  s.m_dirty.clear ();
+
+  if (s.m_sums_out_of_date)
+  {
+    m_sums_out_of_date = true;
+    m_dirty.clear ();
+  }
+}
+
 //////////////////////////////////////////////////////////////////
 
 }  // namespace mkr
@@ -48,59 +48,59 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(log(N))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reference
-  avl_array<T,A,W,P>::operator[]
-  (typename avl_array<T,A,W,P>::size_type n)
+  typename avl_array<T,A,W,P,S>::reference
+  avl_array<T,A,W,P,S>::operator[]
+  (typename avl_array<T,A,W,P,S>::size_type n)
 {
-  AA_ASSERT_EXC (n>=0 && n<size(),
+  AA_ASSERT_EXC (n<size(),
                  index_out_of_bounds());  // Index out of range
 
   return data (node_at_pos(n));
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reference
-  avl_array<T,A,W,P>::operator()
-  (typename avl_array<T,A,W,P>::size_type n)
+  typename avl_array<T,A,W,P,S>::reference
+  avl_array<T,A,W,P,S>::operator()
+  (typename avl_array<T,A,W,P,S>::size_type n)
 {
   return operator[](n);     // Operator() does exactly
 }                           // the same as operator[]
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::reference
-  avl_array<T,A,W,P>::at
-  (typename avl_array<T,A,W,P>::size_type n)
+  typename avl_array<T,A,W,P,S>::reference
+  avl_array<T,A,W,P,S>::at
+  (typename avl_array<T,A,W,P,S>::size_type n)
 {
   return operator[](n);     // And at() too
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::const_reference
-  avl_array<T,A,W,P>::operator[]
-  (typename avl_array<T,A,W,P>::size_type n)    const
+  typename avl_array<T,A,W,P,S>::const_reference
+  avl_array<T,A,W,P,S>::operator[]
+  (typename avl_array<T,A,W,P,S>::size_type n)    const
 {
   return (*const_cast<my_class*>(this))[n];
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::const_reference
-  avl_array<T,A,W,P>::operator()
-  (typename avl_array<T,A,W,P>::size_type n)    const
+  typename avl_array<T,A,W,P,S>::const_reference
+  avl_array<T,A,W,P,S>::operator()
+  (typename avl_array<T,A,W,P,S>::size_type n)    const
 {
   return operator[](n);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::const_reference
-  avl_array<T,A,W,P>::at
-  (typename avl_array<T,A,W,P>::size_type n)    const
+  typename avl_array<T,A,W,P,S>::const_reference
+  avl_array<T,A,W,P,S>::at
+  (typename avl_array<T,A,W,P,S>::size_type n)    const
 {
   return operator[](n);
 }
@@ -118,12 +118,12 @@ inline
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
-  typename avl_array<T,A,W,P>::size_type
-  avl_array<T,A,W,P>::position_of_node
-  (const typename avl_array<T,A,W,P>::node_t * p,
-   typename avl_array<T,A,W,P>::my_class * & a,
+  typename avl_array<T,A,W,P,S>::size_type
+  avl_array<T,A,W,P,S>::position_of_node
+  (const typename avl_array<T,A,W,P,S>::node_t * p,
+   typename avl_array<T,A,W,P,S>::my_class * & a,
    bool reverse)
 {
   size_type pos;
@@ -134,9 +134,9 @@ template<class T,class A,class W,class P>
   if (!p->m_parent)        // Already in the dummy node?
   {
     a = dummy_owner (p);
-    return reverse ?
-           -1 :            // rend()
-           p->m_count-1;   // end()
+    return reverse ?                // rend() or end(), both as
+           size_type(-1) :          // size_type (with a narrow
+           size_type(p->m_count-1); // count, -1 would be 2^32-1)
   }
                              // Otherwise, start with the
   for (pos=p->left_count();  // left conunt of the node and
@@ -160,11 +160,11 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
-  typename avl_array<T,A,W,P>::node_t *
-  avl_array<T,A,W,P>::node_at_pos
-  (typename avl_array<T,A,W,P>::size_type pos) const
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::node_at_pos
+  (typename avl_array<T,A,W,P,S>::size_type pos) const
 {
   node_t * p;
 
@@ -174,10 +174,10 @@ template<class T,class A,class W,class P>
   //    return dummy ();              // [], is the only caller
 
   if (pos==0)                // The easiest cases are the first
-    return node_t::m_next;   // and last element. Covering them
+    return next (dummy ());  // and last element. Covering them
                              // this way, we add an extra little
   if (pos==size()-1)         // overhead to the average case.
-    return node_t::m_prev;   // Is the benefit worth it? Well,
+    return prev (dummy ());  // Is the benefit worth it? Well,
                              // the user might index [0] and
                              // [size()-1] very often...
 
@@ -214,12 +214,12 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
-  typename avl_array<T,A,W,P>::node_t *
-  avl_array<T,A,W,P>::jump
-  (typename avl_array<T,A,W,P>::node_t * p,
-   typename avl_array<T,A,W,P>::difference_type n,
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::jump
+  (typename avl_array<T,A,W,P,S>::node_t * p,
+   typename avl_array<T,A,W,P,S>::difference_type n,
    bool reverse)
 {
   difference_type i;
@@ -232,7 +232,7 @@ template<class T,class A,class W,class P>
   if (reverse &&          // Special case: jump _from_ rend
       !p->m_parent)
   {                       // Go to the first element, and
-    p = p->m_next;        // jump from there instead
+    p = next (p);         // jump from there instead
     n --;                 // (adjust n, of course)
   }
                           // The offset n will be adjusted all
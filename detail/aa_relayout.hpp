@@ -0,0 +1,296 @@
+///////////////////////////////////////////////////////////////////
+//                                                               //
+//  Copyright (c) 2006, Universidad de Alcala                    //
+//                                                               //
+//  See accompanying LICENSE.TXT                                 //
+//                                                               //
+///////////////////////////////////////////////////////////////////
+
+/*
+  detail/aa_relayout.hpp
+  ----------------------
+
+  Methods for changing the memory layout of the nodes. After many
+  insertions and removals, neighbour nodes are scattered in
+  memory, and both travels and searches miss the cache at almost
+  every step. relayout() copies all the nodes to new memory, in
+  sequence order (best for travels) or in van Emde Boas order
+  (best for searches from the root). With a pool allocator (see
+  node_pool.hpp) the new nodes are contiguous; with any other
+  allocator they are allocated one by one in that order.
+
+  relayout(o): copy all nodes in the order o (O(N))
+  relayout(o,from,to): idem, and update some iterators (O(N+M))
+
+  Private helper methods:
+
+  veb_sequence(): list a subtree in vEB order (O(N log log N))
+  veb_bottoms(): idem for the subtrees at a given depth "
+  relocate_nodes(): copy nodes and fix links (O(N))
+  forward(): new address of a relocated node (O(1))
+*/
+
+#ifndef _AVL_ARRAY_RELAYOUT_HPP_
+#define _AVL_ARRAY_RELAYOUT_HPP_
+
+#ifndef _AVL_ARRAY_HPP_
+#error "Don't include this file. Include avl_array.hpp instead."
+#endif
+
+namespace mkr  // Public namespace
+{
+
+//////////////////////////////////////////////////////////////////
+
+// ---------------------- PUBLIC INTERFACE -----------------------
+
+// relayout(): copy every node (and its T object) to new memory,
+// in the given order, and destroy the old nodes. All iterators
+// are invalidated, except the end ones
+//
+// Complexity: O(N), or O(N log log N) in van Emde Boas order
+
+template<class T,class A,class W,class P,class S>
+inline
+  void
+  avl_array<T,A,W,P,S>::relayout
+  (typename avl_array<T,A,W,P,S>::layout_order o)
+{
+  iterator * none = NULL;
+
+  relayout (o, none, none);
+}
+
+// relayout(): idem, but every iterator in the range [from,to)
+// (e.g. a vector of iterators) is updated to refer to the new
+// copy of its node. The old nodes work as a forwarding table
+// until the end of the operation: their parent link keeps the
+// address of their copy.
+// If a T copy constructor throws, the array and the iterators
+// are left untouched
+//
+// Complexity: O(N+M), or O(N log log N + M) in van Emde Boas
+// order (M is the number of iterators to update)
+
+template<class T,class A,class W,class P,class S>
+template<class IT>
+//not inline
+  void
+  avl_array<T,A,W,P,S>::relayout
+  (typename avl_array<T,A,W,P,S>::layout_order o,
+   IT from, IT to)
+{
+  typedef typename A::template
+          rebind<node_t*>::other ptr_allocator_t;
+
+  ptr_allocator_t ptr_allocator;
+  node_t ** nodes, ** out, * p;
+  size_type n, i;
+
+  n = size ();
+
+  if (n==0)
+    return;
+
+  nodes = ptr_allocator.allocate (n);   // The nodes, in the
+
+  if (nodes==NULL)                      // new order
+    throw allocator_returned_null();
+
+  out = nodes;
+
+  if (o==veb_order)
+    veb_sequence (node_t::m_children[L],
+                  node_t::m_children[L]->m_height, out);
+  else
+    for (p=next(dummy()); p!=dummy(); p=next(p))
+      *out++ = p;
+
+  try
+  {
+    relocate_nodes (nodes, n);          // Copy them and fix links
+  }
+  catch (...)
+  {
+    ptr_allocator.deallocate (nodes, n);
+    throw;
+  }
+
+  for (; from!=to; ++from)              // Forward the iterators
+    (*from).ptr = forward ((*from).ptr);
+
+  for (i=0; i<n; i++)                   // Forget the old nodes
+    delete_node (nodes[i]);
+
+  ptr_allocator.deallocate (nodes, n);
+}
+
+// ------------------- PRIVATE HELPER METHODS --------------------
+
+// veb_sequence(): Append to out the nodes of the top h levels
+// of the subtree whose root is p, in van Emde Boas order: the
+// top h/2 levels first (recursively in vEB order), and then
+// the subtrees hanging from them, from left to right (each
+// one in vEB order too). This way, any path from the root
+// crosses O(log N / log B) blocks of B nodes, for any B
+//
+// Complexity: O(N log log N)
+
+template<class T,class A,class W,class P,class S>
+//not inline static
+  void
+  avl_array<T,A,W,P,S>::veb_sequence
+  (typename avl_array<T,A,W,P,S>::node_t * p,
+   int h,
+   typename avl_array<T,A,W,P,S>::node_t **& out)
+{
+  if (!p)
+    return;
+
+  if (h==1)                   // Single level
+  {
+    *out++ = p;
+    return;
+  }
+
+  veb_sequence (p, h/2, out);      // Top half, and then the
+  veb_bottoms (p, h/2, h-h/2, out); // bottom half subtrees
+}
+
+// veb_bottoms(): Apply veb_sequence(h) to the subtrees whose
+// roots are at depth d below p, from left to right
+//
+// Complexity: O(N log log N) (see above)
+
+template<class T,class A,class W,class P,class S>
+//not inline static
+  void
+  avl_array<T,A,W,P,S>::veb_bottoms
+  (typename avl_array<T,A,W,P,S>::node_t * p,
+   int d, int h,
+   typename avl_array<T,A,W,P,S>::node_t **& out)
+{
+  if (!p)
+    return;
+
+  if (d==0)
+    veb_sequence (p, h, out);
+  else
+  {
+    veb_bottoms (p->m_children[L], d-1, h, out);
+    veb_bottoms (p->m_children[R], d-1, h, out);
+  }
+}
+
+// relocate_nodes(): Copy the n given nodes to new memory, in
+// that order, leaving in the parent link of every old node
+// the address of its copy (see forward()), and then make the
+// copies point to each other instead of the old nodes. The
+// old nodes are left for the caller to delete.
+// With a pool allocator, all the copies are allocated in one
+// block. If a T copy constructor throws, the copies are
+// destroyed and the old parent links are restored
+//
+// Complexity: O(N)
+
+template<class T,class A,class W,class P,class S>
+//not inline
+  void
+  avl_array<T,A,W,P,S>::relocate_nodes
+  (typename avl_array<T,A,W,P,S>::node_t ** nodes,
+   typename avl_array<T,A,W,P,S>::size_type n)
+{
+  payload_node_t * block, * q;
+  size_type k, i;
+  node_t * p;
+
+  block = pool_traits<allocator_t>::allocate_block (allocator, n);
+  q = NULL;
+  k = 0;
+
+  try
+  {
+    for (; k<n; k++)
+    {
+      q = block ?
+          pool_traits<allocator_t>::block_item (block, k) :
+          allocator.allocate (1);
+
+      if (q==NULL)
+        throw allocator_returned_null();
+
+      new (q) payload_node_t                   // Copy node and T
+          (*static_cast<payload_node_t*>(nodes[k]));
+
+      nodes[k]->m_parent = q;                  // Leave forward
+      q = NULL;                                // address
+    }
+  }
+  catch (...)
+  {
+    if (q && !block)                    // Allocated, but not
+      allocator.deallocate (q, 1);      // constructed
+
+    while (k--)                         // Undo the copies
+    {
+      q = static_cast<payload_node_t*>(nodes[k]->m_parent);
+      nodes[k]->m_parent = q->m_parent;
+      q->~payload_node_t ();
+
+      if (!block)
+        allocator.deallocate (q, 1);
+    }
+
+    if (block)
+      for (i=0; i<n; i++)
+        allocator.deallocate
+            (pool_traits<allocator_t>::block_item (block, i), 1);
+
+    throw;
+  }
+
+  for (k=0; k<n; k++)                   // The copies still point
+  {                                     // to the old nodes: make
+    p = nodes[k]->m_parent;             // them point to the new
+                                        // ones
+    p->m_parent = forward (p->m_parent);
+    p->m_children[L] = forward (p->m_children[L]);
+    p->m_children[R] = forward (p->m_children[R]);
+
+    if (S::threaded)
+    {
+      threads_t::next (p) = forward (threads_t::next (p));
+      threads_t::prev (p) = forward (threads_t::prev (p));
+    }
+  }
+
+  p = dummy ();                         // And the dummy node too
+
+  p->m_children[L] = forward (p->m_children[L]);
+
+  if (S::threaded)
+  {
+    threads_t::next (p) = forward (threads_t::next (p));
+    threads_t::prev (p) = forward (threads_t::prev (p));
+  }
+}
+
+// forward(): Get the new address of a node during a relayout.
+// The dummy node is not relocated (it has no parent)
+//
+// Complexity: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline //static
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::forward
+  (typename avl_array<T,A,W,P,S>::node_t * p)
+{
+  return p && p->m_parent ? p->m_parent : p;
+}
+
+//////////////////////////////////////////////////////////////////
+
+}  // namespace mkr
+
+#endif
@@ -15,6 +15,7 @@
   size(): retrieve current size (O(1))
   empty(): true if empty; false otherwise (O(1))
   max_size(): estimated maximum size in theory (O(1))
+  reserve(n): preallocate nodes, if A is a pool (O(1))
   resize(n): change size (O(min{N, n log N}))
   resize(n,t): idem, but add copies of t  "
 
@@ -41,10 +42,10 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::size_type
-  avl_array<T,A,W,P>::size () const
+  typename avl_array<T,A,W,P,S>::size_type
+  avl_array<T,A,W,P,S>::size () const
 {
   return  node_t::m_count-1;
 }
@@ -53,10 +54,10 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::empty () const
+  avl_array<T,A,W,P,S>::empty () const
 {
   return size()==0;
 }
@@ -64,26 +65,36 @@ inline
 // max_size(): estimated maximum size (in theory) supposing
 // that a whole address space is available (which is
 // obviously impossible) and taking into account that
-// end()-begin() should fit in difference_type
+// end()-begin() should fit in difference_type. The count
+// type of the layout (S) may impose a lower limit (note
+// that the dummy node's count includes itself)
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
-  typename avl_array<T,A,W,P>::size_type
-  avl_array<T,A,W,P>::max_size ()
+  typename avl_array<T,A,W,P,S>::size_type
+  avl_array<T,A,W,P,S>::max_size ()
 {
+  size_type mxp, mxu, r, mn, mxc;
+
+  mxc = sizeof(typename S::count_type) < sizeof(size_type) ?
+        size_type(typename S::count_type(-1)) - 1 :
+        size_type(-1);
                              // If pointers are smaller or eq.
                              // to size_type, the limit is
                              // imposed by the address space
 
   if (sizeof(void*)<=sizeof(size_type))
-    return ( ( size_type(1) <<
-               ((sizeof(void*)<<3)-1) ) /
-             sizeof(payload_node_t)       ) << 1;
+  {
+    mxp = ( ( size_type(1) <<
+              ((sizeof(void*)<<3)-1) ) /
+            sizeof(payload_node_t)       ) << 1;
 
-  size_type mxp, mxu, r, mn;    // Otherwise, it depends on
-                                         // the sizes ratio
+    return mxp < mxc ? mxp : mxc;
+  }
+                                // Otherwise, it depends on
+                                // the sizes ratio
   mxp = ( ( size_type(1) <<
             ((sizeof(size_type)<<3)-1) ) /
           sizeof(payload_node_t)           ) << 1;
@@ -96,9 +107,27 @@ template<class T,class A,class W,class P>
   r =  ( sizeof(void*) -            // Using r we avoid
          sizeof(size_type) ) << 3;  // overflow on mxp
 
-  return (mxu>>r) < mxp ? // If the index type size is more
-         mxu :            // restrictive, choose it. Otherwise
-         (mxp<<r);        // choose the address space limit
+  mxp = (mxu>>r) < mxp ?  // If the index type size is more
+        mxu :             // restrictive, choose it. Otherwise
+        (mxp<<r);         // choose the address space limit
+
+  return mxp < mxc ? mxp : mxc;
+}
+
+// reserve(): make room in the allocator for n more nodes, so
+// that inserting them won't need to ask the heap for memory.
+// Only pool allocators (see node_pool.hpp) can do this. With
+// other allocators, it does nothing
+//
+// Complexity: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline
+  void
+  avl_array<T,A,W,P,S>::reserve
+  (typename avl_array<T,A,W,P,S>::size_type n)
+{
+  pool_traits<allocator_t>::reserve (allocator, n);
 }
 
 // resize(): change the size of the avl_array, deleting
@@ -107,12 +136,12 @@ template<class T,class A,class W,class P>
 //
 // Complexity: (O(min{N, n log N}))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::resize
-  (typename avl_array<T,A,W,P>::size_type n,
-   typename avl_array<T,A,W,P>::const_reference t)
+  avl_array<T,A,W,P,S>::resize
+  (typename avl_array<T,A,W,P,S>::size_type n,
+   typename avl_array<T,A,W,P,S>::const_reference t)
 {
   size_type sz=size();                  // If there's a big
                                         // difference with
@@ -138,11 +167,11 @@ template<class T,class A,class W,class P>
 //
 // Complexity: (O(min{N, n log N}))
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 //not inline
   void
-  avl_array<T,A,W,P>::resize
-  (typename avl_array<T,A,W,P>::size_type n)
+  avl_array<T,A,W,P,S>::resize
+  (typename avl_array<T,A,W,P,S>::size_type n)
 {
   null_data_provider<const_pointer> dp;
   node_t * first, * last, * p;
@@ -164,7 +193,7 @@ template<class T,class A,class W,class P>
     while (first)
     {
       p = first;
-      first = first->m_next;
+      first = first->list_next ();
       insert_before (p, dummy());
     }
   }
@@ -180,11 +209,11 @@ template<class T,class A,class W,class P>
 //
 // Complexity: O(max{old_size,new_size})
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class DP>
   void
-  avl_array<T,A,W,P>::resize
-  (typename avl_array<T,A,W,P>::size_type n,
+  avl_array<T,A,W,P,S>::resize
+  (typename avl_array<T,A,W,P,S>::size_type n,
    DP & dp)
 {
   node_t * first, * last;
@@ -193,18 +222,18 @@ template<class DP>
   if (n>size())                   // and/or recycling nodes
   {
     construct_nodes_list (first, last, n-size(), dp);
-    node_t::m_prev->m_next = first;
-    build_known_size_tree (n, node_t::m_next);
+    flatten ();
+    node_t::list_prev ()->list_next () = first;
+    build_known_size_tree (n, node_t::list_next ());
   }
   else
   {
-    node_t::m_prev->m_next = NULL;
-    next = build_known_size_tree (n, node_t::m_next);
+    next = build_known_size_tree (n, detach_list ());
 
     while (next)                  // Destruct remaining
     {                             // old elements
       p = next;
-      next = next->m_next;
+      next = next->list_next ();
       delete_node (p);
     }
   }
@@ -17,13 +17,17 @@
   insert_sorted(): insert keeping order* (O(log N))
   sort(): impose order                          (O(N log N))
   stable_sort(): idem + keep current order between equals "
+  sort(cmp,threads): sort node pointers in parallel    "
+  stable_sort(cmp,threads): idem, stable (P not needed) "
   merge(): mix two containers, keeping order* (O(M+N))
   unique(): remove duplicates* (O(N))
   (*) Elements must be previously in order
 
-  Private helper method:
+  Private helper methods:
 
   binary_search(): search value in a sorted tree (O(log N))
+  sort_nodes(): sort an array of node pointers and rebuild
+                the tree with them (O(N log N))
 */
 
 #ifndef _AVL_ARRAY_SORTED_SEARCH_TREE_HPP_
@@ -61,13 +65,13 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 inline
   bool
-  avl_array<T,A,W,P>::binary_search
-  (typename avl_array<T,A,W,P>::const_reference t,
-   typename avl_array<T,A,W,P>::const_iterator & it,
+  avl_array<T,A,W,P,S>::binary_search
+  (typename avl_array<T,A,W,P,S>::const_reference t,
+   typename avl_array<T,A,W,P,S>::const_iterator & it,
    CMP cmp)                                          const
 {
 #ifdef BOOST_CLASS_REQUIRE
@@ -79,13 +83,13 @@ inline
   return binary_search (t, &it.ptr, cmp);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 inline
   bool
-  avl_array<T,A,W,P>::binary_search
-  (typename avl_array<T,A,W,P>::const_reference t,
-   typename avl_array<T,A,W,P>::iterator & it,
+  avl_array<T,A,W,P,S>::binary_search
+  (typename avl_array<T,A,W,P,S>::const_reference t,
+   typename avl_array<T,A,W,P,S>::iterator & it,
    CMP cmp)
 {
 #ifdef BOOST_CLASS_REQUIRE
@@ -97,13 +101,13 @@ inline
   return binary_search (t, &it.ptr, cmp);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 inline
   bool
-  avl_array<T,A,W,P>::binary_search
-  (typename avl_array<T,A,W,P>::const_reference t,
-   typename avl_array<T,A,W,P>::const_reverse_iterator & it,
+  avl_array<T,A,W,P,S>::binary_search
+  (typename avl_array<T,A,W,P,S>::const_reference t,
+   typename avl_array<T,A,W,P,S>::const_reverse_iterator & it,
    CMP cmp)                                          const
 {
 #ifdef BOOST_CLASS_REQUIRE
@@ -116,18 +120,18 @@ inline
   bool found;
 
   found = binary_search (t, &p, cmp);
-  it.ptr = found ? p : p->m_prev;     // Reverse --> the
+  it.ptr = found ? p : prev (p);      // Reverse --> the
                                       // element 'before'
   return found;                       // which t would be
 }                                     // is the previous
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 inline
   bool
-  avl_array<T,A,W,P>::binary_search
-  (typename avl_array<T,A,W,P>::const_reference t,
-   typename avl_array<T,A,W,P>::reverse_iterator & it,
+  avl_array<T,A,W,P,S>::binary_search
+  (typename avl_array<T,A,W,P,S>::const_reference t,
+   typename avl_array<T,A,W,P,S>::reverse_iterator & it,
    CMP cmp)
 {
 #ifdef BOOST_CLASS_REQUIRE
@@ -140,58 +144,58 @@ inline
   bool found;
 
   found = binary_search (t, &p, cmp);
-  it.ptr = found ? p : p->m_prev;     // Reverse --> the
+  it.ptr = found ? p : prev (p);      // Reverse --> the
                                       // element 'before'
   return found;                       // which t would be
 }                                     // is the previous
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::binary_search
-  (typename avl_array<T,A,W,P>::const_reference t,
-   typename avl_array<T,A,W,P>::iterator & it)
+  avl_array<T,A,W,P,S>::binary_search
+  (typename avl_array<T,A,W,P,S>::const_reference t,
+   typename avl_array<T,A,W,P,S>::iterator & it)
 {
   return binary_search (t, it, std::less<value_type>());
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::binary_search
-  (typename avl_array<T,A,W,P>::const_reference t,
-   typename avl_array<T,A,W,P>::reverse_iterator & it)
+  avl_array<T,A,W,P,S>::binary_search
+  (typename avl_array<T,A,W,P,S>::const_reference t,
+   typename avl_array<T,A,W,P,S>::reverse_iterator & it)
 {
   return binary_search (t, it, std::less<value_type>());
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::binary_search
-  (typename avl_array<T,A,W,P>::const_reference t,
-   typename avl_array<T,A,W,P>::const_iterator & it)
+  avl_array<T,A,W,P,S>::binary_search
+  (typename avl_array<T,A,W,P,S>::const_reference t,
+   typename avl_array<T,A,W,P,S>::const_iterator & it)
                                                       const
 {
   return binary_search (t, it, std::less<value_type>());
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::binary_search
-  (typename avl_array<T,A,W,P>::const_reference t,
-   typename avl_array<T,A,W,P>::const_reverse_iterator & it)
+  avl_array<T,A,W,P,S>::binary_search
+  (typename avl_array<T,A,W,P,S>::const_reference t,
+   typename avl_array<T,A,W,P,S>::const_reverse_iterator & it)
                                                       const
 {
   return binary_search (t, it, std::less<value_type>());
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
   bool
-  avl_array<T,A,W,P>::binary_search
-  (typename avl_array<T,A,W,P>::const_reference t)
+  avl_array<T,A,W,P,S>::binary_search
+  (typename avl_array<T,A,W,P,S>::const_reference t)
                                                       const
 {
   node_t * p;
@@ -219,12 +223,12 @@ inline
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::insert_sorted
-  (typename avl_array<T,A,W,P>::const_reference t,
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::insert_sorted
+  (typename avl_array<T,A,W,P,S>::const_reference t,
    bool allow_duplicates,
    CMP cmp)
 {
@@ -248,11 +252,11 @@ inline
   return iterator(newnode);
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::iterator
-  avl_array<T,A,W,P>::insert_sorted
-  (typename avl_array<T,A,W,P>::const_reference t,
+  typename avl_array<T,A,W,P,S>::iterator
+  avl_array<T,A,W,P,S>::insert_sorted
+  (typename avl_array<T,A,W,P,S>::const_reference t,
    bool allow_duplicates)
 {
   return insert_sorted (t, allow_duplicates,
@@ -275,10 +279,10 @@ inline
 // Complexity: O(N log N)
 // (where N is the number of elements in the array)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 //not inline
-  void avl_array<T,A,W,P>::sort (CMP cmp)
+  void avl_array<T,A,W,P,S>::sort (CMP cmp)
 {
 #ifdef BOOST_CLASS_REQUIRE
   function_requires<
@@ -291,15 +295,15 @@ template<class CMP>
   if (size()<2)
     return;
 
-  node_t::m_prev->m_next = NULL; // Detach the whole tree and use
-  next = node_t::m_next;         // it as an independent list
+  next = detach_list ();         // Detach the whole tree and use
+                                 // it as an independent list
 
   init ();                   // Fresh start
 
   while (next)
   {                          // Take the elements of the list
     p = next;                // one by one and insert them
-    next = next->m_next;     // in order
+    next = next->list_next (); // in order
 
     binary_search (data(p), &pos, cmp);
     p->m_children[L] = p->m_children[R] = NULL;
@@ -307,9 +311,9 @@ template<class CMP>
   }
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  void avl_array<T,A,W,P>::sort ()    // Same, but with
+  void avl_array<T,A,W,P,S>::sort ()    // Same, but with
 {                                     // T::operator<
   sort (std::less<value_type>());
 }
@@ -322,10 +326,10 @@ inline
 //
 // Complexity: O(N log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 //not inline
-  void avl_array<T,A,W,P>::stable_sort (CMP cmp)
+  void avl_array<T,A,W,P,S>::stable_sort (CMP cmp)
 {
 #ifdef BOOST_CLASS_REQUIRE
   function_requires<
@@ -341,15 +345,14 @@ template<class CMP>
   if (size()<2)             // specifying std::size_t as P
     return;                 // parameter instead of the
                             // default value (empty_number)
-  node_t::m_prev->m_next = NULL;
-  next = node_t::m_next;
+  next = detach_list ();
 
   init ();                  // Same as sort, but mark every
                             // element with its old index and
   for (i=0; next; i++)      // use this index for comparisons
   {                         // between duplicates while
     p = next;               // searching the insertion point
-    next = next->m_next;
+    next = next->list_next ();
 
     binary_search (data(p), &pos, cmp, i, true);
     p->m_oldpos = i;
@@ -358,13 +361,52 @@ template<class CMP>
   }
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  void avl_array<T,A,W,P>::stable_sort ()  // Same, but with
+  void avl_array<T,A,W,P,S>::stable_sort ()  // Same, but with
 {                                          // T::operator<
   stable_sort (std::less<value_type>());
 }
 
+// sort(cmp,threads): same as sort(cmp), but instead of
+// inserting the nodes one by one in a new tree, gather
+// pointers to them in an array, sort the array with the
+// given number of threads (0 means one per processor, and 1
+// the calling thread alone, as in btree_array_t), and
+// build a new tree with the nodes in that order (see
+// sort_nodes() below). Much faster for big arrays, at the
+// cost of one or two temporary arrays of N pointers. Like
+// with sort(cmp), iterators remain valid, and if cmp throws
+// an exception, the array is left untouched. Note that cmp
+// is copied and called from several threads at a time
+//
+// Complexity: O((N log N)/threads + N log threads)
+
+template<class T,class A,class W,class P,class S>
+template<class CMP>
+inline
+  void avl_array<T,A,W,P,S>::sort
+  (CMP cmp, typename avl_array<T,A,W,P,S>::size_type threads)
+{
+  sort_nodes (cmp, threads, false);
+}
+
+// stable_sort(cmp,threads): same as sort(cmp,threads), but
+// performing a _stable_ sort. Unlike stable_sort(cmp), this
+// doesn't need the P parameter (the order of the array of
+// pointers is enough)
+//
+// Complexity: O((N log N)/threads + N log threads)
+
+template<class T,class A,class W,class P,class S>
+template<class CMP>
+inline
+  void avl_array<T,A,W,P,S>::stable_sort
+  (CMP cmp, typename avl_array<T,A,W,P,S>::size_type threads)
+{
+  sort_nodes (cmp, threads, true);
+}
+
 // merge(): acquire the elements of a donor array
 // (already in order), and merge them with the elements
 // of this array (already in order too). Use a 'lesser
@@ -383,11 +425,11 @@ inline
 // (where N is the number of elements in this array,
 // and M is the number of elements in the donor array)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 //not inline
-  void avl_array<T,A,W,P>::merge
-  (typename avl_array<T,A,W,P>::my_class & donor,
+  void avl_array<T,A,W,P,S>::merge
+  (typename avl_array<T,A,W,P,S>::my_class & donor,
    CMP cmp)
 {
 #ifdef BOOST_CLASS_REQUIRE
@@ -407,17 +449,16 @@ template<class CMP>
   if (size()==0)
   {                                // If *this is empty, just
     acquire_tree (*donor.dummy()); // take the donor's tree,
+    npsv_nodes_from (donor);       // (and its NPSV state)
     donor.init ();                 // leaving the donor empty
     return;
   }
 
   n = size () + donor.size ();     // Total size
 
-  node_t::m_prev->m_next = NULL;
-  my_next = node_t::m_next;        // Detach both trees and
+  my_next = detach_list ();        // Detach both trees and
                                    // use them as independent
-  donor.m_prev->m_next = NULL;     // lists
-  donor_next = donor.m_next;
+  donor_next = donor.detach_list (); // lists
   donor.init ();                   // Leave the donor empty
 
   first = last = NULL;             // Start a new list
@@ -428,30 +469,31 @@ template<class CMP>
             data(my_next)))        // two first elements,
     {
       next = donor_next;
-      donor_next = donor_next->m_next;
+      donor_next = donor_next->list_next ();
     }
     else                           // extract it from its list,
     {
       next = my_next;
-      my_next = my_next->m_next;
+      my_next = my_next->list_next ();
     }
 
     if (first)                     // and append it to end of
-      last = last->m_next = next;  // the new list (well, the
+      last = last->list_next () =  // the new list (well, the
+                            next;
     else                           // first time it is the
       first = last = next;         // beginnig)
   }
                                        // When one list is
-  last->m_next = my_next ? my_next :   // empty, append the
-                           donor_next; // rest of the other
+  last->list_next () = my_next ?       // empty, append the
+             my_next : donor_next;     // rest of the other
 
   build_known_size_tree (n, first);    // Build the tree with
 }                                      // the merged list
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  void avl_array<T,A,W,P>::merge
-  (typename avl_array<T,A,W,P>::my_class & donor)
+  void avl_array<T,A,W,P,S>::merge
+  (typename avl_array<T,A,W,P,S>::my_class & donor)
 {
   merge (donor, std::less<value_type>());    // Same, but with
 }                                            // T::operator<
@@ -471,10 +513,10 @@ inline
 //
 // Complexity: O(N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 //not inline
-  void avl_array<T,A,W,P>::unique (CMP cmp)
+  void avl_array<T,A,W,P,S>::unique (CMP cmp)
 {
 #ifdef BOOST_CLASS_REQUIRE
   function_requires<
@@ -490,35 +532,34 @@ template<class CMP>
   if (n<2)
     return;
 
-  node_t::m_prev->m_next = NULL;     // Detach the whole tree and use
-  first = node_t::m_next;            // it as an independent list
-  dup = NULL;
-
-  for (p=first; p && p->m_next; p=p->m_next)
-    while (p->m_next &&                       // If two
-           !cmp(data(p),data(p->m_next)) &&  // elements
-           !cmp(data(p->m_next),data(p)))   // are equal,
-    {                                      // remove the second
-      q = p->m_next;                      // one and go on with
-      p->m_next = q->m_next;             // the list (note that
-      q->m_next = dup;                  // more duplicates of
-      dup = q;                         // the same value might
-      n --;                           // follow)
-    }
+  first = detach_list ();            // Detach the whole tree and use
+  dup = NULL;                        // it as an independent list
+
+  for (p=first; p && p->list_next (); p=p->list_next ())
+    while (p->list_next () &&                       // If two
+           !cmp(data(p),data(p->list_next ())) &&  // elements
+           !cmp(data(p->list_next ()),data(p)))   // are equal,
+    {                                            // remove the
+      q = p->list_next ();                      // second one and
+      p->list_next () = q->list_next ();       // go on with the
+      q->list_next () = dup;                  // list (note that
+      dup = q;                               // more duplicates
+      n --;                                 // of the same value
+    }                                      // might follow)
 
   build_known_size_tree (n, first);   // Build the tree again
 
   while (dup)             // The tree is ok now
   {
     p = dup;              // Destroy removed nodes
-    dup = dup->m_next;
+    dup = dup->list_next ();
     delete_node (p);
   }
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  void avl_array<T,A,W,P>::unique ()
+  void avl_array<T,A,W,P,S>::unique ()
 {
   unique (std::less<value_type>());    // Same, but with
 }                                      // T::operator<
@@ -550,14 +591,14 @@ inline
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class CMP>
 //not inline
   bool
-  avl_array<T,A,W,P>::binary_search  // Return true iff found
-  (typename avl_array<T,A,W,P>::
+  avl_array<T,A,W,P,S>::binary_search  // Return true iff found
+  (typename avl_array<T,A,W,P,S>::
                  const_reference t,  // What to search
-   typename avl_array<T,A,W,P>::
+   typename avl_array<T,A,W,P,S>::
                       node_t ** pp,  // Where it is / should be
    CMP cmp,                         // Functor for '<' comparisons
    P oldpos,                       // Old position (in stable sort)
@@ -614,7 +655,7 @@ template<class CMP>
     {
       if (!p->m_children[R])
       {
-        *pp = p->m_next;      // Greater: _after_ current node
+        *pp = next (p);       // Greater: _after_ current node
         return false;         // (_before_ the next one)
       }
 
@@ -623,6 +664,101 @@ template<class CMP>
   }
 }
 
+// sort_nodes(): Gather pointers to all the nodes in an array,
+// sort it with parallel_merge_sort() (see parallel_sort.hpp),
+// link the nodes in a list in that order, and build a new
+// tree with them. Nodes are not copied, so iterators remain
+// valid. Slices under min_slice nodes are not worth a thread.
+// If cmp throws, the tree has not been touched yet
+//
+// Complexity: O((N log N)/threads + N log threads)
+
+template<class T,class A,class W,class P,class S>
+template<class CMP>
+//not inline
+  void avl_array<T,A,W,P,S>::sort_nodes
+  (CMP cmp,
+   typename avl_array<T,A,W,P,S>::size_type threads,
+   bool stable)
+{
+#ifdef BOOST_CLASS_REQUIRE
+  function_requires<
+      BinaryFunctionConcept<CMP,int,const_reference,
+                                    const_reference> >();
+#endif
+
+  typedef typename A::template
+          rebind<node_t*>::other ptr_allocator_t;
+
+  enum { min_slice = 16384 };
+
+  ptr_allocator_t ptr_allocator;
+  node_t ** nodes, ** scratch, ** sorted, ** out, * p;
+  size_type n, i;
+
+  n = size ();
+
+  if (n<2)
+    return;
+
+#if __cplusplus >= 201103L
+  threads = parallel_detail::thread_count (threads);
+#else
+  threads = 1;                       // No threads in C++03
+#endif
+
+  if (threads>n/min_slice)
+    threads = n/min_slice;
+
+  nodes = ptr_allocator.allocate (n);
+
+  if (nodes==NULL)
+    throw allocator_returned_null();
+
+  scratch = NULL;
+
+  try
+  {
+    if (threads>1)                   // Merges need room
+    {
+      scratch = ptr_allocator.allocate (n);
+
+      if (scratch==NULL)
+        throw allocator_returned_null();
+    }
+
+    out = nodes;                     // Take the nodes in their
+                                     // current order
+    for (p=next(dummy()); p!=dummy(); p=next(p))
+      *out++ = p;
+
+    sorted = parallel_merge_sort
+                 (nodes, scratch, n,
+                  node_data_less<my_class,CMP> (cmp),
+                  threads, stable);
+  }
+  catch (...)
+  {
+    if (scratch)
+      ptr_allocator.deallocate (scratch, n);
+
+    ptr_allocator.deallocate (nodes, n);
+    throw;
+  }
+
+  for (i=0; i+1<n; i++)              // Link them in the new
+    sorted[i]->list_next () =        // order, and rebuild
+                   sorted[i+1];      // the tree
+  sorted[n-1]->list_next () = NULL;
+
+  build_known_size_tree (n, sorted[0]);
+
+  if (scratch)
+    ptr_allocator.deallocate (scratch, n);
+
+  ptr_allocator.deallocate (nodes, n);
+}
+
 //////////////////////////////////////////////////////////////////
 
 }  // namespace mkr
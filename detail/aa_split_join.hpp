@@ -0,0 +1,392 @@
+///////////////////////////////////////////////////////////////////
+//                                                               //
+//  Copyright (c) 2006, Universidad de Alcala                    //
+//                                                               //
+//  See accompanying LICENSE.TXT                                 //
+//                                                               //
+///////////////////////////////////////////////////////////////////
+
+/*
+  detail/aa_split_join.hpp
+  ------------------------
+
+  Methods for cutting an avl_array in two, and for concatenating
+  two of them. Like move operations, they don't touch the T
+  objects, they just change the links of tree nodes, so all
+  iterators remain valid (they just change their container).
+
+  split(it): move [it,end) to a new avl_array (O(log N))
+  split(it,cont): idem, to another avl_array (O(log N))
+  join(cont): append another avl_array (O(log(M)+log(N)))
+
+  Private helper methods:
+
+  split_tree(): cut a tree in two before a node (O(log N))
+  join_trees(): concatenate two trees (O(log N))
+  plant_tree(): hang a subtree from a dummy node (O(1))
+  make_dummy(): init. a temporary dummy node (O(1))
+  mirror_tree(): swap children in a subtree (O(N))
+
+  The helpers work with trees hanging from dummy nodes (the one
+  of an avl_array, or a temporary one), but they don't touch the
+  m_next/m_prev list: with threads, the caller must fix it at the
+  cut points.
+*/
+
+#ifndef _AVL_ARRAY_SPLIT_JOIN_HPP_
+#define _AVL_ARRAY_SPLIT_JOIN_HPP_
+
+#ifndef _AVL_ARRAY_HPP_
+#error "Don't include this file. Include avl_array.hpp instead."
+#endif
+
+namespace mkr  // Public namespace
+{
+
+//////////////////////////////////////////////////////////////////
+
+// ---------------------- PUBLIC INTERFACE -----------------------
+
+// split(): move the elements [it,end()) to a new avl_array,
+// and return it. With C++11 the result is moved out in O(1);
+// otherwise copies of it are usually elided by the compiler.
+// split(it,dst) never copies anything
+//
+// Complexity: O(log N)
+
+template<class T,class A,class W,class P,class S>
+inline
+  typename avl_array<T,A,W,P,S>::my_class
+  avl_array<T,A,W,P,S>::split
+  (typename avl_array<T,A,W,P,S>::iterator it)
+{
+  my_class dst;
+
+  split (it, dst);
+  return dst;
+}
+
+// split(): move the elements [it,end()) to another avl_array.
+// The previous contents of dst are erased
+//
+// Complexity: O(log N), plus the clear() of dst
+
+template<class T,class A,class W,class P,class S>
+//not inline
+  void
+  avl_array<T,A,W,P,S>::split
+  (typename avl_array<T,A,W,P,S>::iterator it,
+   typename avl_array<T,A,W,P,S>::my_class & dst)
+{
+  node_t * first, * last, * before;
+
+  AA_ASSERT_HO (owner(it.ptr)==this);
+  AA_ASSERT (&dst!=this);
+
+  dst.clear ();
+
+  if (it.ptr==dummy ())   // Split at end: nothing to move
+    return;
+
+  first = it.ptr;
+  last = before = NULL;
+
+  if (S::threaded)                    // Ends of the list
+  {                                   // parts
+    last = threads_t::prev (dummy ());
+    before = threads_t::prev (first);
+  }
+
+  split_tree (dummy (), first, dst.dummy ());
+
+  if (S::threaded)
+  {
+    threads_t::link (before, dummy ());       // Cut the
+    threads_t::link (dst.dummy (), first);    // circular
+    threads_t::link (last, dst.dummy ());     // list too
+  }
+
+  dst.npsv_nodes_from (*this);
+}
+
+// join(): append all the elements of src at the end of this
+// avl_array, leaving src empty
+//
+// Complexity: O(log(M)+log(N))
+
+template<class T,class A,class W,class P,class S>
+//not inline
+  void
+  avl_array<T,A,W,P,S>::join
+  (typename avl_array<T,A,W,P,S>::my_class & src)
+{
+  node_t * last, * first, * src_last;
+
+  AA_ASSERT (&src!=this);
+
+  if (src.empty ())
+    return;
+
+  last = first = src_last = NULL;
+
+  if (S::threaded)                     // Ends of the lists
+  {
+    last = threads_t::prev (dummy ());
+    first = threads_t::next (src.dummy ());
+    src_last = threads_t::prev (src.dummy ());
+  }
+
+  join_trees (dummy (), NULL, src.dummy ());
+
+  if (S::threaded)
+  {
+    threads_t::link (last, first);              // Join the
+    threads_t::link (src_last, dummy ());       // circular
+    threads_t::link (src.dummy (), src.dummy ());  // lists
+  }
+
+  npsv_nodes_from (src);
+  src.m_sums_out_of_date = false;
+}
+
+// ------------------- PRIVATE HELPER METHODS --------------------
+
+// split_tree(): Cut the tree of the dummy node d before the
+// node x. The nodes from x on are moved to the (empty) tree
+// of the dummy node dr. Climbing from x to the root, every
+// ancestor is joined, with its subtree on the other side, to
+// the left or to the right part. The cost of every join is
+// the height difference of its trees, and these differences
+// add up to the height of the tree
+//
+// Complexity: O(log N)
+
+template<class T,class A,class W,class P,class S>
+//not inline static
+  void
+  avl_array<T,A,W,P,S>::split_tree
+  (typename avl_array<T,A,W,P,S>::node_t * d,
+   typename avl_array<T,A,W,P,S>::node_t * x,
+   typename avl_array<T,A,W,P,S>::node_t * dr)
+{
+  node_t left, right, tmp;  // Temporary trees
+  node_t * p, * c, * up;
+
+  AA_ASSERT (!dr->m_children[L]);   // dr must be empty
+
+  if (x==d)                 // Cut at the end: the right
+    return;                 // part is empty
+
+  make_dummy (&left);
+  make_dummy (&right);
+  make_dummy (&tmp);
+
+  p = x->m_parent;
+                                        // Left: x's left
+  plant_tree (&left, x->m_children[L]); // subtree. Right:
+  plant_tree (&tmp, x->m_children[R]);  // x and its right
+  join_trees (&right, x, &tmp);         // subtree
+
+  for (c=x; p!=d; c=p, p=up)   // Climb up to the root
+  {
+    up = p->m_parent;
+
+    if (p->m_children[R]==c)   // Coming from the right: p
+    {                          // and its left subtree go
+      plant_tree (&tmp, p->m_children[L]);  // before the
+      join_trees (&tmp, p, &left);          // left part
+      plant_tree (&left, tmp.m_children[L]);
+    }
+    else                       // Coming from the left: p
+    {                          // and its right subtree go
+      plant_tree (&tmp, p->m_children[R]);  // after the
+      join_trees (&right, p, &tmp);         // right part
+    }
+  }
+
+  plant_tree (d, left.m_children[L]);   // Give the parts
+  plant_tree (dr, right.m_children[L]); // to their owners
+}
+
+// join_trees(): Append the tree of the dummy node dr to the
+// tree of the dummy node dl, with the node m in between, and
+// leave dr empty. If m is NULL, the first node of dr is used.
+// The root of the shorter tree and m are hung from the
+// border of the taller one, at the same height, and the path
+// from there to the root is rebalanced
+//
+// Complexity: O(log N) (O(1+|height difference|) with m)
+
+template<class T,class A,class W,class P,class S>
+//not inline static
+  void
+  avl_array<T,A,W,P,S>::join_trees
+  (typename avl_array<T,A,W,P,S>::node_t * dl,
+   typename avl_array<T,A,W,P,S>::node_t * m,
+   typename avl_array<T,A,W,P,S>::node_t * dr)
+{
+  node_t * l, * r, * c, * up;
+  size_type hl, hr;
+  int side;
+
+  if (!m)                          // No pivot node given:
+  {                                // take the first one of
+    m = dr->m_children[L];         // dr
+                                   // (nothing to join if dr
+    if (!m)                        // is empty)
+      return;
+
+    while (m->m_children[L])
+      m = m->m_children[L];
+
+    up = m->m_parent;                       // Bypass it, and
+    up->m_children[L] = m->m_children[R];   // rebalance its
+                                            // old branch
+    if (m->m_children[R])
+      m->m_children[R]->m_parent = up;
+
+    update_counters_and_rebalance (up);
+  }
+
+  l = dl->m_children[L];
+  r = dr->m_children[L];
+  hl = dl->left_height ();
+  hr = dr->left_height ();
+
+  plant_tree (dr, NULL);
+
+  up = dl;
+  side = L;
+
+  if (hl>=hr)             // Descend the right border of the
+  {                       // left tree until the height of
+    c = l;                // the right one (or one more)
+
+    while (c && c->m_height>hr+1)
+    {
+      up = c;
+      side = R;
+      c = c->m_children[R];
+    }
+
+    m->m_children[L] = c;
+    m->m_children[R] = r;
+  }
+  else                    // Or the left border of the right
+  {                       // tree until the height of the
+    c = r;                // left one (or one more)
+
+    while (c && c->m_height>hl+1)
+      c = (up=c)->m_children[L];
+
+    m->m_children[L] = l;
+    m->m_children[R] = c;
+
+    if (up!=dl)                  // The right tree's root is
+    {                            // the new root
+      dl->m_children[L] = r;
+      r->m_parent = dl;
+    }
+  }
+
+  if (m->m_children[L])
+    m->m_children[L]->m_parent = m;
+
+  if (m->m_children[R])
+    m->m_children[R]->m_parent = m;
+
+  m->m_parent = up;                // Hang m (with its new
+  up->m_children[side] = m;        // subtrees) there, and
+                                   // climb to the root
+  update_counters_and_rebalance (m);
+}
+
+// plant_tree(): Make a subtree (maybe empty) the tree of a
+// dummy node, and update the counters of the dummy node
+//
+// Complexity: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline //static
+  void
+  avl_array<T,A,W,P,S>::plant_tree
+  (typename avl_array<T,A,W,P,S>::node_t * d,
+   typename avl_array<T,A,W,P,S>::node_t * root)
+{
+  d->m_children[L] = root;
+
+  if (root)
+    root->m_parent = d;
+
+  update_counters (d);  // (d has no parent: O(1))
+}
+
+// make_dummy(): Initialize a temporary dummy node, the owner
+// of an empty tree, like the one of an empty avl_array
+//
+// Complexity: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline //static
+  void
+  avl_array<T,A,W,P,S>::make_dummy
+  (typename avl_array<T,A,W,P,S>::node_t * d)
+{
+  d->init ();
+  d->m_node_width = d->m_total_width = monoid_traits<W>::identity ();
+}
+
+// mirror_tree(): Swap the children links of every node of
+// the subtree whose root is p, inverting its sequence. The
+// nodes are visited in post-order (a node is done after its
+// subtrees, so the way up is intact). The m_next/m_prev list
+// is not touched
+//
+// Complexity: O(N)
+
+template<class T,class A,class W,class P,class S>
+//not inline static
+  void
+  avl_array<T,A,W,P,S>::mirror_tree
+  (typename avl_array<T,A,W,P,S>::node_t * p)
+{
+  node_t * root, * q, * tmp;
+  bool left;
+
+  root = p;
+
+  while (p)
+  {
+    while (p->m_children[L] || p->m_children[R])
+      p = p->m_children[L] ? p->m_children[L] :
+                             p->m_children[R];
+    for (;;)
+    {
+      q = p->m_parent;
+      left = q->m_children[L]==p;
+
+      tmp = p->m_children[L];              // Swap left and
+      p->m_children[L] = p->m_children[R]; // right children
+      p->m_children[R] = tmp;              // links
+
+      if (p==root)        // Done with the root?
+      {
+        p = NULL;
+        break;
+      }
+
+      p = q;                        // Step up, and go down
+      if (left && q->m_children[R]) // into the right subtree
+      {                             // if we come from the
+        p = q->m_children[R];       // left one
+        break;
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+
+}  // namespace mkr
+
+#endif
@@ -0,0 +1,525 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Nodes taken in order from a block reserved up front, then from the heap
+// one by one once the block runs out. Freed block nodes are kept on a
+// free list and handed out again
+
+template<typename Node>
+class btree_block_t
+{
+private:
+	static_assert(sizeof(Node) >= sizeof(Node *), "Node must be able to hold a free list link");
+
+	std::unique_ptr<Node[]> nodes_;
+	std::size_t size_;
+	std::size_t used_;
+	Node * free_;
+
+public:
+	btree_block_t()
+	:
+		size_{0},
+		used_{0},
+		free_{nullptr}
+	{}
+
+	void reserve(std::size_t size)
+	{
+		assert(used_ == 0);
+		nodes_.reset(new Node[size]);
+		size_ = size;
+	}
+
+	Node * allocate()
+	{
+		if (free_ != nullptr)
+		{
+			auto node = free_;
+			std::memcpy(&free_, node, sizeof(free_));
+			return node;
+		}
+
+		if (used_ != size_) return &nodes_[used_++];
+		return new Node;
+	}
+
+	void deallocate(Node * node)
+	{
+		std::less<Node const *> less;
+		if (less(node, nodes_.get()) || !less(node, nodes_.get() + size_))
+		{
+			delete node;
+			return;
+		}
+
+		std::memcpy(static_cast<void *>(node), &free_, sizeof(free_));
+		free_ = node;
+	}
+};
+
+template<typename Branch, typename Leaf>
+class btree_heap_storage_t
+{
+private:
+	btree_block_t<Branch> branches_;
+	btree_block_t<Leaf> leaves_;
+
+public:
+	typedef void * link_t;
+
+	void reserve(std::size_t branches, std::size_t leaves) { branches_.reserve(branches); leaves_.reserve(leaves); }
+	link_t make_branch() { return branches_.allocate(); }
+	link_t make_leaf() { return leaves_.allocate(); }
+	void free_branch(link_t link) { branches_.deallocate(branch(link)); }
+	void free_leaf(link_t link) { leaves_.deallocate(leaf(link)); }
+	Branch * branch(link_t link) const { return static_cast<Branch *>(link); }
+	Leaf * leaf(link_t link) const { return static_cast<Leaf *>(link); }
+};
+
+// Nodes carved out of large chunks that never move, linked by a 32-bit
+// index. Index 0 is never handed out so that it can mean null
+
+template<typename Node>
+class btree_arena_t
+{
+private:
+	static std::size_t constexpr chunk_bits = 12;
+	static std::size_t constexpr chunk_size = std::size_t{1} << chunk_bits;
+
+	static_assert(sizeof(Node) >= sizeof(std::uint32_t), "Node must be able to hold a free list link");
+
+	std::vector<std::unique_ptr<Node[]>> chunks_;
+	std::uint32_t next_;
+	std::uint32_t free_;
+
+public:
+	btree_arena_t()
+	:
+		next_{1},
+		free_{0}
+	{}
+
+	std::uint32_t allocate()
+	{
+		if (free_ != 0)
+		{
+			auto index = free_;
+			std::memcpy(&free_, get(index), sizeof(free_));
+			return index;
+		}
+
+		assert(next_ != std::numeric_limits<std::uint32_t>::max());
+		if ((next_ >> chunk_bits) == chunks_.size()) chunks_.emplace_back(new Node[chunk_size]);
+		return next_++;
+	}
+
+	void deallocate(std::uint32_t index)
+	{
+		std::memcpy(get(index), &free_, sizeof(free_));
+		free_ = index;
+	}
+
+	Node * get(std::uint32_t index) const
+	{
+		return chunks_[index >> chunk_bits].get() + (index & (chunk_size - 1));
+	}
+};
+
+template<typename Branch, typename Leaf>
+class btree_arena_storage_t
+{
+private:
+	btree_arena_t<Branch> branches_;
+	btree_arena_t<Leaf> leaves_;
+
+public:
+	typedef std::uint32_t link_t;
+
+	// A fresh arena hands out nodes in order anyway
+	void reserve(std::size_t branches, std::size_t leaves) {}
+	link_t make_branch() { return branches_.allocate(); }
+	link_t make_leaf() { return leaves_.allocate(); }
+	void free_branch(link_t link) { branches_.deallocate(link); }
+	void free_leaf(link_t link) { leaves_.deallocate(link); }
+	Branch * branch(link_t link) const { return branches_.get(link); }
+	Leaf * leaf(link_t link) const { return leaves_.get(link); }
+};
+
+// The branch levels shared by the btree containers. A container supplies
+// a policy with its node, branch and leaf types and its storage, derives
+// from tree_t and keeps only the code that deals with its leaves
+
+namespace btree_detail
+{
+
+// Compute the logarithm rounded up to the nearest int
+
+inline std::size_t constexpr log(std::size_t num, std::size_t base, std::size_t result)
+{
+	return num != 0 ? log(num / base, base, result + 1) : result;
+}
+
+inline std::size_t constexpr log(std::size_t num, std::size_t base)
+{
+	return log(num - 1, base, 0);
+}
+
+// Number of children whose sizes add up to size
+
+template<typename Node>
+std::size_t get_length(Node const * children, std::size_t size)
+{
+	std::size_t index = 0;
+	while (size != 0)
+	{
+		size -= children[index].size;
+		++index;
+	}
+	return index;
+}
+
+template<typename Size, typename Link>
+struct basic_node_t
+{
+	typedef Link link_t;
+
+	Size size;
+	Link pointer;
+};
+
+template<typename Node, std::size_t length>
+struct basic_branch_t
+{
+	Node children[length];
+};
+
+// A policy provides node_t, branch_t, leaf_t, storage_t, stack_size and
+// maximum_branch_size, and the hooks below. It derives from this and
+// hides the hooks it needs to change, make_node and sum go together:
+//
+// make_node(size, pointer): a link to a subtree of size elements
+// add(node, delta): count delta, the summary of what was added below node
+// sum(nodes, length, pointer): a link summarizing the given children
+// adopt(storage, node, height, parent): node at height now has parent
+// descend(storage, node, height): called on every link a seek passes
+// length(branch, size): number of children of a branch of size elements
+
+template<typename Node>
+struct basic_policy_t
+{
+	typedef typename Node::link_t link_t;
+
+	static Node make_node(std::size_t size, link_t pointer)
+	{
+		Node node;
+		node.size = size;
+		node.pointer = pointer;
+		return node;
+	}
+
+	static void add(Node & node, Node const & delta)
+	{
+		node.size += delta.size;
+	}
+
+	static Node sum(Node const * nodes, std::size_t length, link_t pointer)
+	{
+		std::size_t size = 0;
+		for (std::size_t I = 0; I != length; ++I) size += nodes[I].size;
+		return make_node(size, pointer);
+	}
+
+	template<typename Storage, typename Branch>
+	static void adopt(Storage & storage, Node const & node, std::size_t height, Branch * parent) {}
+
+	template<typename Storage>
+	static void descend(Storage const & storage, Node & node, std::size_t height) {}
+
+	template<typename Branch>
+	static std::size_t length(Branch const * branch, std::size_t size)
+	{
+		return get_length(branch->children, size);
+	}
+};
+
+template<typename Policy>
+class tree_t
+{
+protected:
+	typedef typename Policy::node_t node_t;
+	typedef typename Policy::branch_t branch_t;
+	typedef typename Policy::leaf_t leaf_t;
+	typedef typename Policy::storage_t storage_t;
+	typedef typename storage_t::link_t link_t;
+
+	static std::size_t constexpr maximum_branch_size = Policy::maximum_branch_size;
+	static std::size_t constexpr stack_size = Policy::stack_size;
+
+	static_assert(maximum_branch_size >= 3, "maximum_branch_size must be at least 3");
+
+	struct branch_entry_t
+	{
+		std::size_t size;
+		std::size_t index;
+		branch_t * pointer;
+	};
+
+	struct leaf_entry_t
+	{
+		std::size_t size;
+		std::size_t index;
+		leaf_t * pointer;
+	};
+
+	storage_t storage_;
+	node_t root_;
+	std::size_t height_;
+
+	tree_t()
+	:
+		root_(Policy::make_node(0, link_t())),
+		height_{0}
+	{}
+
+	tree_t(tree_t const &) = delete;
+	tree_t & operator=(tree_t const &) = delete;
+
+	static node_t make_node(std::size_t size, link_t pointer)
+	{
+		return Policy::make_node(size, pointer);
+	}
+
+	static std::size_t get_length(branch_t const * branch, std::size_t size)
+	{
+		return Policy::length(branch, size);
+	}
+
+	template<typename Kind>
+	static void merge(
+		std::size_t index,
+		Kind * orig, std::size_t orig_size,
+		Kind value)
+	{
+		std::char_traits<Kind>::move(
+			orig + index + 1,
+			orig + index,
+			orig_size - index);
+		orig[index] = value;
+	}
+
+	template<typename Kind>
+	static void split(
+		std::size_t index,
+		std::size_t left_size, std::size_t right_size, Kind * right,
+		Kind * orig, std::size_t orig_size,
+		Kind value)
+	{
+		if (index < left_size)
+		{
+			std::char_traits<Kind>::copy(
+				right,
+				orig + orig_size - right_size,
+				right_size);
+			std::char_traits<Kind>::move(
+				orig + index + 1,
+				orig + index,
+				left_size - 1 - index);
+			orig[index] = value;
+		}
+		else
+		{
+			std::char_traits<Kind>::copy(
+				right,
+				orig + left_size,
+				index - left_size);
+			std::char_traits<Kind>::copy(
+				right + index + 1 - left_size,
+				orig + index,
+				orig_size - index);
+			right[index - left_size] = value;
+		}
+	}
+
+	void delete_node(node_t node, std::size_t height)
+	{
+		if (height != 0)
+		{
+			auto branch = storage_.branch(node.pointer);
+			auto length = get_length(branch, node.size);
+			for (std::size_t index = 0; index != length; ++index)
+			{
+				delete_node(branch->children[index], height - 1);
+			}
+
+			storage_.free_branch(node.pointer);
+		}
+		else
+		{
+			storage_.free_leaf(node.pointer);
+		}
+	}
+
+	// Walk down to the leaf holding index and record the path in [first,
+	// last), the parent of the leaf first. An index on the boundary of two
+	// children goes to the left one, so index == size() reaches the end of
+	// the last leaf, unless strict is set
+
+	leaf_entry_t seek(branch_entry_t * first, branch_entry_t * last, std::size_t index, bool strict = false)
+	{
+		auto current = &root_;
+		auto height = height_;
+		while (first != last)
+		{
+			Policy::descend(storage_, *current, height--);
+			auto branch = storage_.branch(current->pointer);
+
+			std::size_t branch_index = 0;
+			while (true)
+			{
+				std::size_t child_size = branch->children[branch_index].size;
+				if (strict ? index < child_size : index <= child_size) break;
+				index -= child_size;
+				++branch_index;
+			}
+			branch_entry_t entry;
+			entry.size = current->size;
+			entry.index = branch_index;
+			entry.pointer = branch;
+			*--last = entry;
+			current = &branch->children[branch_index];
+		}
+
+		Policy::descend(storage_, *current, 0);
+		leaf_entry_t entry;
+		entry.size = current->size;
+		entry.index = index;
+		entry.pointer = storage_.leaf(current->pointer);
+		return entry;
+	}
+
+	// The leaf holding the element at index, for readers
+
+	leaf_entry_t locate(std::size_t index) const
+	{
+		auto node = root_;
+		for (auto height = height_; height != 0; --height)
+		{
+			auto branch = storage_.branch(node.pointer);
+			std::size_t branch_index = 0;
+			while (index >= branch->children[branch_index].size)
+			{
+				index -= branch->children[branch_index].size;
+				++branch_index;
+			}
+			node = branch->children[branch_index];
+		}
+
+		leaf_entry_t entry;
+		entry.size = node.size;
+		entry.index = index;
+		entry.pointer = storage_.leaf(node.pointer);
+		return entry;
+	}
+
+	void update_sizes(branch_entry_t * first, branch_entry_t * last, node_t const & delta)
+	{
+		while (first != last)
+		{
+			auto & entry = *first++;
+			Policy::add(entry.pointer->children[entry.index], delta);
+		}
+
+		Policy::add(root_, delta);
+	}
+
+	// Link right_node after the child on the path at the bottom of [first,
+	// last), whose subtree is now summarized by left_node, the link itself
+	// is kept. A full branch is split and its new right half linked into
+	// the parent the same way, up to the root, which grows a level when it
+	// is split. delta is what the rest of the path gains, the summary of
+	// what the caller added below that is not counted in the path yet
+
+	void insert_sibling(
+		branch_entry_t * first, branch_entry_t * last,
+		node_t left_node, node_t right_node, node_t const & delta)
+	{
+		std::size_t height = 0;
+		while (first != last)
+		{
+			auto & entry = *first++;
+			auto children = entry.pointer->children;
+			auto branch_length = get_length(entry.pointer, entry.size);
+			auto sum = branch_length + 1;
+			left_node.pointer = children[entry.index].pointer;
+			children[entry.index] = left_node;
+
+			// If we have room for the child we are done
+			if (sum <= maximum_branch_size)
+			{
+				merge(entry.index + 1, children, branch_length, right_node);
+				Policy::adopt(storage_, right_node, height, entry.pointer);
+				update_sizes(first, last, delta);
+				return;
+			}
+
+			// No room, split into 2 and insert the first half in the parent
+			auto left_length = sum / 2;
+			auto right_length = sum - left_length;
+			auto link = storage_.make_branch();
+			auto right = storage_.branch(link);
+			split(
+				entry.index + 1,
+				left_length, right_length, right->children,
+				children, branch_length,
+				right_node);
+			Policy::adopt(storage_, right_node, height, entry.pointer);
+			for (std::size_t I = 0; I != right_length; ++I) Policy::adopt(storage_, right->children[I], height, right);
+			left_node = Policy::sum(children, left_length, link_t());
+			right_node = Policy::sum(right->children, right_length, link);
+			++height;
+		}
+
+		// We have reached the root, grow upward
+		auto link = storage_.make_branch();
+		auto branch = storage_.branch(link);
+		left_node.pointer = root_.pointer;
+		branch->children[0] = left_node;
+		branch->children[1] = right_node;
+		Policy::adopt(storage_, left_node, height, branch);
+		Policy::adopt(storage_, right_node, height, branch);
+		root_ = Policy::sum(branch->children, 2, link);
+		Policy::adopt(storage_, root_, height + 1, static_cast<branch_t *>(nullptr));
+		height_++;
+	}
+
+	// Call visit(leaf, size) for every leaf of a subtree in order
+
+	template<typename Visit>
+	void visit_leaves(node_t node, std::size_t height, Visit & visit) const
+	{
+		if (height != 0)
+		{
+			auto branch = storage_.branch(node.pointer);
+			auto length = get_length(branch, node.size);
+			for (std::size_t index = 0; index != length; ++index)
+			{
+				visit_leaves(branch->children[index], height - 1, visit);
+			}
+		}
+		else
+		{
+			visit(storage_.leaf(node.pointer), std::size_t{node.size});
+		}
+	}
+};
+
+}
@@ -23,6 +23,11 @@
     iter_data_provider        (use an avl_array or other container)
     range_data_provider       (same as iter_, but stop at "to")
     copy_data_provider        (use allways the same prototype)
+    move_data_provider        (same as range_, but move them)
+
+  The trait nothrow_provided<DP,T> tells whether the T objects
+  can be made from what a data provider gives without throwing
+  exceptions (only known with C++11).
 */
 
 #ifndef _AVL_ARRAY_DATA_PROVIDER_HPP_
@@ -119,6 +124,89 @@ class copy_data_provider     // collections of copies of a given
     Ptr operator() () { return p; }    // Always the same
 };
 
+//////////////////////////////////////////////////////////////////
+
+#if __cplusplus >= 201103L
+
+template<class Ptr, class IT> // Function object used for moving
+class move_data_provider      // the objects of a range (as
+{                             // range_data_provider, but
+  private:                    // avl_array::new_node() will move
+                              // from the objects instead of
+    IT it;                    // copying them; IT must not be a
+    IT end;                   // const iterator)
+
+  public:
+
+    move_data_provider (const IT & from,
+                        const IT & to) : it(from), end(to) {}
+
+    Ptr operator() ()
+    {
+      if (it==end)
+        return NULL;
+
+      Ptr p=&*it;      // Return current element and advance
+      ++ it;
+      return p;
+    }
+};
+
+#endif
+
+//////////////////////////////////////////////////////////////////
+
+// nothrow_provided: true if constructing T objects with the
+// data provider DP can't throw: default constructor for
+// null_data_provider, move constructor for move_data_provider,
+// and copy constructor for the rest. Exceptions of the
+// provider itself (i.e. of its iterators) are not considered
+
+template<class DP, class T>
+struct nothrow_provided
+{
+  static const bool value = false;
+};
+
+#if __cplusplus >= 201103L
+
+template<class Ptr, class T>
+struct nothrow_provided<null_data_provider<Ptr>,T>
+{
+  static const bool value =
+                  std::is_nothrow_default_constructible<T>::value;
+};
+
+template<class Ptr, class IT, class T>
+struct nothrow_provided<iter_data_provider<Ptr,IT>,T>
+{
+  static const bool value =
+                  std::is_nothrow_copy_constructible<T>::value;
+};
+
+template<class Ptr, class IT, class T>
+struct nothrow_provided<range_data_provider<Ptr,IT>,T>
+{
+  static const bool value =
+                  std::is_nothrow_copy_constructible<T>::value;
+};
+
+template<class Ptr, class T>
+struct nothrow_provided<copy_data_provider<Ptr>,T>
+{
+  static const bool value =
+                  std::is_nothrow_copy_constructible<T>::value;
+};
+
+template<class Ptr, class IT, class T>
+struct nothrow_provided<move_data_provider<Ptr,IT>,T>
+{
+  static const bool value =
+                  std::is_nothrow_move_constructible<T>::value;
+};
+
+#endif
+
 //////////////////////////////////////////////////////////////////
 
   }  // namespace detail
@@ -0,0 +1,207 @@
+///////////////////////////////////////////////////////////////////
+//                                                               //
+//  Copyright (c) 2006, Universidad de Alcala                    //
+//                                                               //
+//  See accompanying LICENSE.TXT                                 //
+//                                                               //
+///////////////////////////////////////////////////////////////////
+
+/*
+  detail/dirty_list.hpp
+  ---------------------
+
+  Growable array of pointers to the nodes whose NPSV width was
+  changed in lazy mode (see npsv_set_width()). Only the paths
+  from these nodes to the root have wrong width sums, so
+  npsv_update_sums() can fix them in O(k log N) instead of
+  traversing the whole tree. When the list would grow beyond a
+  given limit (or its memory can't be allocated), push_back()
+  fails, and the avl_array falls back to the full update.
+*/
+
+#ifndef _AVL_ARRAY_DIRTY_LIST_HPP_
+#define _AVL_ARRAY_DIRTY_LIST_HPP_
+
+#ifndef _AVL_ARRAY_HPP_
+#error "Don't include this file. Include avl_array.hpp instead."
+#endif
+
+namespace mkr  // Public namespace
+{
+
+  namespace detail  // Private nested namespace mkr::detail
+  {
+
+//////////////////////////////////////////////////////////////////
+
+template<class T, class A,
+         class W, class P,            // Nodes with out of date
+         class S>                     // NPSV width sums in their
+class dirty_list                      // path to the root
+{
+  friend class mkr::avl_array<T,A,W,P,S>;
+
+  typedef avl_array_node_tree_fields<T,A,W,P,S> node_t;
+  typedef typename A::template
+          rebind<node_t*>::other ptr_allocator_t;
+
+  private:
+
+    enum { first_room = 16 };   // Size of the first allocation
+
+    node_t ** m_nodes;          // The pointers (NULL if no room)
+    std::size_t m_count;        // Pointers in use
+    std::size_t m_room;         // Pointers allocated
+
+    dirty_list ();              // Empty, without memory: O(1)
+    ~dirty_list ();             // Free the memory: O(1)
+
+    dirty_list (const dirty_list<T,A,W,P,S> &);  // Not copyable
+    dirty_list<T,A,W,P,S> & operator=            // (not defined)
+      (const dirty_list<T,A,W,P,S> &);
+
+    bool empty () const;                    // No nodes? O(1)
+    std::size_t size () const;              // How many? O(1)
+    node_t * operator[] (std::size_t i) const;  // i-th: O(1)
+
+    bool push_back (node_t * p,             // Add a node, if there
+                    std::size_t limit);     // are less than limit
+                                            // O(1) (amortized)
+    void clear ();                          // Forget all: O(1)
+    void release ();                        // And free: O(1)
+    void swap (dirty_list<T,A,W,P,S> & l);  // Exchange: O(1)
+};
+
+//////////////////////////////////////////////////////////////////
+
+// Constructor: start empty, and don't allocate anything until
+// the first push_back()
+
+template<class T,class A,class W,class P,class S>
+inline dirty_list<T,A,W,P,S>::dirty_list ()
+   : m_nodes(NULL),
+     m_count(0),
+     m_room(0)
+{}
+
+// Destructor: free the array of pointers (if any)
+
+template<class T,class A,class W,class P,class S>
+inline dirty_list<T,A,W,P,S>::~dirty_list ()
+{
+  release ();
+}
+
+// empty(), size(), operator[](): read access to the list
+
+template<class T,class A,class W,class P,class S>
+inline bool dirty_list<T,A,W,P,S>::empty () const
+{
+  return !m_count;
+}
+
+template<class T,class A,class W,class P,class S>
+inline std::size_t dirty_list<T,A,W,P,S>::size () const
+{
+  return m_count;
+}
+
+template<class T,class A,class W,class P,class S>
+inline typename dirty_list<T,A,W,P,S>::node_t *
+  dirty_list<T,A,W,P,S>::operator[] (std::size_t i) const
+{
+  AA_ASSERT (i<m_count);
+  return m_nodes[i];
+}
+
+// push_back(): append a node, doubling the room if required.
+// Return false, leaving the list unchanged, if it already has
+// limit nodes, or if the allocation fails (the caller will
+// then forget the list and update all width sums). Time
+// required: O(1) (amortized)
+
+template<class T,class A,class W,class P,class S>
+//not inline
+  bool
+  dirty_list<T,A,W,P,S>::push_back
+  (node_t * p, std::size_t limit)
+{
+  ptr_allocator_t ptr_allocator;
+  node_t ** nodes;
+  std::size_t room;
+
+  if (m_count>=limit)         // Too many nodes: a full update
+    return false;             // would be faster
+
+  if (m_count==m_room)        // No room left: grow
+  {
+    room = m_room ? 2*m_room : std::size_t(first_room);
+
+    try
+    {
+      nodes = ptr_allocator.allocate (room);
+    }
+    catch (...)
+    {
+      return false;
+    }
+
+    if (!nodes)
+      return false;
+
+    std::copy (m_nodes, m_nodes+m_count, nodes);
+
+    if (m_nodes)
+      ptr_allocator.deallocate (m_nodes, m_room);
+
+    m_nodes = nodes;
+    m_room = room;
+  }
+
+  m_nodes[m_count++] = p;
+  return true;
+}
+
+// clear(): forget all the nodes, but keep the memory for the
+// next ones. Time required: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline void dirty_list<T,A,W,P,S>::clear ()
+{
+  m_count = 0;
+}
+
+// release(): forget all the nodes and free the memory. Time
+// required: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline void dirty_list<T,A,W,P,S>::release ()
+{
+  ptr_allocator_t ptr_allocator;
+
+  if (m_nodes)
+    ptr_allocator.deallocate (m_nodes, m_room);
+
+  m_nodes = NULL;
+  m_count = m_room = 0;
+}
+
+// swap(): exchange the contents of two lists (together with
+// the trees of their avl_arrays). Time required: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline void
+  dirty_list<T,A,W,P,S>::swap (dirty_list<T,A,W,P,S> & l)
+{
+  std::swap (m_nodes, l.m_nodes);
+  std::swap (m_count, l.m_count);
+  std::swap (m_room, l.m_room);
+}
+
+//////////////////////////////////////////////////////////////////
+
+  }  // namespace detail
+
+}  // namespace mkr
+
+#endif
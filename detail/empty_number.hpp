@@ -12,7 +12,8 @@
 
   Class intended to be used as default parameter when features
   like NPSV or stable_sort are not wanted. Compilers should
-  optimize away memory and operations of this class.
+  optimize away memory and operations of this class. The trait
+  npsv_used<W> tells whether W is a real width type.
 */
 
 #ifndef _AVL_ARRAY_EMPTY_NUMBER_HPP_
@@ -73,6 +74,21 @@ inline bool operator<= (const empty_number &, const empty_number &)
 inline bool operator>= (const empty_number &, const empty_number &)
 { return true; }
 
+// npsv_used: false if W is empty_number (no NPSV, so width sums
+// don't need any update), true otherwise
+
+template<class W>
+struct npsv_used
+{
+  static const bool value = true;
+};
+
+template<>
+struct npsv_used<empty_number>
+{
+  static const bool value = false;
+};
+
 //////////////////////////////////////////////////////////////////
 
   }  // namespace detail
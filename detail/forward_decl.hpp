@@ -24,31 +24,40 @@ namespace mkr  // Public namespace
 {
 
   template<class T, class A,
-           class W, class P>              // The only visible class
-  class avl_array;                        // is avl_array<T,A,W,P>
+           class W, class P,              // The only visible class
+           class S>                       // is avl_array<T,A,W,P,S>
+  class avl_array;
 
   namespace detail  // Private nested namespace mkr::detail
   {
 
     template<class T, class A,
-             class W, class P>            // Links and counters
+             class W, class P,            // Links and counters
+             class S>
     class avl_array_node_tree_fields;     // of a tree node
 
     template<class T, class A,
-             class W, class P>            // A tree node, including
+             class W, class P,            // A tree node, including
+             class S>
     class avl_array_node;                 // its payload value_type
 
     template<class T, class A,
-             class W, class P>            // A list of nodes to
+             class W, class P,            // A list of nodes to
+             class S>
     class rollback_list;                  // complete or delete
 
     template<class T, class A,
-             class W, class P,
+             class W, class P,            // Nodes with out of date
+             class S>                     // NPSV sums
+    class dirty_list;
+
+    template<class T, class A,
+             class W, class P, class S,
              class Ref, class Ptr>
     class avl_array_iterator;             // Normal iterator
 
     template<class T, class A,
-             class W, class P,
+             class W, class P, class S,
              class Ref, class Ptr>
     class avl_array_rev_iter;             // Reverse iterator
 
@@ -66,6 +75,9 @@ namespace mkr  // Public namespace
     template<class Ptr>
     class copy_data_provider;
 
+    template<class AR, class CMP>  // Functor for sorting nodes
+    class node_data_less;
+
     class empty_number;     // Default parameter for W (no NPSV)
                             // and P (no stable_sort)
   }  // namespace detail
@@ -19,12 +19,16 @@
   iterators together) avoids declaring them friends of each other.
   The method data() is used in avl_array too (index operators)
 
-  next(): get the next node of a given node (O(1))
-  prev(): get the previous node of a given node (O(1))
+  next(): get the next node of a given node (O(1) (*))
+  prev(): get the previous node of a given node (O(1) (*))
+  walk(): next or prev. walking the tree (O(log N))
+  is_reverse(): tell the direction of an iterator (O(1))
   data(): get (by ref) the data of a node (with data!) (O(1))
   iterator_pointer(): get the node refered by an it. (O(1))
   make_const_iterator(): get const it. referring a node (O(1))
   make_const_rev_iter(): get const reverse it... (O(1))
+
+  (*) O(log N) without threads, O(1) amortized in a travel
 */
 
 #ifndef _AVL_ARRAY_HELPER_FUN_ITER_HPP_
@@ -41,30 +45,102 @@ namespace mkr  // Public namespace
 
 // next(): Get the next node of a given node
 //
-// Complexity: O(1)
+// Complexity: O(1) (without threads: O(log N), and O(1)
+// amortized in a travel)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline //static
-  typename avl_array<T,A,W,P>::node_t *
-  avl_array<T,A,W,P>::next
-  (typename avl_array<T,A,W,P>::node_t * p)
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::next
+  (typename avl_array<T,A,W,P,S>::node_t * p)
 {
   AA_ASSERT (p);       // NULL pointer dereference
-  return p->m_next;
+
+  return S::threaded ?
+         threads_t::next (p) :  // m_next (in the tree)
+         walk (p, R);
 }
 
 // prev(): Get the previous node of a given node
 //
-// Complexity: O(1)
+// Complexity: O(1) (without threads: O(log N), and O(1)
+// amortized in a travel)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline //static
-  typename avl_array<T,A,W,P>::node_t *
-  avl_array<T,A,W,P>::prev
-  (typename avl_array<T,A,W,P>::node_t * p)
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::prev
+  (typename avl_array<T,A,W,P,S>::node_t * p)
 {
   AA_ASSERT (p);       // NULL pointer dereference
-  return p->m_prev;
+
+  return S::threaded ?
+         threads_t::prev (p) :  // m_prev (in the tree)
+         walk (p, L);
+}
+
+// walk(): Get the next (s==R) or previous (s==L) node of a
+// given node walking the tree, for layouts without threads.
+// The sequence is circular, with the dummy between the last
+// and the first nodes, just like the m_next/m_prev list
+//
+// Complexity: O(log N), O(1) amortized in a travel
+
+template<class T,class A,class W,class P,class S>
+//not inline
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::walk
+  (typename avl_array<T,A,W,P,S>::node_t * p,
+   int s)
+{
+  AA_ASSERT (p);       // NULL pointer dereference
+
+  if (!p->m_parent)           // From the dummy, whose left
+  {                           // subtree is the whole tree,
+    if (!p->m_children[L])    // go to the first or the last
+      return p;               // node (empty: stay here)
+
+    p = p->m_children[L];
+    while (p->m_children[1-s])
+      p = p->m_children[1-s];
+    return p;
+  }
+
+  if (p->m_children[s])              // If there's a subtree in
+  {                                  // side s, the neighbour is
+    p = p->m_children[s];            // its extreme node in the
+    while (p->m_children[1-s])       // other side
+      p = p->m_children[1-s];
+    return p;
+  }
+                                     // Otherwise, climb while
+  while (p->m_parent &&              // coming from side s. The
+         p->m_parent->m_children[s]==p)  // node where we stop
+    p = p->m_parent;                 // climbing is the one (or
+                                     // the dummy, if we reached
+  return p->m_parent ?               // it going to the first
+         p->m_parent : p;            // element's prev)
+}
+
+// is_reverse(): Tell the direction of an iterator, for
+// operations that work on its nodes out of the tree
+//
+// Complexity: O(1)
+
+template<class T,class A,class W,class P,class S>
+inline //static
+  bool avl_array<T,A,W,P,S>::is_reverse
+  (const typename avl_array<T,A,W,P,S>::iterator &)
+{
+  return false;
+}
+
+template<class T,class A,class W,class P,class S>
+inline //static
+  bool avl_array<T,A,W,P,S>::is_reverse
+  (const typename avl_array<T,A,W,P,S>::reverse_iterator &)
+{
+  return true;
 }
 
 // data(): Get a reference to the payload data (value_type)
@@ -72,11 +148,11 @@ inline //static
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline //static
-  typename avl_array<T,A,W,P>::reference
-  avl_array<T,A,W,P>::data
-  (typename avl_array<T,A,W,P>::node_t * p)
+  typename avl_array<T,A,W,P,S>::reference
+  avl_array<T,A,W,P,S>::data
+  (typename avl_array<T,A,W,P,S>::node_t * p)
 {
   AA_ASSERT (p);            // NULL pointer dereference
 
@@ -92,11 +168,11 @@ inline //static
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 template<class IT>
 inline //static
-  typename avl_array<T,A,W,P>::node_t *
-  avl_array<T,A,W,P>::iterator_pointer
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::iterator_pointer
   (const IT & it)
 {
 #ifdef BOOST_CLASS_REQUIRE
@@ -118,11 +194,11 @@ inline //static
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline //static
-  typename avl_array<T,A,W,P>::const_iterator
-  avl_array<T,A,W,P>::make_const_iterator
-  (typename avl_array<T,A,W,P>::node_t * p)
+  typename avl_array<T,A,W,P,S>::const_iterator
+  avl_array<T,A,W,P,S>::make_const_iterator
+  (typename avl_array<T,A,W,P,S>::node_t * p)
 {
   return const_iterator(p);
 }
@@ -134,11 +210,11 @@ inline //static
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline //static
-  typename avl_array<T,A,W,P>::const_reverse_iterator
-  avl_array<T,A,W,P>::make_const_rev_iter
-  (typename avl_array<T,A,W,P>::node_t * p)
+  typename avl_array<T,A,W,P,S>::const_reverse_iterator
+  avl_array<T,A,W,P,S>::make_const_rev_iter
+  (typename avl_array<T,A,W,P,S>::node_t * p)
 {
   return const_reverse_iterator(p);
 }
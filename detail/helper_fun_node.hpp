@@ -38,10 +38,10 @@ namespace mkr  // Public namespace
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  typename avl_array<T,A,W,P>::node_t *
-  avl_array<T,A,W,P>::dummy () const
+  typename avl_array<T,A,W,P,S>::node_t *
+  avl_array<T,A,W,P,S>::dummy () const
 {
   return static_cast<node_t*> (
          const_cast<my_class*> (this) );
@@ -52,11 +52,11 @@ inline
 //
 // Complexity: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline //static
-  typename avl_array<T,A,W,P>::my_class *
-  avl_array<T,A,W,P>::dummy_owner
-  (const typename avl_array<T,A,W,P>::node_t * pdummy)
+  typename avl_array<T,A,W,P,S>::my_class *
+  avl_array<T,A,W,P,S>::dummy_owner
+  (const typename avl_array<T,A,W,P,S>::node_t * pdummy)
 {
   AA_ASSERT (!pdummy->m_parent);
 
@@ -70,11 +70,11 @@ inline //static
 //
 // Complexity: O(log N)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline //static
-  typename avl_array<T,A,W,P>::my_class *
-  avl_array<T,A,W,P>::owner
-  (const typename avl_array<T,A,W,P>::node_t * node)
+  typename avl_array<T,A,W,P,S>::my_class *
+  avl_array<T,A,W,P,S>::owner
+  (const typename avl_array<T,A,W,P,S>::node_t * node)
 {
   while (node->m_parent)
     node = node->m_parent;
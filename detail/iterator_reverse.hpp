@@ -32,16 +32,16 @@ namespace mkr  // Public namespace
 //////////////////////////////////////////////////////////////////
 
 template<class T, class A,
-         class W, class P,             // 2-in-1 trick: Ref and
+         class W, class P, class S,    // 2-in-1 trick: Ref and
          class Ref, class Ptr>         // Ptr are re-defined for
 class avl_array_rev_iter               // const_iterator
 {
-  friend class mkr::avl_array<T,A,W,P>;
+  friend class mkr::avl_array<T,A,W,P,S>;
 
-  typedef avl_array_node_tree_fields<T,A,W,P>    node_t;
-  typedef avl_array_iterator<T,A,W,P,Ref,Ptr>    my_reverse;
-  typedef avl_array_rev_iter<T,A,W,P,Ref,Ptr>    my_class;
-  typedef mkr::avl_array<T,A,W,P>                my_array;
+  typedef avl_array_node_tree_fields<T,A,W,P,S>  node_t;
+  typedef avl_array_iterator<T,A,W,P,S,Ref,Ptr>  my_reverse;
+  typedef avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>  my_class;
+  typedef mkr::avl_array<T,A,W,P,S>              my_array;
 
   public: // -------------- PUBLIC INTERFACE ----------------
 
@@ -52,7 +52,7 @@ class avl_array_rev_iter               // const_iterator
 #endif
 
     typedef typename
-            avl_array<T,A,W,P>::value_type       value_type;
+            avl_array<T,A,W,P,S>::value_type       value_type;
     typedef Ref                                  reference;
     typedef Ptr                                  pointer;
     typedef typename my_array::size_type         size_type;
@@ -69,6 +69,10 @@ class avl_array_rev_iter               // const_iterator
 
     operator const_iterator ();     // Conversion to const
 
+    // Assignment: O(1)
+
+    my_class & operator= (const my_class & it);
+
     // Dereference: O(1)
 
     reference operator* () const;
@@ -96,29 +100,29 @@ class avl_array_rev_iter               // const_iterator
     // Iterators difference: O(log N)
 
     template<class X,class Y> difference_type operator-
-      (const avl_array_rev_iter<T,A,W,P,X,Y> & it) const;
+      (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it) const;
 
     // Equality comparisons: O(1)
 
     template<class X,class Y> bool operator==
-      (const avl_array_rev_iter<T,A,W,P,X,Y> & it) const;
+      (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it) const;
 
     template<class X,class Y> bool operator!=
-      (const avl_array_rev_iter<T,A,W,P,X,Y> & it) const;
+      (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it) const;
 
     // Lesser/greater comparisons: O(log N)
 
     template<class X,class Y> bool operator<
-      (const avl_array_rev_iter<T,A,W,P,X,Y> & it) const;
+      (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it) const;
 
     template<class X,class Y> bool operator>
-      (const avl_array_rev_iter<T,A,W,P,X,Y> & it) const;
+      (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it) const;
 
     template<class X,class Y> bool operator<=
-      (const avl_array_rev_iter<T,A,W,P,X,Y> & it) const;
+      (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it) const;
 
     template<class X,class Y> bool operator>=
-      (const avl_array_rev_iter<T,A,W,P,X,Y> & it) const;
+      (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it) const;
 
   private: // ----- PRIVATE DATA MEMBER AND HELPER FUN. ------
 
@@ -139,65 +143,72 @@ class avl_array_rev_iter               // const_iterator
 
 // Default constructor: create a singular iterator
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr>::
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::
   avl_array_rev_iter () : ptr(NULL) {}
 
 // Copy constructor: just copy the embedded pointer
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr>::
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::
   avl_array_rev_iter (const my_class & it) { ptr = it.ptr; }
 
+// Assignment: just copy the embedded pointer
+
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr> &
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator= (const my_class & it)
+{ ptr = it.ptr; return *this; }
+
 // Conversion from reverse iterator: copy the pointer (yes, the
 // same pointer; reverse iterators point to the refered element,
 // not to its neighbor). The helper method it_ptr() calls a
 // method of the avl_array class, which has access to the pointer
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr>::
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::
   avl_array_rev_iter (const my_reverse & it) { ptr = it_ptr(it); }
 
 // Conversion to const iterator. Again through the avl_array class
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr>::
-  operator typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::
+  operator typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::
   const_iterator ()
 { return my_array::make_const_rev_iter(ptr); } // (reverse...)
 
 // Dereference. data() asserts that this is neither a singular
 // iterator nor an end node.
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::reference
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator* () const
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::reference
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator* () const
 { return my_array::data (ptr); }
 
 // The arrow can be used when T is a struct or class
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::pointer
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator->() const
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::pointer
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator->() const
 { return &**this; }
 
 // Index operator [] indirectly calls avl_array::jump(), which
 // takes O(log N) time. NOTE: avl_array::jump() does check the
 // range
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::reference
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator[]
-  (typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::difference_type n)
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::reference
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator[]
+  (typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::difference_type n)
                                                               const
 { return *(*this+n); }
 
 // Index operator () does exactly the same as operator []
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::reference
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator()
-  (typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::difference_type n)
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::reference
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator()
+  (typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::difference_type n)
                                                               const
 { return *(*this+n); }
 
@@ -206,34 +217,34 @@ inline typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::reference
 // They need to call helper methods of avl_array because the
 // iterator class is not friend of the node class
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr> &
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator++ ()  // (pre++)
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr> &
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator++ ()  // (pre++)
 {
   ptr = my_array::prev (ptr);    // Step back! (reverse...)
   return *this;
 }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr> &
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator-- ()  // (pre--)
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr> &
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator-- ()  // (pre--)
 {
   ptr = my_array::next (ptr);    // Step forward! (reverse...)
   return *this;
 }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr>
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator++ (int) // (post++)
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator++ (int) // (post++)
 {
   my_class tmp(*this);
   ptr = my_array::prev (ptr);    // Step back! (reverse...)
   return tmp;                    // Return unmodified copy
 }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr>
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator-- (int) // (post--)
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator-- (int) // (post--)
 {
   my_class tmp(*this);
   ptr = my_array::next (ptr);    // Step forward! (reverse...)
@@ -245,41 +256,41 @@ inline avl_array_rev_iter<T,A,W,P,Ref,Ptr>
 // which takes between O(log n) and O(log N) time (n is the size
 // of the jump, and N is the size of the avl_array)
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr>
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator+
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator+
   (difference_type n)                             const
 {
   my_class tmp(*this);
-  tmp.ptr = my_array::jump (tmp.ptr, -n, false);   // Note: -n
+  tmp.ptr = my_array::jump (tmp.ptr, -n, true);    // Note: -n
   AA_ASSERT_EXC (tmp.ptr, index_out_of_bounds());  // (reverse...)
   return tmp;
 }                           // jump() takes logarithmic time
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr> operator+
-  (typename avl_array<T,A,W,P>::difference_type n,
-   const avl_array_rev_iter<T,A,W,P,Ref,Ptr> & it)
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr> operator+
+  (typename avl_array<T,A,W,P,S>::difference_type n,
+   const avl_array_rev_iter<T,A,W,P,S,Ref,Ptr> & it)
 { return it + n; }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr>
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator-
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator-
   (difference_type n)                             const
 { return *this + -n; }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr> &
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator+=
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr> &
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator+=
   (difference_type n)
 {
   *this = *this + n;
   return *this;
 }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
-inline avl_array_rev_iter<T,A,W,P,Ref,Ptr> &
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator-=
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
+inline avl_array_rev_iter<T,A,W,P,S,Ref,Ptr> &
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator-=
   (difference_type n)
 { return *this += -n; }
 
@@ -287,20 +298,20 @@ inline avl_array_rev_iter<T,A,W,P,Ref,Ptr> &
 // O(log N) time. It checks the consistency of operands regarding
 // the container they refer (should be the same for both)
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
 template                                <class X,  class Y>
 inline
-  typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::difference_type
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator-
-  (const avl_array_rev_iter<T,A,W,P,X,Y> & it)    const
+  typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::difference_type
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator-
+  (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it)    const
 {
   my_array * a, * b;
   size_type m, n;
 
   if (!ptr && !it_ptr(it)) return 0;  // Both singular
 
-  m = my_array::position_of_node (ptr, a, false);
-  n = my_array::position_of_node (it_ptr(it), b, false);
+  m = my_array::position_of_node (ptr, a, true);
+  n = my_array::position_of_node (it_ptr(it), b, true);
 
   AA_ASSERT (a==b); // Inter-array distance has no sense
 
@@ -311,18 +322,18 @@ inline
 // Equality and inequality operators take O(1) time. They can
 // also mix const and var iterators
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
 template                                <class X,  class Y>
 inline bool
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator==
-  (const avl_array_rev_iter<T,A,W,P,X,Y> & it)     const
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator==
+  (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it)     const
 { return ptr==it_ptr(it); }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
 template                                <class X,  class Y>
 inline bool
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator!=
-  (const avl_array_rev_iter<T,A,W,P,X,Y> & it)     const
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator!=
+  (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it)     const
 { return ptr!=it_ptr(it); }
 
 // Greater and lesser operators take O(log N) time in general.
@@ -330,71 +341,71 @@ inline bool
 // be decided with a simple equality/inequality comparison.
 // The compared iterators must refer the same container
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
 template                                <class X,  class Y>
 inline bool
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator<
-  (const avl_array_rev_iter<T,A,W,P,X,Y> & it)     const
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator<
+  (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it)     const
 { return ptr==it_ptr(it) ? false : *this-it<0; }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
 template                                <class X,  class Y>
 inline bool
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator>
-  (const avl_array_rev_iter<T,A,W,P,X,Y> & it)     const
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator>
+  (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it)     const
 { return ptr==it_ptr(it) ? false : *this-it>0; }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
 template                                <class X,  class Y>
 inline bool
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator<=
-  (const avl_array_rev_iter<T,A,W,P,X,Y> & it)     const
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator<=
+  (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it)     const
 { return ptr==it_ptr(it) ? true : *this-it<0; }
 
-template<class T,class A,class W,class P,class Ref,class Ptr>
+template<class T,class A,class W,class P,class S,class Ref,class Ptr>
 template                                <class X,  class Y>
 inline bool
-  avl_array_rev_iter<T,A,W,P,Ref,Ptr>::operator>=
-  (const avl_array_rev_iter<T,A,W,P,X,Y> & it)     const
+  avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::operator>=
+  (const avl_array_rev_iter<T,A,W,P,S,X,Y> & it)     const
 { return ptr==it_ptr(it) ? true : *this-it>0; }
 
 //////////////////////////////////////////////////////////////////
 
 // Iterator tag function iterator_category()
 
-template<class T, class A, class W, class P,
+template<class T, class A, class W, class P, class S,
          class Ref, class Ptr>
 inline
-  typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::iterator_category
-  iterator_category (const avl_array_rev_iter<T,A,W,P,Ref,Ptr>&)
+  typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::iterator_category
+  iterator_category (const avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>&)
 {
-  return typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::
+  return typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::
                                           iterator_category();
 }
 
 // Iterator tag function value_type()
 
-template<class T, class A, class W, class P,
+template<class T, class A, class W, class P, class S,
          class Ref, class Ptr>
 inline
-  typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::value_type *
-  value_type (const avl_array_rev_iter<T,A,W,P,Ref,Ptr>&)
+  typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::value_type *
+  value_type (const avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>&)
 {
   return reinterpret_cast<
-          typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::
+          typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::
                                              value_type *>(0);
 }
 
 // Iterator tag function distance_type()
 
-template<class T, class A, class W, class P,
+template<class T, class A, class W, class P, class S,
          class Ref, class Ptr>
 inline
-  typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::difference_type *
-  distance_type (const avl_array_rev_iter<T,A,W,P,Ref,Ptr>&)
+  typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::difference_type *
+  distance_type (const avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>&)
 {
   return reinterpret_cast<
-          typename avl_array_rev_iter<T,A,W,P,Ref,Ptr>::
+          typename avl_array_rev_iter<T,A,W,P,S,Ref,Ptr>::
                                         difference_type *>(0);
 }
 
@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////
+//                                                               //
+//  Copyright (c) 2006, Universidad de Alcala                    //
+//                                                               //
+//  See accompanying LICENSE.TXT                                 //
+//                                                               //
+///////////////////////////////////////////////////////////////////
+
+/*
+  detail/monoid_traits.hpp
+  ------------------------
+
+  Policy for the W parameter of avl_array. Every node stores a
+  width (m_node_width) and the combination of the widths of its
+  subtree, in sequence order (m_total_width). The default traits
+  treat W as a number: widths are added, an empty subtree has
+  width 0, and new elements get width 1 (that's NPSV, see
+  aa_npsv.hpp).
+
+  Any associative operation with an identity (a monoid) can be
+  used instead, specializing monoid_traits for another W type,
+  e.g. the minimum of a range of values:
+
+    struct min_int { int v; };
+
+    namespace mkr { namespace detail {
+    template<> struct monoid_traits<min_int>
+    {
+      static min_int identity () { min_int m = {INT_MAX}; return m; }
+      static min_int element () { return identity (); }
+      static min_int combine (const min_int & a, const min_int & b)
+      { return a.v<b.v ? a : b; }
+    }; } }
+
+  combine() doesn't need to be commutative (the left part is
+  always the first parameter). Then, set_width(), reduce() and
+  search() work for W (see aa_augment.hpp), while npsv_pos_of()
+  and npsv_at_pos() still need numeric widths.
+*/
+
+#ifndef _AVL_ARRAY_MONOID_TRAITS_HPP_
+#define _AVL_ARRAY_MONOID_TRAITS_HPP_
+
+#ifndef _AVL_ARRAY_HPP_
+#error "Don't include this file. Include avl_array.hpp instead."
+#endif
+
+namespace mkr  // Public namespace
+{
+
+  namespace detail  // Private nested namespace mkr::detail
+  {
+
+//////////////////////////////////////////////////////////////////
+
+template<class W>
+struct monoid_traits
+{
+  static W identity () { return W(0); }  // Width of nothing
+  static W element () { return W(1); }   // Width of new elements
+
+  static W combine (const W & a,         // Width of a sequence
+                    const W & b)         // (a) followed by
+  { return a+b; }                        // another one (b)
+};
+
+//////////////////////////////////////////////////////////////////
+
+  }  // namespace detail
+
+}  // namespace mkr
+
+#endif
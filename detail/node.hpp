@@ -12,7 +12,9 @@
 
   The class avl_array_node_tree_fields, defined here, contains all
   the links required by tree nodes. It does _not_ contain the
-  payload value_type (see detail/node_with_data.hpp).
+  payload value_type (see detail/node_with_data.hpp). The types of
+  its counters, and whether it has m_next/m_prev list links or not,
+  depend on the layout policy S (see detail/node_layout.hpp).
 
   Two classes inherit from avl_array_node_tree_fields:
 
@@ -45,17 +47,77 @@ namespace mkr  // Public namespace
 
 typedef enum { L=0, R=1 } enum_left_right;
 
+//////////////////////////////////////////////////////////////////
+/*
+  The class avl_array_node_links holds the links of the circular
+  doubly linked list that threads the tree nodes in order. Layouts
+  without threads use its empty specialization, and in that case
+  the next/previous nodes are found walking the tree.
+
+  Nodes out of the tree are often chained in temporary lists. The
+  class avl_array_threads provides the links of these lists: the
+  list links themselves, or (without threads) the children links,
+  which are free while a node is out of the tree. Its method
+  link() threads two nodes of a tree (no-op without threads).
+*/
+
+template<class N, bool threaded>  // Circular doubly linked list
+class avl_array_node_links        // (equiv. to in-order travel)
+{
+  template<bool> friend struct avl_array_threads;
+
+  protected:
+
+    N * m_next;             // (last_node.next==dummy)
+    N * m_prev;             // (first_node.prev==dummy)
+};
+
+template<class N>                     // No list links
+class avl_array_node_links<N,false>
+{};
+
+template<bool threaded>   // Links of nodes lists (with threads)
+struct avl_array_threads
+{
+  template<class N>
+  static N *& next (N * p) { return p->m_next; }
+
+  template<class N>
+  static N *& prev (N * p) { return p->m_prev; }
+
+  template<class N>
+  static void link (N * p, N * q) { p->m_next = q; q->m_prev = p; }
+};
+
+template<>                // Links of nodes lists (no threads)
+struct avl_array_threads<false>
+{
+  template<class N>
+  static N *& next (N * p) { return p->m_children[R]; }
+
+  template<class N>
+  static N *& prev (N * p) { return p->m_children[L]; }
+
+  template<class N>
+  static void link (N *, N *) {}
+};
+
 //////////////////////////////////////////////////////////////////
 
 template<class T, class A,        // Data of a tree node (payload
-         class W, class P>        // not included)
+         class W, class P,        // not included)
+         class S>
 class avl_array_node_tree_fields
-{                                 // Note that the dummy has no T
-
-  friend class mkr::avl_array<T,A,W,P>;
-  friend class rollback_list<T,A,W,P>;
+  : public avl_array_node_links<            // Note that the dummy
+      avl_array_node_tree_fields<T,A,W,P,S>,  // has no T
+      S::threaded>
+{
+  friend class mkr::avl_array<T,A,W,P,S>;
+  friend class rollback_list<T,A,W,P,S>;
+  template<bool> friend struct avl_array_threads;
 
-  typedef avl_array_node_tree_fields<T,A,W,P>    node_t;
+  typedef avl_array_node_tree_fields<T,A,W,P,S>  node_t;
+  typedef avl_array_threads<S::threaded>       threads_t;
 
   protected:
 
@@ -64,15 +126,13 @@ class avl_array_node_tree_fields
     node_t * m_parent;      // parent node
     node_t * m_children[2]; // [0]:left [1]:right
 
-    // Circular doubly linked list (equiv. to in-order travel)
-
-    node_t * m_next;        // (last_node.next==dummy)
-    node_t * m_prev;        // (first_node.prev==dummy)
+    // [ Circular doubly linked list: inherited, if any ]
 
     // Data for balancing, indexing, and stable-sort
 
-    std::size_t m_height;   // levels in subtree, including self
-    std::size_t m_count;    // nodes in subtree, including self
+    typename S::count_type m_count;    // nodes in subtree,
+    typename S::height_type m_height;  // levels in subtree,
+                                       // both including self
     P m_oldpos;             // position (used only in stable_sort)
 
                       // Alternative sequence view:
@@ -94,91 +154,134 @@ class avl_array_node_tree_fields
 
     W left_width () const;             // Width of left subtree
     W right_width () const;            // Width of right subtree
+    W subtree_width () const;          // Width of left+this+right
+
+    node_t *& list_next ();            // Links of a temporary
+    node_t *& list_prev ();            // list (out of the tree)
 };
 
 //////////////////////////////////////////////////////////////////
 
 // Initializer, or "reset" method: write default values
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline void
-  avl_array_node_tree_fields<T,A,W,P>::
+  avl_array_node_tree_fields<T,A,W,P,S>::
   init ()                                // Write default values
 {
   m_parent =
   m_children[L] = m_children[R] = NULL; // No relatives
 
-  m_next = m_prev = this;     // Loop list
+  threads_t::link (this, this);  // Loop list
   m_height = m_count = 1;     // Single element, single level
 
-  m_node_width = m_total_width = W(1);  // Default
-}                                       // width
+  m_node_width = m_total_width =       // Default
+               monoid_traits<W>::element (); // width
+}
 
 // Constructor: just call init()
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline
-  avl_array_node_tree_fields<T,A,W,P>::
+  avl_array_node_tree_fields<T,A,W,P,S>::
   avl_array_node_tree_fields ()
 { init (); }
 
 // Helper functions: return count/height/width of left/right
 // subtree. This doesn't require loops or recursion. If the
 // left/right subtree is empty, return 0; otherwise, return
-// the count/height/width of its root. Time required is O(1)
+// the count/height/width of its root (for widths, "0" is the
+// identity of monoid_traits<W>). Time required is O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline std::size_t
-  avl_array_node_tree_fields<T,A,W,P>::
+  avl_array_node_tree_fields<T,A,W,P,S>::
   left_count ()                         const
 {
   return m_children[L] ?
          m_children[L]->m_count : 0;
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline std::size_t
-  avl_array_node_tree_fields<T,A,W,P>::
+  avl_array_node_tree_fields<T,A,W,P,S>::
   right_count ()                        const
 {
   return m_children[R] ?
          m_children[R]->m_count : 0;
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline std::size_t
-  avl_array_node_tree_fields<T,A,W,P>::
+  avl_array_node_tree_fields<T,A,W,P,S>::
   left_height ()                        const
 {
   return m_children[L] ?
          m_children[L]->m_height : 0;
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline std::size_t
-  avl_array_node_tree_fields<T,A,W,P>::
+  avl_array_node_tree_fields<T,A,W,P,S>::
   right_height ()                       const
 {
   return m_children[R] ?
          m_children[R]->m_height : 0;
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline W
-  avl_array_node_tree_fields<T,A,W,P>::
+  avl_array_node_tree_fields<T,A,W,P,S>::
   left_width ()                         const
 {
   return m_children[L] ?
-         m_children[L]->m_total_width : W(0);
+         m_children[L]->m_total_width : monoid_traits<W>::identity ();
 }
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline W
-  avl_array_node_tree_fields<T,A,W,P>::
+  avl_array_node_tree_fields<T,A,W,P,S>::
   right_width ()                        const
 {
   return m_children[R] ?
-         m_children[R]->m_total_width : W(0);
+         m_children[R]->m_total_width : monoid_traits<W>::identity ();
+}
+
+// subtree_width(): return the width of the subtree whose root
+// is this node, computed from the widths of its children (the
+// widths of the left subtree, this node and the right subtree
+// combined in this order, i.e. added for NPSV). The result
+// should be stored in m_total_width. Time required is O(1)
+
+template<class T,class A,class W,class P,class S>
+inline W
+  avl_array_node_tree_fields<T,A,W,P,S>::
+  subtree_width ()                      const
+{
+  return monoid_traits<W>::combine
+           (monoid_traits<W>::combine (left_width (), m_node_width),
+            right_width ());
+}
+
+// Helper functions: return the links of a node in a temporary
+// list of nodes (see avl_array_threads above)
+
+template<class T,class A,class W,class P,class S>
+inline
+  avl_array_node_tree_fields<T,A,W,P,S> *&
+  avl_array_node_tree_fields<T,A,W,P,S>::
+  list_next ()
+{
+  return threads_t::next (this);
+}
+
+template<class T,class A,class W,class P,class S>
+inline
+  avl_array_node_tree_fields<T,A,W,P,S> *&
+  avl_array_node_tree_fields<T,A,W,P,S>::
+  list_prev ()
+{
+  return threads_t::prev (this);
 }
 
 //////////////////////////////////////////////////////////////////
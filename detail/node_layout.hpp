@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////
+//                                                               //
+//  Copyright (c) 2006, Universidad de Alcala                    //
+//                                                               //
+//  See accompanying LICENSE.TXT                                 //
+//                                                               //
+///////////////////////////////////////////////////////////////////
+
+/*
+  detail/node_layout.hpp
+  ----------------------
+
+  Node layout policies, used as parameter S of avl_array. They
+  choose the types of the count and height fields of every node,
+  and whether nodes are threaded in a circular doubly linked list
+  (m_next and m_prev). Without threads, iterators step by walking
+  the tree (O(log N) worst case, O(1) amortized in a full travel)
+  and begin()/rbegin() take O(log N) too.
+
+    threaded_layout:   size_t fields, threaded (default)
+    compact_layout:    32 bit count, 8 bit height, no threads
+
+  With 64 bit pointers, compact_layout takes 32 bytes per node
+  instead of 64 (plus the payload). The count limits the size of
+  the container to 2^32-2 elements (see max_size()).
+*/
+
+#ifndef _AVL_ARRAY_NODE_LAYOUT_HPP_
+#define _AVL_ARRAY_NODE_LAYOUT_HPP_
+
+#ifndef _AVL_ARRAY_HPP_
+#error "Don't include this file. Include avl_array.hpp instead."
+#endif
+
+namespace mkr  // Public namespace
+{
+
+  namespace detail  // Private nested namespace mkr::detail
+  {
+
+//////////////////////////////////////////////////////////////////
+
+template<class C,          // Type of the count of nodes in subtree
+         class H,          // Type of the height of a subtree
+         bool threads>     // Keep the m_next/m_prev list?
+struct node_layout
+{
+  typedef C count_type;
+  typedef H height_type;
+
+  static const bool threaded = threads;
+};
+
+typedef node_layout<std::size_t,
+                    std::size_t, true>       threaded_layout;
+
+typedef node_layout<unsigned int,            // (32 bits in all
+                    unsigned char, false>    // usual platforms)
+                                             compact_layout;
+
+//////////////////////////////////////////////////////////////////
+
+  }  // namespace detail
+
+}  // namespace mkr
+
+#endif
@@ -0,0 +1,391 @@
+///////////////////////////////////////////////////////////////////
+//                                                               //
+//  Copyright (c) 2006, Universidad de Alcala                    //
+//                                                               //
+//  See accompanying LICENSE.TXT                                 //
+//                                                               //
+///////////////////////////////////////////////////////////////////
+
+/*
+  detail/node_pool.hpp
+  --------------------
+
+  Pool allocator, to be used as parameter A of avl_array. Single
+  objects are carved out of big chunks and recycled through a
+  free list, instead of asking the heap for every node. All the
+  allocators of the same type share one pool, so nodes can still
+  be moved freely between avl_arrays (the Tag parameter can be
+  used to get independent pools for the same element type).
+
+  When the pool only holds the nodes of one avl_array, clear()
+  and the destructor can free all of them at once, in O(chunks),
+  provided that the nodes are trivially destructible. An
+  avl_array can also reserve() memory for a given number of
+  nodes in advance.
+
+  Note: pools are not thread safe. Arrays used from different
+  threads at the same time must use different Tags.
+
+    node_pool_allocator<T,Tag>:   the allocator
+    pool_traits<A>:               pool operations (no-op for
+                                  other allocators)
+    trivially_destructible<T>:    can destructors be skipped?
+
+  Pools can also allocate blocks of contiguous objects, which
+  avl_array uses to relayout() its nodes.
+*/
+
+#ifndef _AVL_ARRAY_NODE_POOL_HPP_
+#define _AVL_ARRAY_NODE_POOL_HPP_
+
+#ifndef _AVL_ARRAY_HPP_
+#error "Don't include this file. Include avl_array.hpp instead."
+#endif
+
+namespace mkr  // Public namespace
+{
+
+  namespace detail  // Private nested namespace mkr::detail
+  {
+
+//////////////////////////////////////////////////////////////////
+
+template<class T,
+         class Tag=void>   // Different tags --> different pools
+class node_pool_allocator
+{
+  public:
+
+    typedef T                  value_type;
+    typedef T *                pointer;
+    typedef const T *          const_pointer;
+    typedef T &                reference;
+    typedef const T &          const_reference;
+    typedef std::size_t        size_type;
+    typedef std::ptrdiff_t     difference_type;
+
+    template<class U>
+    struct rebind { typedef node_pool_allocator<U,Tag> other; };
+
+    node_pool_allocator () {}
+
+    template<class U>
+    node_pool_allocator (const node_pool_allocator<U,Tag> &) {}
+
+    pointer address (reference t) const { return &t; }
+    const_pointer address (const_reference t) const { return &t; }
+
+    pointer allocate (size_type n, const void * hint=0);
+    void deallocate (pointer p, size_type n);
+
+    size_type max_size () const
+    { return size_type(-1) / slot_size; }
+
+    void construct (pointer p, const_reference t)
+    { new (p) T(t); }
+
+    void destroy (pointer p)
+    { p->~T(); }
+
+    // Pool operations (see pool_traits)
+
+    static void reserve (size_type n);  // Make room for n objects
+    static bool release (size_type n);  // Free all if n are used
+    static void trim ();                // Free all if none used
+
+    static pointer allocate_block       // n contiguous objects
+                        (size_type n);  // (deallocated one by one)
+    static pointer block_item           // Object i of a block
+                        (pointer p, size_type i);
+
+  private:
+
+    struct slot           // A free slot stores the link to the
+    {                     // next one. The first slot of every
+      slot * next;        // chunk links the previous chunk
+    };
+
+    enum
+    {
+      slot_size =                           // Object size, rounded
+        (sizeof(T)+sizeof(slot)-1) /        // to keep links
+        sizeof(slot) * sizeof(slot),        // aligned
+
+      first_chunk = 32,                     // Slots in the first
+      max_chunk = 65536                     // chunk, and limit of
+    };                                      // geometric growth
+
+    struct pool_state     // POD, so that it is zero-initialized
+    {                     // before any dynamic initialization
+      slot * free;        // Free list
+      char * bump;        // Unused end of the current chunk
+      char * end;
+      slot * chunks;      // List of chunks (newest first)
+      size_type chunk;    // Size (slots) of the last chunk
+      size_type slots;    // Size (slots) of all the chunks
+      size_type used;     // Objects currently allocated
+    };
+
+    static pool_state s_pool;
+
+    static void add_chunk (size_type n);
+};
+
+template<class T,class Tag>
+typename node_pool_allocator<T,Tag>::pool_state
+  node_pool_allocator<T,Tag>::s_pool;
+
+template<class T,class U,class Tag>
+inline bool operator== (const node_pool_allocator<T,Tag> &,
+                        const node_pool_allocator<U,Tag> &)
+{ return true; }      // All of them share the same pool
+
+template<class T,class U,class Tag>
+inline bool operator!= (const node_pool_allocator<T,Tag> &,
+                        const node_pool_allocator<U,Tag> &)
+{ return false; }
+
+// allocate(): Take a free slot, or the next unused slot of the
+// current chunk, or a new chunk. Arrays (n>1) are not pooled
+//
+// Complexity: O(1) (amortized, if a chunk is added)
+
+template<class T,class Tag>
+inline
+  typename node_pool_allocator<T,Tag>::pointer
+  node_pool_allocator<T,Tag>::allocate
+  (size_type n, const void *)
+{
+  void * p;
+
+  if (n!=1)
+    return static_cast<pointer>(::operator new (n*sizeof(T)));
+
+  if (s_pool.free)                    // Recycle a free slot
+  {
+    p = s_pool.free;
+    s_pool.free = s_pool.free->next;
+  }
+  else                                // Or take a new one
+  {
+    if (s_pool.bump==s_pool.end)      // (chunks grow geometrically)
+      add_chunk (!s_pool.chunk ? size_type(first_chunk) :
+                 s_pool.chunk<size_type(max_chunk) ?
+                 s_pool.chunk<<1 : size_type(max_chunk));
+    p = s_pool.bump;
+    s_pool.bump += slot_size;
+  }
+
+  s_pool.used ++;
+  return static_cast<pointer>(p);
+}
+
+// deallocate(): Put a slot back in the free list
+//
+// Complexity: O(1)
+
+template<class T,class Tag>
+inline void
+  node_pool_allocator<T,Tag>::deallocate
+  (pointer p, size_type n)
+{
+  slot * s;
+
+  if (n!=1)
+  {
+    ::operator delete (p);
+    return;
+  }
+
+  s = reinterpret_cast<slot*>(p);
+  s->next = s_pool.free;
+  s_pool.free = s;
+  s_pool.used --;
+}
+
+// reserve(): Make sure that the next n allocations won't
+// need a new chunk
+//
+// Complexity: O(1)
+
+template<class T,class Tag>
+//not inline
+  void node_pool_allocator<T,Tag>::reserve
+  (size_type n)
+{
+  size_type room;
+
+  room = s_pool.slots - s_pool.used;    // Free or never used
+
+  if (room<n)
+    add_chunk (n-room);
+}
+
+// release(): If the pool has exactly n objects allocated (the
+// nodes of one avl_array), free all the chunks, forgetting
+// those objects, and return true. Otherwise return false
+//
+// Complexity: O(chunks)
+
+template<class T,class Tag>
+//not inline
+  bool node_pool_allocator<T,Tag>::release
+  (size_type n)
+{
+  slot * c;
+
+  if (s_pool.used!=n)
+    return false;
+
+  while (s_pool.chunks)
+  {
+    c = s_pool.chunks;
+    s_pool.chunks = c->next;
+    ::operator delete (c);
+  }
+
+  s_pool.free = NULL;
+  s_pool.bump = s_pool.end = NULL;
+  s_pool.chunk = s_pool.slots = s_pool.used = 0;
+
+  return true;
+}
+
+// allocate_block(): Allocate n objects in a new chunk of their
+// own, one after another, so that they are contiguous in
+// memory. They are used like n allocations of one object
+//
+// Complexity: O(1)
+
+template<class T,class Tag>
+//not inline
+  typename node_pool_allocator<T,Tag>::pointer
+  node_pool_allocator<T,Tag>::allocate_block
+  (size_type n)
+{
+  char * p;
+
+  add_chunk (n);
+
+  p = s_pool.bump;                    // Take the whole chunk
+  s_pool.bump = s_pool.end;
+  s_pool.used += n;
+
+  return reinterpret_cast<pointer>(p);
+}
+
+// block_item(): Get the address of object i of a block
+//
+// Complexity: O(1)
+
+template<class T,class Tag>
+inline
+  typename node_pool_allocator<T,Tag>::pointer
+  node_pool_allocator<T,Tag>::block_item
+  (pointer p, size_type i)
+{
+  return reinterpret_cast<pointer>
+                       (reinterpret_cast<char*>(p) + i*slot_size);
+}
+
+// trim(): Free all the chunks if no object is allocated
+//
+// Complexity: O(chunks)
+
+template<class T,class Tag>
+inline void node_pool_allocator<T,Tag>::trim ()
+{
+  release (0);
+}
+
+// add_chunk(): Allocate a chunk with room for at least n objects
+// (plus the chunks list link) and make it the current one.
+// The unused slots of the previous chunk go to the free list
+//
+// Complexity: O(1) (amortized)
+
+template<class T,class Tag>
+//not inline
+  void node_pool_allocator<T,Tag>::add_chunk
+  (size_type n)
+{
+  slot * c;
+
+  c = static_cast<slot*>(::operator new ((n+1)*slot_size));
+
+  while (s_pool.bump!=s_pool.end)             // Don't waste
+  {                                           // the rest of
+    slot * s = reinterpret_cast<slot*>(s_pool.bump);  // the old
+    s->next = s_pool.free;                    // chunk
+    s_pool.free = s;
+    s_pool.bump += slot_size;
+  }
+
+  c->next = s_pool.chunks;              // Link the chunk
+  s_pool.chunks = c;
+
+  s_pool.bump = reinterpret_cast<char*>(c) + slot_size;
+  s_pool.end = s_pool.bump + n*slot_size;
+  s_pool.slots += n;
+  s_pool.chunk = n<size_type(max_chunk) ?   // (a big reserve()
+                 n : size_type(max_chunk);  // doesn't make later
+}                                           // chunks bigger)
+
+//////////////////////////////////////////////////////////////////
+
+// pool_traits: Pool operations for avl_array. Allocators other
+// than node_pool_allocator don't have a pool: reserve() does
+// nothing, while release() and allocate_block() always fail
+
+template<class A>
+struct pool_traits
+{
+  typedef typename A::pointer pointer;
+
+  static void reserve (A &, std::size_t) {}
+  static bool release (A &, std::size_t) { return false; }
+  static void trim (A &) {}
+
+  static pointer allocate_block (A &, std::size_t) { return 0; }
+  static pointer block_item (pointer p, std::size_t i)
+  { return p+i; }
+};
+
+template<class T,class Tag>
+struct pool_traits<node_pool_allocator<T,Tag> >
+{
+  typedef node_pool_allocator<T,Tag> A;
+
+  static void reserve (A &, std::size_t n) { A::reserve (n); }
+  static bool release (A &, std::size_t n) { return A::release (n); }
+  static void trim (A &) { A::trim (); }
+
+  static typename A::pointer allocate_block (A &, std::size_t n)
+  { return A::allocate_block (n); }
+
+  static typename A::pointer block_item (typename A::pointer p,
+                                         std::size_t i)
+  { return A::block_item (p, i); }
+};
+
+// trivially_destructible: true if the destructor of T does
+// nothing, so that it can be skipped (only known for sure
+// with C++11)
+
+template<class T>
+struct trivially_destructible
+{
+#if __cplusplus >= 201103L
+  static const bool value = std::is_trivially_destructible<T>::value;
+#else
+  static const bool value = false;
+#endif
+};
+
+//////////////////////////////////////////////////////////////////
+
+  }  // namespace detail
+
+}  // namespace mkr
+
+#endif
@@ -16,7 +16,10 @@
   "copy" constructor is provided for copying from value_type.
   Therefore, construction from scratch and normal copy
   construction need to be defined too (they work just like the
-  default constructors would).
+  default constructors would). With C++11, an "emplace"
+  constructor (tagged with emplace_args) forwards any arguments
+  to the constructor of value_type, so that it can be moved in
+  or built in place.
 */
 
 #ifndef _AVL_ARRAY_NODE_WITH_DATA_HPP_
@@ -34,22 +37,27 @@ namespace mkr  // Public namespace
 
 //////////////////////////////////////////////////////////////////
 
+struct emplace_args {};  // Tag for the emplace constructor
+
+//////////////////////////////////////////////////////////////////
+
 template<class T, class A,
-         class W, class P>       // Tree node (with payload T)
+         class W, class P,       // Tree node (with payload T)
+         class S>
 class avl_array_node
-  : private avl_array_node_tree_fields<T,A,W,P>
+  : private avl_array_node_tree_fields<T,A,W,P,S>
 {
-  friend class mkr::avl_array<T,A,W,P>;
+  friend class mkr::avl_array<T,A,W,P,S>;
 
-  typedef avl_array_node_tree_fields<T,A,W,P>    node_t;
-  typedef avl_array_node<T,A,W,P>                payload_node_t;
+  typedef avl_array_node_tree_fields<T,A,W,P,S>  node_t;
+  typedef avl_array_node<T,A,W,P,S>              payload_node_t;
 
   typedef typename
-          avl_array<T,A,W,P>::value_type         value_type;
+          avl_array<T,A,W,P,S>::value_type         value_type;
   typedef typename
-          avl_array<T,A,W,P>::const_reference    const_reference;
+          avl_array<T,A,W,P,S>::const_reference    const_reference;
 
-  private:  // Only avl_array<T,A,W,P> has access to this class
+  private:  // Only avl_array<T,A,W,P,S> has access to this class
 
     // [ Node links and counters: inherited from base class ]
 
@@ -63,6 +71,15 @@ class avl_array_node
 
     avl_array_node (const_reference t)        // "Copy" ctor.
       : m_data(t) {}                          // (from T)
+
+#if __cplusplus >= 201103L
+
+    template<class... ARGS>                   // Emplace ctor.
+    avl_array_node (emplace_args,             // (T from any
+                    ARGS &&... args)          // arguments)
+      : m_data(std::forward<ARGS>(args)...) {}
+
+#endif
 };
 
 //////////////////////////////////////////////////////////////////
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Thread fan-out shared by the parallel algorithms of btree_array_t and
+// avl_array. In both, a thread count of 0 means one thread per processor
+// and 1 means the calling thread alone
+
+namespace parallel_detail
+{
+
+// The number of threads asked for, with 0 resolved to one per processor
+
+inline std::size_t thread_count(std::size_t threads)
+{
+	if (threads != 0) return threads;
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Run functor(I) for every I in [0, count), each on its own thread. If
+// any of them throws, the first exception is rethrown here once all
+// the threads are done
+
+template<typename Functor>
+void parallel_for(std::size_t count, Functor functor)
+{
+	if (count == 1)
+	{
+		functor(std::size_t{0});
+		return;
+	}
+
+	std::vector<std::exception_ptr> errors(count);
+	std::vector<std::thread> workers;
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		workers.emplace_back([&functor, &errors, I]
+		{
+			try { functor(I); }
+			catch (...) { errors[I] = std::current_exception(); }
+		});
+	}
+	for (auto & worker : workers) worker.join();
+
+	for (auto & error : errors)
+	{
+		if (error) std::rethrow_exception(error);
+	}
+}
+
+// Merge the sorted runs [bounds[I], bounds[I + 1]) of data pairwise until
+// one is left, with the merges of a round done in parallel. Each round
+// writes into the other of data and scratch, both of bounds.back()
+// elements, and the one holding the result is returned
+
+template<typename T, typename Compare>
+T * merge_runs(T * data, T * scratch, std::vector<std::size_t> const & bounds, Compare compare)
+{
+	auto runs = bounds.size() - 1;
+	for (std::size_t width = 1; width < runs; width *= 2)
+	{
+		auto pairs = (runs + 2 * width - 1) / (2 * width);
+		parallel_for(pairs, [&](std::size_t I)
+		{
+			auto first = bounds[2 * width * I];
+			auto middle = bounds[std::min(2 * width * I + width, runs)];
+			auto last = bounds[std::min(2 * width * I + 2 * width, runs)];
+			std::merge(data + first, data + middle, data + middle, data + last, scratch + first, compare);
+		});
+		std::swap(data, scratch);
+	}
+	return data;
+}
+
+}
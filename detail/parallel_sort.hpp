@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////
+//                                                               //
+//  Copyright (c) 2006, Universidad de Alcala                    //
+//                                                               //
+//  See accompanying LICENSE.TXT                                 //
+//                                                               //
+///////////////////////////////////////////////////////////////////
+
+/*
+  detail/parallel_sort.hpp
+  ------------------------
+
+  Merge sort of an array with several threads, used by avl_array
+  for sorting arrays of pointers to its nodes. Every thread
+  sorts a slice of the array, and then the sorted slices are
+  merged by pairs, with the merges of every round done in
+  parallel. Merges are stable, so the result is stable if the
+  slices are sorted with std::stable_sort. The thread fan-out
+  and the merges are shared with btree_array_t (see parallel.hpp).
+
+  Threads need C++11 (std::thread). Otherwise, the whole array is
+  sorted by the calling thread.
+
+    node_data_less<AR,CMP>:  compare the T objects of two nodes
+    parallel_merge_sort():   sort an array with several threads
+*/
+
+#ifndef _AVL_ARRAY_PARALLEL_SORT_HPP_
+#define _AVL_ARRAY_PARALLEL_SORT_HPP_
+
+#ifndef _AVL_ARRAY_HPP_
+#error "Don't include this file. Include avl_array.hpp instead."
+#endif
+
+#if __cplusplus >= 201103L
+#include "parallel.hpp"             // parallel_for(), merge_runs()
+#endif
+
+namespace mkr  // Public namespace
+{
+
+  namespace detail  // Private nested namespace mkr::detail
+  {
+
+//////////////////////////////////////////////////////////////////
+
+template<class AR, class CMP>   // Function object for comparing
+class node_data_less            // nodes with a comparison for
+{                               // their T objects
+  private:
+
+    CMP cmp;
+
+  public:
+
+    node_data_less (CMP c) : cmp(c) {}
+
+    bool operator() (typename AR::node_t * a,
+                     typename AR::node_t * b)
+    {
+      return cmp (AR::data (a), AR::data (b));
+    }
+};
+
+//////////////////////////////////////////////////////////////////
+
+// parallel_merge_sort(): Sort the n elements of the array a
+// using the given number of threads, and return a pointer to
+// the sorted sequence: a itself, or the scratch array b (of n
+// elements too, not needed with a single thread). With
+// stable==true, equivalent elements keep their order
+//
+// Complexity: O((N log N)/threads + N log threads)
+
+template<class T, class CMP>
+T * parallel_merge_sort (T * a, T * b, std::size_t n, CMP cmp,
+                         std::size_t threads, bool stable)
+{
+  if (threads<2 || !b)        // Just one slice
+  {
+    if (stable)
+      std::stable_sort (a, a+n, cmp);
+    else
+      std::sort (a, a+n, cmp);
+
+    return a;
+  }
+
+#if __cplusplus >= 201103L
+
+  std::vector<std::size_t> bounds (threads+1);
+  std::size_t i;
+
+  for (i=0; i<=threads; i++)      // Slice limits
+    bounds[i] = n * i / threads;
+
+  parallel_detail::parallel_for (threads, [&] (std::size_t i)
+  {                                            // Sort them
+    if (stable)
+      std::stable_sort (a+bounds[i], a+bounds[i+1], cmp);
+    else
+      std::sort (a+bounds[i], a+bounds[i+1], cmp);
+  });
+
+  a = parallel_detail::merge_runs (a, b, bounds, cmp);  // Merge
+
+#endif
+
+  return a;
+}
+
+//////////////////////////////////////////////////////////////////
+
+  }  // namespace detail
+
+}  // namespace mkr
+
+#endif
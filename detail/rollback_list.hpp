@@ -33,13 +33,14 @@ namespace mkr  // Public namespace
 //////////////////////////////////////////////////////////////////
 
 template<class T, class A,
-         class W, class P>            // A list of nodes to
+         class W, class P,            // A list of nodes to
+         class S>
 class rollback_list                   // complete or delete
 {
-  friend class mkr::avl_array<T,A,W,P>;
+  friend class mkr::avl_array<T,A,W,P,S>;
 
-  typedef avl_array_node_tree_fields<T,A,W,P> node_t;
-  typedef mkr::avl_array<T,A,W,P> my_array;
+  typedef avl_array_node_tree_fields<T,A,W,P,S> node_t;
+  typedef mkr::avl_array<T,A,W,P,S> my_array;
 
   private:
                           // avl_array that will deallocate
@@ -51,8 +52,8 @@ class rollback_list                   // complete or delete
 
     rollback_list (my_array * owner); // The one and only constr.
 
-    rollback_list<T,A,W,P> & operator=   // Assignment is a no-op
-      (const rollback_list<T,A,W,P> &);  // (just prevents messing
+    rollback_list<T,A,W,P,S> & operator=   // Assignment is a no-op
+      (const rollback_list<T,A,W,P,S> &);  // (just prevents messing
                                          // lists)
 
     ~rollback_list ();  // Rollback on destruction (if nodes are
@@ -71,8 +72,8 @@ class rollback_list                   // complete or delete
 // the address of the avl_array. This address will be required for
 // deallocating the nodes in the destructor (in case of rollback)
 
-template<class T,class A,class W,class P>
-inline rollback_list<T,A,W,P>::rollback_list (my_array * owner)
+template<class T,class A,class W,class P,class S>
+inline rollback_list<T,A,W,P,S>::rollback_list (my_array * owner)
    : m_owner(owner),
      m_first(NULL),
      m_last(NULL)
@@ -83,10 +84,10 @@ inline rollback_list<T,A,W,P>::rollback_list (my_array * owner)
 // default assignment that would leave memory leaks and/or
 // provoke double destructions
 
-template<class T,class A,class W,class P>
-inline rollback_list<T,A,W,P> &
-  rollback_list<T,A,W,P>::operator=
-  (const rollback_list<T,A,W,P> &)
+template<class T,class A,class W,class P,class S>
+inline rollback_list<T,A,W,P,S> &
+  rollback_list<T,A,W,P,S>::operator=
+  (const rollback_list<T,A,W,P,S> &)
 {}
 
 // Destructor: iff there are nodes in the list (as a result of the
@@ -94,15 +95,15 @@ inline rollback_list<T,A,W,P> &
 // deallocate them. If the list is empty (the usual case), this
 // will take O(1). Otherwise, it will take O(n) time
 
-template<class T,class A,class W,class P>
-inline rollback_list<T,A,W,P>::~rollback_list ()
+template<class T,class A,class W,class P,class S>
+inline rollback_list<T,A,W,P,S>::~rollback_list ()
 {
   node_t * p;
 
   while (m_first)
   {
     p = m_first;
-    m_first = m_first->m_next;
+    m_first = m_first->list_next ();
     m_owner->delete_node (p);
   }
 }
@@ -110,16 +111,16 @@ inline rollback_list<T,A,W,P>::~rollback_list ()
 // push_front(): insert a node at the beginning of the list. Time
 // required: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline void
-  rollback_list<T,A,W,P>::
+  rollback_list<T,A,W,P,S>::
   push_front (node_t * newnode)
 {
-  newnode->m_next = m_first;
-  newnode->m_prev = NULL;
+  newnode->list_next () = m_first;
+  newnode->list_prev () = NULL;
 
   if (m_first)
-    m_first->m_prev = newnode;
+    m_first->list_prev () = newnode;
   else
     m_last = newnode;
 
@@ -129,16 +130,16 @@ inline void
 // push_back(): append a node at the end of the list. Time
 // required: O(1)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline void
-  rollback_list<T,A,W,P>::
+  rollback_list<T,A,W,P,S>::
   push_back (node_t * newnode)
 {
-  newnode->m_prev = m_last;
-  newnode->m_next = NULL;
+  newnode->list_prev () = m_last;
+  newnode->list_next () = NULL;
 
   if (m_last)
-    m_last->m_next = newnode;
+    m_last->list_next () = newnode;
   else
     m_first = newnode;
 
@@ -149,9 +150,9 @@ inline void
 // and last are received by reference). Reset the list (cancel
 // rollback)
 
-template<class T,class A,class W,class P>
+template<class T,class A,class W,class P,class S>
 inline void
-  rollback_list<T,A,W,P>::
+  rollback_list<T,A,W,P,S>::
   commit (node_t *& first,
           node_t *& last)
 {
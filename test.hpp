@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+
+// Count a failed check and report where it happened, the test returns the
+// number of failures from main
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+inline std::size_t & failures()
+{
+	static std::size_t count = 0;
+	return count;
+}
+
+inline void check(bool passed, char const * condition, char const * file, int line)
+{
+	if (passed) return;
+	++failures();
+	std::cerr << file << ":" << line << ": check failed: " << condition << "\n";
+}
+
+inline int report(char const * name)
+{
+	if (failures() == 0)
+	{
+		std::cout << name << ": ok\n";
+		return 0;
+	}
+	std::cout << name << ": " << failures() << " failed\n";
+	return 1;
+}
+
+// Random position in [0, size]
+
+inline std::size_t random_index(std::mt19937_64 & engine, std::size_t size)
+{
+	std::uniform_int_distribution<std::size_t> dist(0, size);
+	return dist(engine);
+}
@@ -0,0 +1,1072 @@
+#include "avl_array.hpp"
+#include "test.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// avl_array is checked against a std::vector with the same history, with
+// each node layout: threaded_layout steps along the m_next/m_prev list
+// and compact_layout walks the tree
+
+std::size_t const sizes[] = {0, 1, 5, 300, 3000};
+
+template<typename Layout, typename Allocator = std::allocator<std::uint64_t>>
+using array_t = mkr::avl_array<std::uint64_t, Allocator, mkr::empty_number, mkr::empty_number, Layout>;
+
+// Width of a sequence of values for reduce() and search(): their sum, and
+// a polynomial hash that changes with the order, since combine() must
+// keep the left part first
+
+struct hash_t
+{
+	std::uint64_t sum;
+	std::uint64_t hash;
+	std::uint64_t power;
+};
+
+bool operator==(hash_t const & a, hash_t const & b)
+{
+	return a.sum == b.sum && a.hash == b.hash && a.power == b.power;
+}
+
+hash_t hash_of(std::uint64_t value)
+{
+	hash_t width = {value, value, 1000003};
+	return width;
+}
+
+namespace mkr { namespace detail {
+
+template<>
+struct monoid_traits<hash_t>
+{
+	static hash_t identity()
+	{
+		hash_t width = {0, 0, 1};
+		return width;
+	}
+
+	static hash_t element()
+	{
+		return hash_of(1);
+	}
+
+	static hash_t combine(hash_t const & a, hash_t const & b)
+	{
+		hash_t width = {a.sum + b.sum, a.hash * b.power + b.hash, a.power * b.power};
+		return width;
+	}
+};
+
+} }
+
+// Element that counts its copies and the objects alive. Moves leave the
+// source at moved_from, and copies throw once the count reaches
+// copy_limit (never with 0)
+
+struct counted_t
+{
+	static std::uint64_t const moved_from = ~std::uint64_t{0};
+	static std::size_t copies;
+	static std::size_t copy_limit;
+	static long alive;
+
+	std::uint64_t value;
+
+	counted_t(std::uint64_t value = 0) : value(value)
+	{
+		++alive;
+	}
+
+	counted_t(std::uint64_t high, std::uint64_t low) : value(high * 1000 + low)
+	{
+		++alive;
+	}
+
+	counted_t(counted_t const & other) : value(other.value)
+	{
+		if (++copies == copy_limit) throw std::runtime_error("copy");
+		++alive;
+	}
+
+	counted_t(counted_t && other) : value(other.value)
+	{
+		other.value = moved_from;
+		++alive;
+	}
+
+	~counted_t()
+	{
+		--alive;
+	}
+
+	counted_t & operator=(counted_t const & other)
+	{
+		value = other.value;
+		return *this;
+	}
+};
+
+std::size_t counted_t::copies = 0;
+std::size_t counted_t::copy_limit = 0;
+long counted_t::alive = 0;
+
+bool operator==(counted_t const & a, std::uint64_t b)
+{
+	return a.value == b;
+}
+
+// Forward iterator over values whose dereference throws at position
+// limit, so the data provider fails even when the elements can't
+
+struct throwing_iterator_t
+{
+	typedef std::forward_iterator_tag iterator_category;
+	typedef std::uint64_t value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef std::uint64_t const * pointer;
+	typedef std::uint64_t const & reference;
+
+	std::uint64_t const * position;
+	std::uint64_t const * limit;
+
+	reference operator*() const
+	{
+		if (position == limit) throw std::runtime_error("dereference");
+		return *position;
+	}
+
+	throwing_iterator_t & operator++()
+	{
+		++position;
+		return *this;
+	}
+
+	bool operator==(throwing_iterator_t const & other) const
+	{
+		return position == other.position;
+	}
+
+	bool operator!=(throwing_iterator_t const & other) const
+	{
+		return position != other.position;
+	}
+};
+
+// Compare the array against the reference both ways along the sequence,
+// and by position
+
+template<typename Array, typename T>
+void check_array(Array const & array, std::vector<T> const & reference)
+{
+	CHECK(array.size() == reference.size());
+	CHECK(array.empty() == reference.empty());
+	CHECK(array.size() != reference.size() || std::equal(array.begin(), array.end(), reference.begin()));
+	CHECK(array.size() != reference.size() || std::equal(array.rbegin(), array.rend(), reference.rbegin()));
+	CHECK(std::distance(array.begin(), array.end()) == static_cast<std::ptrdiff_t>(reference.size()));
+
+	bool same = true;
+	for (std::size_t I = 0; I != reference.size() && I != array.size(); ++I) same = same && array[I] == reference[I];
+	CHECK(same);
+}
+
+template<typename Layout>
+void test_basic(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	array_t<Layout> array;
+	std::vector<std::uint64_t> reference;
+	check_array(array, reference);
+
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto index = random_index(engine, reference.size());
+		switch (engine() % 6)
+		{
+		case 0:
+			array.push_back(I);
+			reference.push_back(I);
+			break;
+		case 1:
+			array.push_front(I);
+			reference.insert(reference.begin(), I);
+			break;
+		case 2:
+		{
+			auto n = engine() % 8;
+			array.insert(array.begin() + index, n, std::uint64_t(I));
+			reference.insert(reference.begin() + index, n, I);
+			break;
+		}
+		case 3:
+			if (index == reference.size()) break;
+			array.erase(array.begin() + index);
+			reference.erase(reference.begin() + index);
+			break;
+		default:
+			array.insert(array.begin() + index, I);
+			reference.insert(reference.begin() + index, I);
+			break;
+		}
+	}
+	check_array(array, reference);
+
+	// Ranges in, out, and in again in reverse
+	auto first = random_index(engine, reference.size());
+	auto last = first + random_index(engine, reference.size() - first);
+	std::vector<std::uint64_t> middle(reference.begin() + first, reference.begin() + last);
+	array.erase(array.begin() + first, array.begin() + last);
+	reference.erase(reference.begin() + first, reference.begin() + last);
+	check_array(array, reference);
+
+	auto index = random_index(engine, reference.size());
+	array.insert(array.begin() + index, middle.rbegin(), middle.rend());
+	reference.insert(reference.begin() + index, middle.rbegin(), middle.rend());
+	check_array(array, reference);
+
+	array_t<Layout> copy(array);
+	check_array(copy, reference);
+	copy.reverse();
+	std::reverse(reference.begin(), reference.end());
+	check_array(copy, reference);
+
+	copy = array;
+	std::reverse(reference.begin(), reference.end());
+	check_array(copy, reference);
+	CHECK(copy == array);
+
+	array.resize(reference.size() / 2);
+	reference.resize(reference.size() / 2);
+	check_array(array, reference);
+	array.resize(reference.size() + 10, 7);
+	reference.resize(reference.size() + 10, 7);
+	check_array(array, reference);
+
+	while (!reference.empty())
+	{
+		if (engine() % 2)
+		{
+			array.pop_back();
+			reference.pop_back();
+		}
+		else
+		{
+			array.pop_front();
+			reference.erase(reference.begin());
+		}
+	}
+	check_array(array, reference);
+}
+
+// A pool of its own for every layout, so clear() can release all the
+// nodes at once while only one array is alive, and falls back to freeing
+// them one by one while another array shares the pool
+
+template<typename Layout>
+void test_pool(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	typedef array_t<Layout, mkr::node_pool_allocator<std::uint64_t, Layout>> pool_array_t;
+	std::vector<std::uint64_t> reference;
+	{
+		pool_array_t array;
+		array.reserve(count);
+		for (std::size_t I = 0; I != count; ++I)
+		{
+			auto index = random_index(engine, reference.size());
+			if (I % 4 == 3 && index != reference.size())
+			{
+				array.erase(array.begin() + index);
+				reference.erase(reference.begin() + index);
+			}
+			else
+			{
+				array.insert(array.begin() + index, I);
+				reference.insert(reference.begin() + index, I);
+			}
+		}
+		check_array(array, reference);
+
+		// Freed nodes are handed out again
+		pool_array_t other(array);
+		check_array(other, reference);
+		array.clear();
+		check_array(array, std::vector<std::uint64_t>());
+		check_array(other, reference);
+
+		array.insert(array.end(), reference.begin(), reference.end());
+		other.clear();
+		check_array(array, reference);
+		check_array(other, std::vector<std::uint64_t>());
+
+		// Nodes move between arrays of the same pool
+		other.splice(other.end(), array);
+		check_array(other, reference);
+		check_array(array, std::vector<std::uint64_t>());
+
+		other.clear();
+		other.resize(count, 5);
+		check_array(other, std::vector<std::uint64_t>(count, 5));
+	}
+
+	// The destructor above gave all the nodes back
+	pool_array_t array(reference.begin(), reference.end());
+	check_array(array, reference);
+}
+
+// Nodes copied in sequence order and in van Emde Boas order, with and
+// without a pool to take them from a contiguous block. Iterators passed
+// to relayout() follow their nodes
+
+template<typename Array>
+void check_relayout(std::size_t count, std::uint64_t seed)
+{
+	typedef typename Array::iterator iterator;
+	std::mt19937_64 engine(seed);
+	Array array;
+	std::vector<std::uint64_t> reference;
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto index = random_index(engine, reference.size());
+		array.insert(array.begin() + index, I);
+		reference.insert(reference.begin() + index, I);
+	}
+
+	for (auto order : {Array::veb_order, Array::in_order, Array::veb_order})
+	{
+		std::vector<std::size_t> positions;
+		std::vector<iterator> iterators;
+		for (std::size_t I = 0; I != std::min<std::size_t>(count, 16); ++I)
+		{
+			positions.push_back(engine() % count);
+			iterators.push_back(array.begin() + positions.back());
+		}
+		iterators.push_back(array.end());
+
+		array.relayout(order, iterators.begin(), iterators.end());
+		check_array(array, reference);
+		CHECK(iterators.back() == array.end());
+		for (std::size_t I = 0; I != positions.size(); ++I)
+		{
+			CHECK(*iterators[I] == reference[positions[I]]);
+			CHECK(iterators[I] - array.begin() == static_cast<std::ptrdiff_t>(positions[I]));
+		}
+
+		// The new tree takes changes as usual
+		if (!positions.empty())
+		{
+			array.erase(iterators[0]);
+			reference.erase(reference.begin() + positions[0]);
+			array.insert(array.begin() + positions[0], count + positions[0]);
+			reference.insert(reference.begin() + positions[0], count + positions[0]);
+		}
+		check_array(array, reference);
+	}
+
+	array.relayout();
+	check_array(array, reference);
+}
+
+template<typename Layout>
+void test_relayout(std::size_t count, std::uint64_t seed)
+{
+	check_relayout<array_t<Layout>>(count, seed);
+	check_relayout<array_t<Layout, mkr::node_pool_allocator<std::uint64_t, Layout>>>(count, seed);
+}
+
+// Reverse iterator to the element at index, rend() for -1 (reverse
+// iterators refer to their element, not to its neighbour)
+
+template<typename Array>
+typename Array::reverse_iterator reverse_at(Array & array, std::ptrdiff_t index)
+{
+	return array.rbegin() + (static_cast<std::ptrdiff_t>(array.size()) - 1 - index);
+}
+
+// Group move in the reference: the range [from, to) lands before the
+// element at point, inverted if the source and destination iterators go
+// opposite ways. A point inside the range or at one of its ends leaves
+// the range where it is
+
+template<typename T>
+void move_reference(std::vector<T> & reference, std::size_t from, std::size_t to, std::size_t point, bool invert)
+{
+	std::vector<T> block(reference.begin() + from, reference.begin() + to);
+	if (invert) std::reverse(block.begin(), block.end());
+	if (point >= from && point <= to)
+	{
+		std::copy(block.begin(), block.end(), reference.begin() + from);
+		return;
+	}
+	reference.erase(reference.begin() + from, reference.begin() + to);
+	if (point > to) point -= to - from;
+	reference.insert(reference.begin() + point, block.begin(), block.end());
+}
+
+// Moves of single nodes, groups and ranges inside an array and between
+// two, with every mix of normal and reverse iterators, and split() and
+// join(). A reverse destination inserts right after its element
+
+template<typename Layout>
+void test_split_join(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	array_t<Layout> array;
+	std::vector<std::uint64_t> reference;
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		array.push_back(I);
+		reference.push_back(I);
+	}
+
+	for (std::size_t round = 0; round != 200 && count != 0; ++round)
+	{
+		auto size = reference.size();
+		auto at = engine() % size;
+		auto n = random_index(engine, std::min<std::size_t>(size, 64));
+		auto target = random_index(engine, size);
+		bool reverse_source = engine() % 2;
+		bool reverse_destination = engine() % 2;
+
+		// Straight range of the source and straight insertion point
+		auto from = reverse_source ? (n < at + 1 ? at + 1 - n : 0) : at;
+		auto to = reverse_source ? at + 1 : std::min(at + n, size);
+		auto point = target;
+		if (reverse_destination && target == size) point = 0;
+		else if (reverse_destination) point = target + 1;
+
+		switch (engine() % 4)
+		{
+		case 0:
+			if (reverse_source && reverse_destination) array.move(reverse_at(array, at), n, reverse_at(array, target == size ? -1 : target));
+			else if (reverse_source) array.move(reverse_at(array, at), n, array.begin() + target);
+			else if (reverse_destination) array.move(array.begin() + at, n, reverse_at(array, target == size ? -1 : target));
+			else array.move(array.begin() + at, n, array.begin() + target);
+			move_reference(reference, from, to, point, reverse_source != reverse_destination);
+			break;
+		case 1:
+			// The same, given as a range
+			n = to - from;
+			if (reverse_source && reverse_destination) array.move(reverse_at(array, at), reverse_at(array, at - n), reverse_at(array, target == size ? -1 : target));
+			else if (reverse_source) array.move(reverse_at(array, at), reverse_at(array, at - n), array.begin() + target);
+			else if (reverse_destination) array.move(array.begin() + at, array.begin() + at + n, reverse_at(array, target == size ? -1 : target));
+			else array.move(array.begin() + at, array.begin() + at + n, array.begin() + target);
+			move_reference(reference, from, to, point, reverse_source != reverse_destination);
+			break;
+		case 2:
+			// A single node, the source direction doesn't matter
+			if (reverse_destination) array.move(array.begin() + at, reverse_at(array, target == size ? -1 : target));
+			else array.move(reverse_at(array, at), array.begin() + target);
+			move_reference(reference, at, at + 1, point, false);
+			break;
+		default:
+		{
+			// Offset move, the sign is inverted for reverse iterators
+			auto offset = static_cast<std::ptrdiff_t>(engine() % size) - static_cast<std::ptrdiff_t>(at);
+			auto value = reference[at];
+			if (reverse_source) array.move(reverse_at(array, at), -offset);
+			else array.move(array.begin() + at, offset);
+			reference.erase(reference.begin() + at);
+			reference.insert(reference.begin() + (at + offset), value);
+			break;
+		}
+		}
+		check_array(array, reference);
+	}
+
+	// Cut in three and glued back in another order
+	auto first = random_index(engine, reference.size());
+	auto second = first + random_index(engine, reference.size() - first);
+	array_t<Layout> tail = array.split(array.begin() + second);
+	array_t<Layout> middle;
+	middle.push_back(count);
+	array.split(array.begin() + first, middle);
+	check_array(array, std::vector<std::uint64_t>(reference.begin(), reference.begin() + first));
+	check_array(middle, std::vector<std::uint64_t>(reference.begin() + first, reference.begin() + second));
+	check_array(tail, std::vector<std::uint64_t>(reference.begin() + second, reference.end()));
+
+	tail.join(array);
+	tail.join(middle);
+	std::rotate(reference.begin(), reference.begin() + second, reference.end());
+	check_array(tail, reference);
+	check_array(array, std::vector<std::uint64_t>());
+	check_array(middle, std::vector<std::uint64_t>());
+
+	// Between two arrays
+	auto at = random_index(engine, reference.size());
+	auto n = random_index(engine, reference.size() - at);
+	array.splice(array.end(), tail, tail.begin() + at, tail.begin() + at + n);
+	std::vector<std::uint64_t> moved(reference.begin() + at, reference.begin() + at + n);
+	reference.erase(reference.begin() + at, reference.begin() + at + n);
+	check_array(array, moved);
+	check_array(tail, reference);
+
+	if (!moved.empty())
+	{
+		auto index = engine() % moved.size();
+		auto target = random_index(engine, reference.size());
+		tail.splice(reverse_at(tail, static_cast<std::ptrdiff_t>(target) - 1), array, array.begin() + index);
+		reference.insert(reference.begin() + target, moved[index]);
+		moved.erase(moved.begin() + index);
+		check_array(array, moved);
+		check_array(tail, reference);
+	}
+
+	array.move(array.rbegin(), array.size(), reverse_at(tail, static_cast<std::ptrdiff_t>(reference.size()) - 1));
+	reference.insert(reference.end(), moved.begin(), moved.end());
+	check_array(array, std::vector<std::uint64_t>());
+	check_array(tail, reference);
+}
+
+// Threads to sort with, 0 is one per processor. Slices under 16384 nodes
+// are not worth a thread, so only the big array is sorted in parallel
+
+std::size_t const thread_counts[] = {0, 1, 2, 3, 8};
+
+// Parallel sort and stable_sort of the node pointers. Keys repeat, so
+// stable_sort must keep the order of equal keys. Iterators follow their
+// elements, and an exception from the comparison leaves the array as it
+// was
+
+template<typename Layout>
+void test_parallel_sort(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	auto by_key = [](std::uint64_t a, std::uint64_t b) { return a % 1024 < b % 1024; };
+	for (auto threads : thread_counts)
+	{
+		array_t<Layout> array;
+		std::vector<std::uint64_t> reference;
+		for (std::size_t I = 0; I != count; ++I)
+		{
+			reference.push_back(engine() % (count + 1));
+			array.push_back(reference.back());
+		}
+
+		auto held = count / 3;
+		auto iterator = array.begin() + held;
+		auto value = count == 0 ? 0 : reference[held];
+
+		array.stable_sort(by_key, threads);
+		std::stable_sort(reference.begin(), reference.end(), by_key);
+		check_array(array, reference);
+		CHECK(count == 0 || *iterator == value);
+
+		array.sort(std::greater<std::uint64_t>(), threads);
+		std::sort(reference.begin(), reference.end(), std::greater<std::uint64_t>());
+		check_array(array, reference);
+		CHECK(count == 0 || *iterator == value);
+
+		std::shuffle(reference.begin(), reference.end(), engine);
+		array.clear();
+		array.insert(array.end(), reference.begin(), reference.end());
+
+		std::size_t calls = 0;
+		bool thrown = false;
+		try
+		{
+			array.sort([&](std::uint64_t a, std::uint64_t b)
+			{
+				if (++calls == count) throw std::runtime_error("compare");
+				return a < b;
+			}, 1);
+		}
+		catch (std::runtime_error const &)
+		{
+			thrown = true;
+		}
+		CHECK(thrown == (count > 2));
+		if (thrown) check_array(array, reference);
+	}
+}
+
+// Compare the NPSV widths of the array, its total width, the position
+// of every element in the alternative sequence and the element found at
+// random positions with the widths of the reference
+
+template<typename Array>
+void check_widths(Array const & array, std::vector<long> const & widths, std::mt19937_64 & engine)
+{
+	std::vector<long> starts(1, 0);
+	for (auto width : widths) starts.push_back(starts.back() + width);
+	CHECK(array.npsv_width() == starts.back());
+	if (array.size() != widths.size()) return;
+
+	bool same = true;
+	auto it = array.begin();
+	for (std::size_t I = 0; I != widths.size(); ++I, ++it)
+	{
+		same = same && array.npsv_width(it) == widths[I] && array.npsv_pos_of(it) == starts[I];
+	}
+	CHECK(same);
+
+	for (std::size_t I = 0; I != 16 && !widths.empty(); ++I)
+	{
+		long pos = engine() % starts.back();
+		auto index = std::upper_bound(starts.begin(), starts.end(), pos) - starts.begin() - 1;
+		CHECK(array.npsv_at_pos(pos) - array.begin() == index);
+	}
+	CHECK(array.npsv_at_pos(starts.back()) == array.end());
+}
+
+// Widths changed eagerly and lazily, a few at a time (their paths are
+// climbed from the dirty list) and many at a time (all the sums are
+// recomputed), with inserts, erases, swaps and moves in between
+
+template<typename Layout>
+void test_npsv(std::size_t count, std::uint64_t seed)
+{
+	typedef mkr::avl_array<std::uint64_t, std::allocator<std::uint64_t>, long, mkr::empty_number, Layout> npsv_array_t;
+	std::mt19937_64 engine(seed);
+	npsv_array_t array;
+	std::vector<std::uint64_t> reference;
+	std::vector<long> widths;
+	check_widths(array, widths, engine);
+
+	for (std::size_t round = 0; round != 40; ++round)
+	{
+		auto size = reference.size();
+		switch (engine() % 5)
+		{
+		case 0:
+		case 1:
+		{
+			// Lazy, then read back
+			auto changes = engine() % 2 ? std::size_t{3} : size;
+			for (std::size_t I = 0; I != changes && size != 0; ++I)
+			{
+				auto index = engine() % size;
+				long width = 1 + engine() % 9;
+				array.npsv_set_width(array.begin() + index, width, false);
+				widths[index] = width;
+			}
+			break;
+		}
+		case 2:
+		{
+			auto index = random_index(engine, size);
+			auto n = engine() % (count / 4 + 2);
+			array.insert(array.begin() + index, n, std::uint64_t(round));
+			reference.insert(reference.begin() + index, n, round);
+			widths.insert(widths.begin() + index, n, 1);
+			break;
+		}
+		case 3:
+			if (size < 2) break;
+			else
+			{
+				auto a = engine() % size;
+				auto b = engine() % size;
+				if (engine() % 2)
+				{
+					npsv_array_t::swap(array.begin() + a, array.begin() + b);
+					std::swap(reference[a], reference[b]);
+					std::swap(widths[a], widths[b]);
+				}
+				else
+				{
+					auto last = std::min(size, a + 1 + engine() % 8);
+					array.erase(array.begin() + a, array.begin() + last);
+					reference.erase(reference.begin() + a, reference.begin() + last);
+					widths.erase(widths.begin() + a, widths.begin() + last);
+				}
+			}
+			break;
+		default:
+			if (size == 0) break;
+			else
+			{
+				auto index = engine() % size;
+				long width = 1 + engine() % 9;
+				array.npsv_set_width(array.begin() + index, width);
+				widths[index] = width;
+				auto target = random_index(engine, size);
+				npsv_array_t::move(array.begin() + index, array.begin() + target);
+				move_reference(reference, index, index + 1, target, false);
+				move_reference(widths, index, index + 1, target, false);
+			}
+			break;
+		}
+
+		check_array(array, reference);
+		check_widths(array, widths, engine);
+	}
+}
+
+// Widths of a monoid that isn't a number. reduce() of random ranges and
+// search() for the first prefix whose sum passes a bound are compared
+// with the values of the reference, with widths set eagerly and lazily
+
+template<typename Layout>
+void test_reduce(std::size_t count, std::uint64_t seed)
+{
+	typedef mkr::monoid_traits<hash_t> traits;
+	typedef mkr::avl_array<std::uint64_t, std::allocator<std::uint64_t>, hash_t, mkr::empty_number, Layout> hash_array_t;
+	std::mt19937_64 engine(seed);
+	hash_array_t array;
+	std::vector<std::uint64_t> reference;
+
+	auto reduce = [&](std::size_t first, std::size_t last)
+	{
+		auto width = traits::identity();
+		for (auto I = first; I != last; ++I) width = traits::combine(width, hash_of(reference[I]));
+		return width;
+	};
+
+	for (std::size_t round = 0; round != 40; ++round)
+	{
+		auto index = random_index(engine, reference.size());
+		if (round % 4 == 0 || reference.empty())
+		{
+			// New elements get the width of 1
+			auto n = engine() % (count / 4 + 2);
+			array.insert(array.begin() + index, n, std::uint64_t(1));
+			reference.insert(reference.begin() + index, n, 1);
+		}
+		else if (round % 4 == 1 && index != reference.size())
+		{
+			array.erase(array.begin() + index);
+			reference.erase(reference.begin() + index);
+		}
+		else
+		{
+			bool lazy = engine() % 2;
+			auto changes = engine() % 2 ? std::size_t{3} : reference.size();
+			for (std::size_t I = 0; I != changes; ++I)
+			{
+				auto position = engine() % reference.size();
+				auto value = engine() % 100;
+				array[position] = value;
+				array.set_width(array.begin() + position, hash_of(value), !lazy);
+				reference[position] = value;
+			}
+		}
+		check_array(array, reference);
+
+		for (std::size_t I = 0; I != 8; ++I)
+		{
+			auto first = random_index(engine, reference.size());
+			auto last = first + random_index(engine, reference.size() - first);
+			CHECK(array.reduce(array.begin() + first, array.begin() + last) == reduce(first, last));
+		}
+		CHECK(array.reduce(array.begin(), array.end()) == reduce(0, reference.size()));
+
+		auto total = reduce(0, reference.size()).sum;
+		auto bound = engine() % (total + 2);
+		std::size_t expected = 0;
+		for (std::uint64_t sum = 0; expected != reference.size(); ++expected)
+		{
+			sum += reference[expected];
+			if (sum > bound) break;
+		}
+		auto found = static_cast<hash_array_t const &>(array).search([&](hash_t const & width) { return width.sum > bound; });
+		CHECK(found - array.begin() == static_cast<std::ptrdiff_t>(expected));
+		CHECK(array.search([&](hash_t const & width) { return width.sum > bound; }) == array.begin() + expected);
+	}
+}
+
+// Elements moved in and built in place, and whole arrays moved, without
+// a single copy
+
+template<typename Layout>
+void test_move(std::size_t count, std::uint64_t seed)
+{
+	typedef mkr::avl_array<counted_t, std::allocator<counted_t>, mkr::empty_number, mkr::empty_number, Layout> counted_array_t;
+	std::mt19937_64 engine(seed);
+	counted_array_t array;
+	std::vector<std::uint64_t> reference;
+	counted_t::copies = 0;
+
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto index = random_index(engine, reference.size());
+		counted_t element(I);
+		switch (engine() % 6)
+		{
+		case 0:
+			array.push_back(std::move(element));
+			reference.push_back(I);
+			break;
+		case 1:
+			array.push_front(std::move(element));
+			reference.insert(reference.begin(), I);
+			break;
+		case 2:
+			CHECK(array.emplace_back(I, 1).value == I * 1000 + 1);
+			reference.push_back(I * 1000 + 1);
+			break;
+		case 3:
+			CHECK(array.emplace_front(I).value == I);
+			reference.insert(reference.begin(), I);
+			break;
+		case 4:
+			CHECK(array.emplace(array.begin() + index, I, 2)->value == I * 1000 + 2);
+			reference.insert(reference.begin() + index, I * 1000 + 2);
+			break;
+		default:
+			// Before the element of a reverse iterator is after it in
+			// sequence order
+			if (index == 0)
+			{
+				CHECK(*array.insert(array.begin(), std::move(element)) == I);
+				reference.insert(reference.begin(), I);
+			}
+			else
+			{
+				CHECK(*array.insert(reverse_at(array, index - 1), std::move(element)) == I);
+				reference.insert(reference.begin() + index, I);
+			}
+			break;
+		}
+		CHECK(element.value == counted_t::moved_from || element.value == I);
+	}
+	check_array(array, reference);
+	CHECK(counted_t::copies == 0);
+
+	std::vector<counted_t> source(reference.begin(), reference.end());
+	counted_t::copies = 0;
+	auto index = random_index(engine, reference.size());
+	array.insert(array.begin() + index, std::make_move_iterator(source.begin()), std::make_move_iterator(source.end()));
+	reference.insert(reference.begin() + index, reference.begin(), reference.end());
+	check_array(array, reference);
+	CHECK(std::all_of(source.begin(), source.end(), [](counted_t const & element) { return element.value == counted_t::moved_from; }));
+	CHECK(counted_t::copies == 0);
+
+	std::vector<counted_t> more(count, counted_t(7));
+	counted_t::copies = 0;
+	counted_array_t built(std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+	check_array(built, std::vector<std::uint64_t>(count, 7));
+
+	// The tree changes hands, iterators follow it
+	auto first = array.begin();
+	counted_array_t moved(std::move(array));
+	check_array(moved, reference);
+	check_array(array, std::vector<std::uint64_t>());
+	CHECK(reference.empty() || first == moved.begin());
+
+	built = std::move(moved);
+	check_array(built, reference);
+	check_array(moved, std::vector<std::uint64_t>());
+	CHECK(counted_t::copies == 0);
+}
+
+// Run operation, which must throw, and check that the array is left
+// as it was
+
+template<typename Array, typename Operation>
+void check_rollback(Array const & array, std::vector<std::uint64_t> const & reference, Operation operation)
+{
+	bool thrown = false;
+	try
+	{
+		operation();
+	}
+	catch (std::runtime_error const &)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+	check_array(array, reference);
+}
+
+// Bulk inserts and copies of elements whose copy constructor throws
+// halfway go through rollback_list and leave everything as it was.
+// Elements that can't throw take the fast path, where only the data
+// provider can fail, and that rolls back as well
+
+template<typename Layout>
+void test_rollback(std::size_t count, std::uint64_t seed)
+{
+	typedef mkr::avl_array<counted_t, std::allocator<counted_t>, mkr::empty_number, mkr::empty_number, Layout> counted_array_t;
+	std::mt19937_64 engine(seed);
+	std::vector<std::uint64_t> reference;
+	for (std::size_t I = 0; I != count; ++I) reference.push_back(engine() % 1000);
+
+	auto alive = counted_t::alive;
+	{
+		std::vector<counted_t> source(reference.begin(), reference.end());
+		counted_array_t array(source.begin(), source.end());
+		counted_t const element(5);
+		auto index = random_index(engine, count);
+		auto fail = [&](std::size_t copies)
+		{
+			counted_t::copies = 0;
+			counted_t::copy_limit = copies;
+		};
+
+		fail(count / 2 + 2);
+		check_rollback(array, reference, [&] { array.insert(array.begin() + index, count + 2, element); });
+		fail(count / 2 + 2);
+		check_rollback(array, reference, [&] { array.resize(2 * count + 2, element); });
+		fail(1);
+		check_rollback(array, reference, [&] { array.insert(array.begin() + index, element); });
+		fail(1);
+		check_rollback(array, reference, [&] { array.push_front(element); });
+		if (count != 0)
+		{
+			fail(count / 2 + 1);
+			check_rollback(array, reference, [&] { array.insert(reverse_at(array, static_cast<std::ptrdiff_t>(index) - 1), source.begin(), source.end()); });
+			fail(count / 2 + 1);
+			check_rollback(array, reference, [&] { counted_array_t copy(array); });
+			fail(count / 2 + 1);
+			check_rollback(array, reference, [&] { counted_array_t built(count, element); });
+		}
+
+		// relayout() copies the elements too, iterators stay where they were
+		std::vector<typename counted_array_t::iterator> iterators(1, array.begin() + index);
+		if (count != 0)
+		{
+			fail(count / 2 + 1);
+			check_rollback(array, reference, [&] { array.relayout(counted_array_t::veb_order, iterators.begin(), iterators.end()); });
+		}
+		CHECK(iterators[0] == array.begin() + index);
+		counted_t::copy_limit = 0;
+	}
+	CHECK(counted_t::alive == alive);
+
+	array_t<Layout> array(reference.begin(), reference.end());
+	auto index = random_index(engine, count);
+	throwing_iterator_t first = {reference.data(), reference.data() + count / 2};
+	throwing_iterator_t last = {reference.data() + count, nullptr};
+	if (count == 0) return;
+	check_rollback(array, reference, [&] { array.insert(array.begin() + index, first, last); });
+	check_rollback(array, reference, [&] { array_t<Layout> built(first, last); });
+
+	array_t<Layout, mkr::node_pool_allocator<std::uint64_t, Layout>> pooled(reference.begin(), reference.end());
+	check_rollback(pooled, reference, [&] { pooled.insert(pooled.end(), first, last); });
+}
+
+// remove_if() and erase_positions() with few matches (erased one by one)
+// and many (one pass over the list and a rebuild). Iterators to the
+// elements left stay valid, a predicate that throws still erases what
+// it matched before, and lazy NPSV widths come out right
+
+template<typename Layout>
+void test_remove_if(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	for (std::size_t modulo : {1, 2, 7, 97})
+	{
+		array_t<Layout> array;
+		std::vector<std::uint64_t> reference;
+		for (std::size_t I = 0; I != count; ++I)
+		{
+			reference.push_back(engine() % 1000);
+			array.push_back(reference.back());
+		}
+
+		auto kept = std::find_if(reference.begin(), reference.end(), [&](std::uint64_t value) { return value % modulo != 0; }) - reference.begin();
+		auto iterator = array.begin() + kept;
+		auto matches = [&](std::uint64_t value) { return value % modulo == 0; };
+		auto removed = array.remove_if(matches);
+		auto last = std::remove_if(reference.begin(), reference.end(), matches);
+		CHECK(removed == static_cast<std::size_t>(reference.end() - last));
+		reference.erase(last, reference.end());
+		check_array(array, reference);
+		CHECK(iterator == array.end() || *iterator % modulo != 0);
+		CHECK(iterator == array.end() || iterator - array.begin() == 0);
+
+		// Positions as they were before the call, sorted, with repeats
+		std::vector<std::size_t> positions;
+		for (std::size_t I = 0; I != reference.size(); ++I)
+		{
+			if (engine() % modulo == 0) positions.push_back(I);
+			if (!positions.empty() && engine() % 5 == 0) positions.push_back(positions.back());
+		}
+		std::vector<std::uint64_t> left;
+		for (std::size_t I = 0, next = 0; I != reference.size(); ++I)
+		{
+			while (next != positions.size() && positions[next] < I) ++next;
+			if (next == positions.size() || positions[next] != I) left.push_back(reference[I]);
+		}
+		CHECK(array.erase_positions(positions.begin(), positions.end()) == reference.size() - left.size());
+		reference = left;
+		check_array(array, reference);
+
+		// The predicate throws halfway
+		std::size_t calls = 0;
+		bool thrown = false;
+		try
+		{
+			array.remove_if([&](std::uint64_t value)
+			{
+				if (++calls == reference.size() / 2 + 1) throw std::runtime_error("predicate");
+				return value % 2 == 0;
+			});
+		}
+		catch (std::runtime_error const &)
+		{
+			thrown = true;
+		}
+		CHECK(thrown || reference.empty());
+		std::vector<std::uint64_t> expected;
+		for (std::size_t I = 0; I != reference.size(); ++I)
+		{
+			if (I >= reference.size() / 2 || reference[I] % 2 != 0) expected.push_back(reference[I]);
+		}
+		check_array(array, expected);
+	}
+
+	// Lazy widths pending while elements go away
+	typedef mkr::avl_array<std::uint64_t, std::allocator<std::uint64_t>, long, mkr::empty_number, Layout> npsv_array_t;
+	npsv_array_t array;
+	std::vector<std::uint64_t> reference;
+	std::vector<long> widths;
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		reference.push_back(I);
+		widths.push_back(1 + engine() % 9);
+		array.push_back(I);
+		array.npsv_set_width(array.end() - 1, widths.back(), false);
+	}
+	for (std::size_t I = 0; I != 3 && count != 0; ++I)
+	{
+		auto index = engine() % count;
+		widths[index] = 1 + engine() % 9;
+		array.npsv_set_width(array.begin() + index, widths[index], false);
+	}
+	array.remove_if([](std::uint64_t value) { return value % 3 == 0; });
+	std::vector<long> kept;
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		if (I % 3 != 0) kept.push_back(widths[I]);
+	}
+	reference.erase(std::remove_if(reference.begin(), reference.end(), [](std::uint64_t value) { return value % 3 == 0; }), reference.end());
+	check_array(array, reference);
+	check_widths(array, kept, engine);
+}
+
+template<typename Layout>
+void test_layout(std::uint64_t & seed)
+{
+	for (auto count : sizes)
+	{
+		test_basic<Layout>(count, seed++);
+		test_pool<Layout>(count, seed++);
+		test_relayout<Layout>(count, seed++);
+		test_split_join<Layout>(count, seed++);
+		test_parallel_sort<Layout>(count, seed++);
+		test_npsv<Layout>(count, seed++);
+		test_reduce<Layout>(count, seed++);
+		test_move<Layout>(count, seed++);
+		test_rollback<Layout>(count, seed++);
+		test_remove_if<Layout>(count, seed++);
+	}
+	test_parallel_sort<Layout>(100000, seed++);
+}
+
+int main()
+{
+	std::uint64_t seed = 1;
+	test_layout<mkr::threaded_layout>(seed);
+	test_layout<mkr::compact_layout>(seed);
+
+	// The count of compact_layout is 32 bits wide
+	CHECK(array_t<mkr::compact_layout>::max_size() <= 0xffffffffu);
+	return report("test_avl_array");
+}
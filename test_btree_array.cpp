@@ -0,0 +1,446 @@
+#include "btree_array.hpp"
+#include "btree_payload_array.hpp"
+#include "test.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// An element large enough for btree_auto_array_t to store it out of line
+
+struct record_t
+{
+	std::uint64_t key;
+	char padding[120];
+};
+
+bool operator==(record_t const & left, record_t const & right)
+{
+	return left.key == right.key && std::memcmp(left.padding, right.padding, sizeof(left.padding)) == 0;
+}
+
+bool operator<(record_t const & left, record_t const & right)
+{
+	return left.key < right.key;
+}
+
+std::uint64_t key(std::uint64_t value)
+{
+	return value;
+}
+
+std::uint64_t key(record_t const & value)
+{
+	return value.key;
+}
+
+template<typename T>
+T make(std::uint64_t key);
+
+template<>
+std::uint64_t make<std::uint64_t>(std::uint64_t key)
+{
+	return key;
+}
+
+template<>
+record_t make<record_t>(std::uint64_t key)
+{
+	record_t record;
+	record.key = key;
+	std::memset(record.padding, static_cast<int>(key & 0x7f), sizeof(record.padding));
+	return record;
+}
+
+std::size_t const thread_counts[] = {0, 1, 2, 3, 8};
+
+// Compare the array against the reference element by element
+
+template<typename Array, typename T>
+void check_equal(Array const & array, std::vector<T> const & reference)
+{
+	CHECK(array.size() == reference.size());
+
+	std::size_t index = 0;
+	bool same = true;
+	array.iterate([&](T const * data, std::size_t size)
+	{
+		CHECK(size != 0);
+		for (std::size_t I = 0; I != size; ++I)
+		{
+			if (index == reference.size() || !(data[I] == reference[index])) same = false;
+			++index;
+		}
+	});
+	CHECK(same);
+	CHECK(index == reference.size());
+
+	same = true;
+	for (std::size_t I = 0; I != reference.size(); ++I)
+	{
+		if (!(array.get(I) == reference[I])) same = false;
+	}
+	CHECK(same);
+
+	if (reference.empty()) return;
+	CHECK(array.front() == reference.front());
+	CHECK(array.back() == reference.back());
+}
+
+// Insert count elements at random positions, keys are drawn from [0, keys)
+
+template<typename Array, typename T>
+void fill(Array & array, std::vector<T> & reference, std::size_t count, std::uint64_t keys, std::mt19937_64 & engine)
+{
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto index = random_index(engine, reference.size());
+		auto value = make<T>(engine() % keys);
+		array.insert(index, value);
+		reference.insert(reference.begin() + index, value);
+	}
+}
+
+template<typename Array, typename T>
+void test_empty()
+{
+	Array array;
+	std::vector<T> reference;
+	check_equal(array, reference);
+	auto value = make<T>(1);
+
+	auto any = [](T const &) { return true; };
+	CHECK(array.find(value) == 0);
+	CHECK(array.find(value, 5) == 0);
+	CHECK(array.find_if(any) == 0);
+	CHECK(array.count(value) == 0);
+	CHECK(array.count_if(any) == 0);
+	for (auto threads : thread_counts)
+	{
+		CHECK(array.parallel_find(value, threads) == 0);
+		CHECK(array.parallel_find_if(any, threads) == 0);
+		CHECK(array.parallel_count(value, threads) == 0);
+		CHECK(array.parallel_count_if(any, threads) == 0);
+	}
+
+	array.sort();
+	array.stable_sort();
+	check_equal(array, reference);
+
+	array.compact();
+	CHECK(array.compact_step(1));
+	check_equal(array, reference);
+
+	array.get_batch(nullptr, 0, nullptr);
+
+	array.gather(nullptr, 0, nullptr);
+
+	// Emptied by popping, then reused
+	array.push_back(value);
+	array.pop_front();
+	array.push_front(value);
+	array.pop_back();
+	check_equal(array, reference);
+	array.push_back(value);
+	reference.push_back(value);
+	check_equal(array, reference);
+}
+
+// Random pushes and pops at both ends mixed with inserts
+
+template<typename Array, typename T>
+void test_ends(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	Array array;
+	std::vector<T> reference;
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto value = make<T>(I);
+		auto operation = engine() % 8;
+		if (reference.empty() || operation < 2)
+		{
+			array.push_back(value);
+			reference.push_back(value);
+		}
+		else if (operation < 4)
+		{
+			array.push_front(value);
+			reference.insert(reference.begin(), value);
+		}
+		else if (operation == 4)
+		{
+			array.pop_back();
+			reference.pop_back();
+		}
+		else if (operation == 5)
+		{
+			array.pop_front();
+			reference.erase(reference.begin());
+		}
+		else
+		{
+			auto index = random_index(engine, reference.size());
+			array.insert(index, value);
+			reference.insert(reference.begin() + index, value);
+		}
+
+		CHECK(array.size() == reference.size());
+		if (!reference.empty())
+		{
+			CHECK(array.front() == reference.front());
+			CHECK(array.back() == reference.back());
+		}
+	}
+	check_equal(array, reference);
+
+	// Drain from alternating ends
+	while (!reference.empty())
+	{
+		if (reference.size() % 2)
+		{
+			array.pop_back();
+			reference.pop_back();
+		}
+		else
+		{
+			array.pop_front();
+			reference.erase(reference.begin());
+		}
+	}
+	check_equal(array, reference);
+}
+
+// find, count and their parallel forms, for every key present and for one
+// that is absent, starting from positions spread across the leaves
+
+template<typename Array, typename T>
+void test_search(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	Array array;
+	std::vector<T> reference;
+	std::uint64_t const keys = 16;
+	fill(array, reference, count, keys, engine);
+
+	auto size = reference.size();
+	auto step = size / 37 + 1;
+	for (std::uint64_t key = 0; key != keys + 1; ++key)
+	{
+		auto value = make<T>(key == keys ? 1000 : key);
+		auto expected = static_cast<std::size_t>(std::count(reference.begin(), reference.end(), value));
+		CHECK(array.count(value) == expected);
+
+		for (std::size_t from = 0; from <= size + step; from += step)
+		{
+			auto first = reference.begin() + (from < size ? from : size);
+			auto index = static_cast<std::size_t>(std::find(first, reference.end(), value) - reference.begin());
+			CHECK(array.find(value, from) == index);
+		}
+
+		auto first = static_cast<std::size_t>(std::find(reference.begin(), reference.end(), value) - reference.begin());
+		for (auto threads : thread_counts)
+		{
+			CHECK(array.parallel_find(value, threads) == first);
+			CHECK(array.parallel_count(value, threads) == expected);
+		}
+	}
+
+	auto odd = [](T const & value) { return key(value) % 2 == 1; };
+	auto none = [](T const & value) { return key(value) >= keys; };
+	auto odd_count = static_cast<std::size_t>(std::count_if(reference.begin(), reference.end(), odd));
+	auto odd_first = static_cast<std::size_t>(std::find_if(reference.begin(), reference.end(), odd) - reference.begin());
+	CHECK(array.count_if(odd) == odd_count);
+	CHECK(array.count_if(none) == 0);
+	CHECK(array.find_if(none) == size);
+	for (std::size_t from = 0; from <= size + step; from += step)
+	{
+		auto first = reference.begin() + (from < size ? from : size);
+		auto index = static_cast<std::size_t>(std::find_if(first, reference.end(), odd) - reference.begin());
+		CHECK(array.find_if(odd, from) == index);
+	}
+	for (auto threads : thread_counts)
+	{
+		CHECK(array.parallel_find_if(odd, threads) == odd_first);
+		CHECK(array.parallel_find_if(none, threads) == size);
+		CHECK(array.parallel_count_if(odd, threads) == odd_count);
+		CHECK(array.parallel_count_if(none, threads) == 0);
+	}
+}
+
+// Keys carry a group in their upper digits and a unique serial below, so
+// a stable sort by group is checked against std::stable_sort
+
+template<typename Array, typename T>
+void test_sort(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	auto by_group = [](T const & left, T const & right) { return key(left) / 1000000 < key(right) / 1000000; };
+	auto descending = [](T const & left, T const & right) { return key(right) < key(left); };
+
+	for (auto threads : thread_counts)
+	{
+		Array array;
+		std::vector<T> reference;
+		for (std::size_t I = 0; I != count; ++I)
+		{
+			auto index = random_index(engine, reference.size());
+			auto value = make<T>(engine() % 8 * 1000000 + I);
+			array.insert(index, value);
+			reference.insert(reference.begin() + index, value);
+		}
+
+		array.stable_sort(by_group, threads);
+		std::stable_sort(reference.begin(), reference.end(), by_group);
+		check_equal(array, reference);
+
+		array.sort(descending, threads);
+		std::sort(reference.begin(), reference.end(), descending);
+		check_equal(array, reference);
+
+		array.sort(std::less<T>(), threads);
+		std::sort(reference.begin(), reference.end());
+		check_equal(array, reference);
+
+		// The sorted tree still takes inserts at both ends and inside
+		fill(array, reference, 20, 1 << 20, engine);
+		array.push_front(make<T>(1));
+		reference.insert(reference.begin(), make<T>(1));
+		check_equal(array, reference);
+	}
+}
+
+// compact at several fill factors, and compact_step with a small budget,
+// including a pass that restarts because the array changed
+
+template<typename Array, typename T>
+void test_compact(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	Array array;
+	std::vector<T> reference;
+	fill(array, reference, count, 1 << 20, engine);
+
+	for (auto fill_factor : {1.0, 0.75, 0.5, 0.1})
+	{
+		array.compact(fill_factor);
+		check_equal(array, reference);
+		fill(array, reference, 10, 1 << 20, engine);
+		check_equal(array, reference);
+	}
+
+	std::size_t steps = 0;
+	while (!array.compact_step(7, 0.9))
+	{
+		++steps;
+		check_equal(array, reference);
+	}
+	CHECK(steps == (reference.size() - 1) / 7);
+	check_equal(array, reference);
+
+	if (reference.size() > 7)
+	{
+		CHECK(!array.compact_step(3));
+		fill(array, reference, 1, 1 << 20, engine);
+		array.pop_front();
+		reference.erase(reference.begin());
+		while (!array.compact_step(5)) {}
+		check_equal(array, reference);
+	}
+
+	fill(array, reference, 50, 1 << 20, engine);
+	array.push_back(make<T>(2));
+	reference.push_back(make<T>(2));
+	array.pop_front();
+	reference.erase(reference.begin());
+	check_equal(array, reference);
+}
+
+// get_batch on random indices with repeats, and on every index once so
+// each leaf boundary is crossed
+
+template<typename Array, typename T>
+void test_get_batch(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	Array array;
+	std::vector<T> reference;
+	fill(array, reference, count, 1 << 20, engine);
+	if (count == 0) return;
+
+	for (std::size_t batch : {std::size_t(1), std::size_t(7), count, count * 3})
+	{
+		std::vector<std::size_t> indices(batch);
+		for (auto & index : indices) index = engine() % count;
+		std::vector<T> out(batch);
+		array.get_batch(indices.data(), batch, out.data());
+		bool same = true;
+		for (std::size_t I = 0; I != batch; ++I) same = same && out[I] == reference[indices[I]];
+		CHECK(same);
+	}
+
+	std::vector<std::size_t> all(count);
+	for (std::size_t I = 0; I != count; ++I) all[I] = I;
+	std::vector<T> out(count);
+	array.get_batch(all.data(), count, out.data());
+	CHECK(out == reference);
+}
+
+// gather on sorted indices with repeats, and on every index once
+
+template<typename Array, typename T>
+void test_gather(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	Array array;
+	std::vector<T> reference;
+	fill(array, reference, count, 1 << 20, engine);
+	if (count == 0) return;
+
+	for (std::size_t batch : {std::size_t(1), std::size_t(7), count, count * 3})
+	{
+		std::vector<std::size_t> indices(batch);
+		for (auto & index : indices) index = engine() % count;
+		std::sort(indices.begin(), indices.end());
+		std::vector<T> out(batch);
+		array.gather(indices.data(), batch, out.data());
+		bool same = true;
+		for (std::size_t I = 0; I != batch; ++I) same = same && out[I] == reference[indices[I]];
+		CHECK(same);
+	}
+
+	std::vector<std::size_t> all(count);
+	for (std::size_t I = 0; I != count; ++I) all[I] = I;
+	std::vector<T> out(count);
+	array.gather(all.data(), count, out.data());
+	CHECK(out == reference);
+}
+
+// Sizes cover an empty tree, a single leaf and trees several levels deep
+
+template<typename Array, typename T>
+void test_all()
+{
+	test_empty<Array, T>();
+	std::uint64_t seed = 1;
+	for (std::size_t count : {0, 1, 5, 300, 3000})
+	{
+		test_ends<Array, T>(count, seed++);
+		test_search<Array, T>(count, seed++);
+		test_sort<Array, T>(count, seed++);
+		test_compact<Array, T>(count, seed++);
+		test_get_batch<Array, T>(count, seed++);
+		test_gather<Array, T>(count, seed++);
+	}
+}
+
+int main()
+{
+	test_all<btree_array_t<std::uint64_t, 64, 64>, std::uint64_t>();
+	test_all<btree_array_t<std::uint64_t>, std::uint64_t>();
+	test_all<btree_compact_array_t<std::uint64_t, 64, 64>, std::uint64_t>();
+	test_all<btree_payload_array_t<record_t, 64, 64>, record_t>();
+	test_all<btree_auto_array_t<record_t, 64, 64, 64>, record_t>();
+	test_all<btree_auto_array_t<std::uint64_t, 64, 64, 64>, std::uint64_t>();
+	return report("test_btree_array");
+}
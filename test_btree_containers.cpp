@@ -0,0 +1,543 @@
+#include "btree_buffered_array.hpp"
+#include "btree_rle_array.hpp"
+#include "btree_bit_vector.hpp"
+#include "btree_handle_array.hpp"
+#include "btree_lazy_array.hpp"
+#include "btree_columns.hpp"
+#include "btree_blob_array.hpp"
+#include "test.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Every container is checked against a std::vector with the same history.
+// Node sizes are kept small so a few thousand elements span several
+// levels, and each test also runs on an empty tree and a single leaf
+
+std::size_t const sizes[] = {0, 1, 5, 300, 3000};
+
+// Compare the runs handed out by iterate(functor(data, size)) with the
+// reference
+
+template<typename Array, typename T>
+void check_runs(Array const & array, std::vector<T> const & reference)
+{
+	std::size_t index = 0;
+	bool same = true;
+	array.iterate([&](T const * data, std::size_t size)
+	{
+		CHECK(size != 0);
+		for (std::size_t I = 0; I != size; ++I)
+		{
+			if (index == reference.size() || data[I] != reference[index]) same = false;
+			++index;
+		}
+	});
+	CHECK(same);
+	CHECK(index == reference.size());
+}
+
+void test_buffered(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	btree_buffered_array_t<std::uint64_t, 128, 64, 4> array;
+	std::vector<std::uint64_t> reference;
+	check_runs(array, reference);
+
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto index = random_index(engine, reference.size());
+		array.insert(index, I);
+		reference.insert(reference.begin() + index, I);
+
+		// Reads apply the inserts still pending in the buffers
+		if (I % 97 == 0)
+		{
+			auto probe = engine() % reference.size();
+			CHECK(array.get(probe) == reference[probe]);
+		}
+	}
+
+	CHECK(array.size() == reference.size());
+	bool same = true;
+	for (std::size_t I = 0; I != reference.size(); ++I) same = same && array.get(I) == reference[I];
+	CHECK(same);
+	check_runs(array, reference);
+}
+
+void test_rle(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	btree_rle_array_t<int, 64, 128> array;
+	std::vector<int> reference;
+
+	array.insert(0, 0, 7);
+	CHECK(array.size() == 0);
+	array.iterate([&](int, std::size_t) { CHECK(false); });
+
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto index = random_index(engine, reference.size());
+		auto value = static_cast<int>(engine() % 4);
+		if (I % 3 == 0)
+		{
+			array.insert(index, value);
+			reference.insert(reference.begin() + index, value);
+		}
+		else
+		{
+			auto run = 1 + engine() % 5;
+			array.insert(index, run, value);
+			reference.insert(reference.begin() + index, run, value);
+		}
+	}
+
+	CHECK(array.size() == reference.size());
+	bool same = true;
+	for (std::size_t I = 0; I != reference.size(); ++I) same = same && array.get(I) == reference[I];
+	CHECK(same);
+
+	std::size_t index = 0;
+	same = true;
+	array.iterate([&](int value, std::size_t run)
+	{
+		CHECK(run != 0);
+		for (std::size_t I = 0; I != run; ++I)
+		{
+			if (index == reference.size() || value != reference[index]) same = false;
+			++index;
+		}
+	});
+	CHECK(same);
+	CHECK(index == reference.size());
+}
+
+// rank1 and select1 are checked at every position
+
+void check_bits(btree_bit_vector_t<256, 64> const & bits, std::vector<bool> const & reference)
+{
+	CHECK(bits.size() == reference.size());
+	std::size_t ones = 0;
+	bool same = true;
+	for (std::size_t I = 0; I != reference.size(); ++I)
+	{
+		same = same && bits.get(I) == reference[I];
+		same = same && bits.rank1(I) == ones;
+		if (reference[I])
+		{
+			same = same && bits.select1(ones) == I;
+			++ones;
+		}
+	}
+	CHECK(same);
+	CHECK(bits.rank1(reference.size()) == ones);
+	CHECK(bits.ones() == ones);
+}
+
+void test_bit_vector(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	btree_bit_vector_t<256, 64> bits;
+	std::vector<bool> reference;
+	check_bits(bits, reference);
+
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto operation = engine() % 8;
+		bool bit = engine() % 3 == 0;
+		if (reference.empty() || operation < 4)
+		{
+			auto index = random_index(engine, reference.size());
+			bits.insert(index, bit);
+			reference.insert(reference.begin() + index, bit);
+		}
+		else if (operation == 4)
+		{
+			bits.push_back(bit);
+			reference.push_back(bit);
+		}
+		else if (operation == 5)
+		{
+			auto index = engine() % reference.size();
+			bits.erase(index);
+			reference.erase(reference.begin() + index);
+		}
+		else
+		{
+			auto index = engine() % reference.size();
+			bits.set(index, bit);
+			reference[index] = bit;
+		}
+	}
+	check_bits(bits, reference);
+
+	// Erase down to nothing and start over
+	while (!reference.empty())
+	{
+		auto index = engine() % reference.size();
+		bits.erase(index);
+		reference.erase(reference.begin() + index);
+	}
+	check_bits(bits, reference);
+	bits.push_back(true);
+	reference.push_back(true);
+	check_bits(bits, reference);
+}
+
+void test_handle(std::size_t count, std::uint64_t seed)
+{
+	typedef btree_handle_array_t<int, 64, 64> array_t;
+	std::mt19937_64 engine(seed);
+	array_t array;
+	std::vector<int> reference;
+	std::vector<array_t::handle_t> handles;
+	check_runs(array, reference);
+
+	auto check_handles = [&]()
+	{
+		CHECK(array.size() == reference.size());
+		bool same = true;
+		for (std::size_t I = 0; I != reference.size(); ++I)
+		{
+			same = same && array.position(handles[I]) == I;
+			same = same && array.get(handles[I]) == reference[I];
+			same = same && array.handle_at(I) == handles[I];
+		}
+		CHECK(same);
+		check_runs(array, reference);
+	};
+
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		if (reference.empty() || engine() % 3 != 0)
+		{
+			auto index = random_index(engine, reference.size());
+			auto handle = array.insert(index, static_cast<int>(I));
+			reference.insert(reference.begin() + index, static_cast<int>(I));
+			handles.insert(handles.begin() + index, handle);
+		}
+		else
+		{
+			auto index = engine() % reference.size();
+			array.erase(handles[index]);
+			reference.erase(reference.begin() + index);
+			handles.erase(handles.begin() + index);
+		}
+	}
+	check_handles();
+
+	// Erase everything, then reuse the released handles
+	while (!reference.empty())
+	{
+		auto index = engine() % reference.size();
+		array.erase(handles[index]);
+		reference.erase(reference.begin() + index);
+		handles.erase(handles.begin() + index);
+	}
+	check_handles();
+	for (int I = 0; I != 20; ++I)
+	{
+		auto index = random_index(engine, reference.size());
+		handles.insert(handles.begin() + index, array.insert(index, I));
+		reference.insert(reference.begin() + index, I);
+	}
+	check_handles();
+}
+
+void test_lazy(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	btree_lazy_array_t<long, 256, 64> array;
+	std::vector<long> reference;
+	check_runs(array, reference);
+
+	auto check_all = [&]()
+	{
+		CHECK(array.size() == reference.size());
+		bool same = true;
+		for (std::size_t I = 0; I != reference.size(); ++I) same = same && array.get(I) == reference[I];
+		CHECK(same);
+		check_runs(array, reference);
+	};
+
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto index = random_index(engine, reference.size());
+		auto value = static_cast<long>(I);
+		if (I % 2)
+		{
+			array.push_back(value);
+			reference.push_back(value);
+		}
+		else
+		{
+			array.insert(index, value);
+			reference.insert(reference.begin() + index, value);
+		}
+	}
+
+	for (std::size_t I = 0; I != 200; ++I)
+	{
+		auto first = random_index(engine, reference.size());
+		auto last = first + random_index(engine, reference.size() - first);
+		auto value = static_cast<long>(engine() % 100) - 50;
+		switch (engine() % 3)
+		{
+		case 0:
+			array.range_add(first, last, value);
+			for (auto J = first; J != last; ++J) reference[J] += value;
+			break;
+		case 1:
+			array.range_assign(first, last, value);
+			std::fill(reference.begin() + first, reference.begin() + last, value);
+			break;
+		default:
+			array.range_reverse(first, last);
+			std::reverse(reference.begin() + first, reference.begin() + last);
+			break;
+		}
+		if (I % 50 == 0) check_all();
+	}
+
+	// The whole array, then inserts into the tagged tree
+	array.range_reverse(0, reference.size());
+	std::reverse(reference.begin(), reference.end());
+	array.range_add(0, reference.size(), 3);
+	for (auto & value : reference) value += 3;
+	for (long I = 0; I != 10; ++I)
+	{
+		auto index = random_index(engine, reference.size());
+		array.insert(index, I);
+		reference.insert(reference.begin() + index, I);
+	}
+	check_all();
+}
+
+// Const reads of a tree with tags pending from several threads at once.
+// Reads must leave the tags in place, so every thread sees the same values
+// and the tree is unchanged afterwards
+
+void test_lazy_concurrent_reads(std::size_t count, std::uint64_t seed)
+{
+	std::mt19937_64 engine(seed);
+	btree_lazy_array_t<long, 256, 64> array;
+	std::vector<long> reference;
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		array.push_back(static_cast<long>(I));
+		reference.push_back(static_cast<long>(I));
+	}
+
+	for (std::size_t I = 0; I != 50; ++I)
+	{
+		auto first = random_index(engine, reference.size());
+		auto last = first + random_index(engine, reference.size() - first);
+		switch (I % 3)
+		{
+		case 0:
+			array.range_add(first, last, 7);
+			for (auto J = first; J != last; ++J) reference[J] += 7;
+			break;
+		case 1:
+			array.range_assign(first, last, static_cast<long>(I));
+			std::fill(reference.begin() + first, reference.begin() + last, static_cast<long>(I));
+			break;
+		default:
+			array.range_reverse(first, last);
+			std::reverse(reference.begin() + first, reference.begin() + last);
+			break;
+		}
+	}
+
+	btree_lazy_array_t<long, 256, 64> const & reader = array;
+	std::size_t mismatches[4] = {};
+	std::vector<std::thread> threads;
+	for (std::size_t thread = 0; thread != 4; ++thread)
+	{
+		threads.emplace_back([&, thread]()
+		{
+			for (std::size_t round = 0; round != 3; ++round)
+			{
+				for (std::size_t I = 0; I != reference.size(); ++I)
+				{
+					if (reader.get(I) != reference[I]) ++mismatches[thread];
+				}
+				std::size_t index = 0;
+				reader.iterate([&](long const * data, std::size_t size)
+				{
+					for (std::size_t I = 0; I != size; ++I)
+					{
+						if (index == reference.size() || data[I] != reference[index]) ++mismatches[thread];
+						++index;
+					}
+				});
+				if (index != reference.size()) ++mismatches[thread];
+			}
+		});
+	}
+	for (auto & thread : threads) thread.join();
+	for (auto mismatch : mismatches) CHECK(mismatch == 0);
+
+	bool same = true;
+	for (std::size_t I = 0; I != reference.size(); ++I) same = same && array.get(I) == reference[I];
+	CHECK(same);
+	check_runs(array, reference);
+}
+
+void test_columns(std::size_t count, std::uint64_t seed)
+{
+	typedef btree_basic_columns_t<64, 128, int, double, char> columns_t;
+	std::mt19937_64 engine(seed);
+	columns_t columns;
+	std::vector<columns_t::row_t> reference;
+
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		auto value = static_cast<int>(I);
+		auto row = std::make_tuple(value, value * 0.5, static_cast<char>('a' + I % 26));
+		if (I % 4 == 0)
+		{
+			columns.push_back(value, value * 0.5, static_cast<char>('a' + I % 26));
+			reference.push_back(row);
+		}
+		else
+		{
+			auto index = random_index(engine, reference.size());
+			columns.insert(index, value, value * 0.5, static_cast<char>('a' + I % 26));
+			reference.insert(reference.begin() + index, row);
+		}
+	}
+
+	CHECK(columns.size() == reference.size());
+	bool same = true;
+	for (std::size_t I = 0; I != reference.size(); ++I)
+	{
+		same = same && columns.get(I) == reference[I];
+		same = same && columns.get<0>(I) == std::get<0>(reference[I]);
+		same = same && columns.get<1>(I) == std::get<1>(reference[I]);
+		same = same && columns.get<2>(I) == std::get<2>(reference[I]);
+	}
+	CHECK(same);
+
+	std::size_t index = 0;
+	same = true;
+	columns.iterate_column<1>([&](double const * data, std::size_t size)
+	{
+		CHECK(size != 0);
+		for (std::size_t I = 0; I != size; ++I)
+		{
+			if (index == reference.size() || data[I] != std::get<1>(reference[index])) same = false;
+			++index;
+		}
+	});
+	CHECK(same);
+	CHECK(index == reference.size());
+
+	index = 0;
+	same = true;
+	columns.iterate_column<2>([&](char const * data, std::size_t size)
+	{
+		for (std::size_t I = 0; I != size; ++I)
+		{
+			if (index == reference.size() || data[I] != std::get<2>(reference[index])) same = false;
+			++index;
+		}
+	});
+	CHECK(same);
+	CHECK(index == reference.size());
+}
+
+void test_blob(std::size_t count, std::uint64_t seed)
+{
+	typedef btree_blob_array_t<64, 256> array_t;
+	std::mt19937_64 engine(seed);
+	array_t array;
+	std::vector<std::string> reference;
+	auto longest = array_t::max_element_size();
+
+	auto check_all = [&]()
+	{
+		CHECK(array.size() == reference.size());
+		bool same = true;
+		for (std::size_t I = 0; I != reference.size(); ++I) same = same && array.get(I).str() == reference[I];
+		CHECK(same);
+
+		std::size_t index = 0;
+		same = true;
+		array.iterate([&](btree_blob_view_t view)
+		{
+			CHECK(view.size() == static_cast<std::size_t>(view.end() - view.begin()));
+			if (index == reference.size() || view.str() != reference[index]) same = false;
+			++index;
+		});
+		CHECK(same);
+		CHECK(index == reference.size());
+	};
+	check_all();
+
+	for (std::size_t I = 0; I != count; ++I)
+	{
+		// Empty and maximal elements included
+		auto length = engine() % 8 == 0 ? longest : engine() % (longest + 1);
+		std::string value(length, static_cast<char>('a' + I % 26));
+		auto index = random_index(engine, reference.size());
+		switch (I % 4)
+		{
+		case 0:
+			array.insert(index, value);
+			reference.insert(reference.begin() + index, value);
+			break;
+		case 1:
+			array.insert(index, value.data(), value.size());
+			reference.insert(reference.begin() + index, value);
+			break;
+		case 2:
+			array.push_back(value);
+			reference.push_back(value);
+			break;
+		default:
+			array.push_back(value.data(), value.size());
+			reference.push_back(value);
+			break;
+		}
+	}
+	check_all();
+
+	// Too long, the array is left as it was
+	bool thrown = false;
+	try
+	{
+		array.insert(0, std::string(longest + 1, 'x'));
+	}
+	catch (std::length_error const &)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+	check_all();
+}
+
+int main()
+{
+	std::uint64_t seed = 1;
+	for (auto count : sizes)
+	{
+		test_buffered(count * 4, seed++);
+		test_rle(count, seed++);
+		test_bit_vector(count * 4, seed++);
+		test_handle(count, seed++);
+		test_lazy(count, seed++);
+		test_lazy_concurrent_reads(count, seed++);
+		test_columns(count, seed++);
+		test_blob(count, seed++);
+	}
+#ifdef __BMI2__
+	return report("test_btree_containers (bmi2)");
+#else
+	return report("test_btree_containers");
+#endif
+}